@@ -0,0 +1,56 @@
+#ifndef CELL_TIME_COUNTS_HPP
+#define CELL_TIME_COUNTS_HPP
+
+#include "record.hpp"
+#include "spatial_index.hpp"
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+
+namespace spatio {
+
+/**
+ * @brief Per-grid-cell temporal counters for sublinear box+time counts
+ *
+ * build() buckets records into square cells of cell_deg degrees and keeps,
+ * per cell, the sorted interval starts and ends (an instant is its own
+ * start and end). The number of records in a cell active during
+ * [t_start, t_end] is then #(start <= t_end) - #(end < t_start): two binary
+ * searches, independent of how many records match.
+ *
+ * The counters are a snapshot; SpatioIndexCore only uses them while no
+ * write happened since build().
+ */
+class CellTimeCounts {
+public:
+    explicit CellTimeCounts(double cell_deg = 0.1);
+
+    void build(const std::vector<Record>& records);
+
+    // Count records in cells lying strictly inside the box. `covered` is set
+    // to the cell rectangle that was counted (empty if none); points in it
+    // are inside the box, so the caller counts only the rest.
+    size_t count_interior(float lat_min, float lon_min, float lat_max, float lon_max,
+                          double t_start, double t_end, CellRange& covered) const;
+
+    double cell_deg() const { return cell_deg_; }
+    size_t cell_count() const { return cell_keys_.size(); }
+    void clear();
+
+private:
+    static uint64_t cell_key(long lat_cell, long lon_cell);
+    size_t count_cell(size_t cell, double t_start, double t_end) const;
+
+    double cell_deg_;
+    std::unordered_map<uint64_t, uint32_t> cell_index_;  // Cell key -> position
+    std::vector<uint64_t> cell_keys_;
+    std::vector<long> cell_lat_, cell_lon_;
+    std::vector<size_t> offsets_;  // cell_keys_.size() + 1 entries into starts_/ends_
+    std::vector<double> starts_;   // Sorted within each cell
+    std::vector<double> ends_;     // Sorted within each cell
+};
+
+} // namespace spatio
+
+#endif // CELL_TIME_COUNTS_HPP
@@ -0,0 +1,109 @@
+#ifndef CHANGE_FEED_HPP
+#define CHANGE_FEED_HPP
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <cstdint>
+#include <cstddef>
+
+namespace spatio {
+
+enum class ChangeKind : uint8_t {
+    INSERT = 1,           // Instant
+    INSERT_INTERVAL = 2,
+    INSERT_VALUE = 3,     // Instant with a window-aggregation value
+    UPSERT = 4,           // Moving-object position update
+    BUILD = 5,
+    CLEAR = 6,
+};
+
+// One decoded change; fields a kind does not use are zero
+struct Change {
+    ChangeKind kind;
+    uint64_t seq;
+    uint64_t object_id;
+    float lat, lon;
+    double t, t_end, value;
+};
+
+/**
+ * @brief Ordered, sequence-numbered log of index mutations
+ *
+ * Every mutation of a SpatioIndexCore gets the next sequence number; with
+ * a feed attached it is also appended here as a 1-byte kind plus a fixed
+ * payload (16-24 bytes). take() hands everything pending over as one
+ * batch: a 24-byte header (magic, first sequence number, count) followed
+ * by the entries, so shipping a batch is a single write.
+ *
+ * Record IDs are not shipped: a replica that starts from the same state
+ * (empty, or a serialize() snapshot, which carries the sequence number)
+ * and applies the same changes in order assigns the same IDs.
+ *
+ * append() and take() lock, so a replication thread may drain the feed
+ * while another thread writes. If pending changes exceed the configured
+ * bound, they are discarded; the next batch then starts after a gap,
+ * which replicas detect and answer by resyncing from a snapshot.
+ */
+class ChangeFeed {
+public:
+    struct Stats {
+        uint64_t appended = 0;
+        uint64_t batches = 0;
+        uint64_t dropped = 0;        // Discarded on overflow
+        size_t pending_bytes = 0;
+    };
+
+    explicit ChangeFeed(size_t max_pending_bytes);
+
+    void append(uint64_t seq, ChangeKind kind, const void* payload, size_t size);
+
+    // Encoded batch of all pending changes; empty string if there are none
+    std::string take();
+
+    // Drop pending changes (the next batch starts after a gap)
+    void reset();
+
+    Stats stats() const;
+
+    // Decode a batch produced by take(). Throws std::invalid_argument if it
+    // is malformed; nothing is returned for a batch that fails to decode.
+    static std::vector<Change> decode(const char* data, size_t size);
+
+    static size_t payload_size(ChangeKind kind);
+
+private:
+    mutable std::mutex mutex_;
+    size_t max_pending_bytes_;
+    std::string pending_;            // Entries only; take() prepends the header
+    uint64_t first_seq_ = 0;         // Sequence number of the first pending entry
+    uint32_t count_ = 0;
+    Stats stats_;
+};
+
+// Payload layouts (little-endian, unaligned in the batch)
+
+struct InsertPayload {
+    float lat, lon;
+    double t;
+};
+
+struct IntervalPayload {
+    float lat, lon;
+    double t, t_end;
+};
+
+struct ValuePayload {
+    float lat, lon;
+    double t, value;
+};
+
+struct UpsertPayload {
+    uint64_t object_id;
+    float lat, lon;
+    double t;
+};
+
+} // namespace spatio
+
+#endif // CHANGE_FEED_HPP
@@ -0,0 +1,137 @@
+#ifndef EYTZINGER_LAYOUT_HPP
+#define EYTZINGER_LAYOUT_HPP
+
+#include <vector>
+#include <new>
+#include <cstdint>
+#include <cstddef>
+
+namespace spatio {
+
+/**
+ * @brief 64-byte aligned allocator, so a cache line holds whole key blocks
+ */
+template <typename T>
+struct CacheAlignedAllocator {
+    using value_type = T;
+    static constexpr std::size_t ALIGNMENT = 64;
+
+    CacheAlignedAllocator() = default;
+    template <typename U>
+    CacheAlignedAllocator(const CacheAlignedAllocator<U>&) {}
+
+    T* allocate(std::size_t n) {
+        return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(ALIGNMENT)));
+    }
+    void deallocate(T* p, std::size_t) {
+        ::operator delete(p, std::align_val_t(ALIGNMENT));
+    }
+
+    template <typename U>
+    bool operator==(const CacheAlignedAllocator<U>&) const { return true; }
+    template <typename U>
+    bool operator!=(const CacheAlignedAllocator<U>&) const { return false; }
+};
+
+/**
+ * @brief Search copy of a sorted column in Eytzinger (BFS) order
+ *
+ * Node k's children are 2k and 2k+1, so the top of the implicit tree
+ * shares a few cache lines and every search walks a branch-free path.
+ * The 2^B descendants B levels below k are contiguous (B = log2 of keys per
+ * cache line), so each step prefetches the line needed B steps later and
+ * the memory latency of successive levels overlaps.
+ *
+ * Searches return ranks in the original sorted column; the rank of a node
+ * is computed from its index, so no side table (and no extra miss) is needed.
+ */
+template <typename T>
+class EytzingerLayout {
+public:
+    // Build from keys sorted ascending
+    void build(const T* sorted, size_t n) {
+        keys_.assign(n + 1, T());
+        size_t next = 0;
+        fill(sorted, n, 1, next);
+        height_ = n > 0 ? floor_log2(n) : 0;
+        last_level_ = n > 0 ? n - (size_t(1) << height_) + 1 : 0;
+    }
+
+    // Rank of the first key >= key (size() if none)
+    size_t lower_bound(const T& key) const { return search<false>(key); }
+
+    // Rank of the first key > key (size() if none)
+    size_t upper_bound(const T& key) const { return search<true>(key); }
+
+    size_t size() const { return keys_.empty() ? 0 : keys_.size() - 1; }
+    // Key array, root at index 1
+    const T* data() const { return keys_.data(); }
+    bool empty() const { return size() == 0; }
+
+    void clear() {
+        keys_.clear();
+        keys_.shrink_to_fit();
+        height_ = 0;
+        last_level_ = 0;
+    }
+
+private:
+    static constexpr size_t LINE_BYTES = 64;
+    static constexpr size_t KEYS_PER_LINE = LINE_BYTES / sizeof(T) > 0 ? LINE_BYTES / sizeof(T) : 1;
+
+    static int floor_log2(size_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+        return 63 - __builtin_clzll(static_cast<unsigned long long>(x));
+#else
+        int r = 0;
+        while (x >>= 1) r++;
+        return r;
+#endif
+    }
+
+    // In-order traversal of the implicit tree assigns sorted keys
+    void fill(const T* sorted, size_t n, size_t k, size_t& next) {
+        if (k > n) return;
+        fill(sorted, n, 2 * k, next);
+        keys_[k] = sorted[next++];
+        fill(sorted, n, 2 * k + 1, next);
+    }
+
+    // In-order rank of node k: its rank in the perfect tree of the same
+    // height, minus the absent last-level leaves that would precede it
+    size_t rank_of(size_t k) const {
+        int depth = floor_log2(k);
+        size_t perfect = ((2 * (k - (size_t(1) << depth)) + 1) << (height_ - depth)) - 1;
+        size_t leaves_before = (perfect + 1) / 2;
+        return perfect - (leaves_before > last_level_ ? leaves_before - last_level_ : 0);
+    }
+
+    template <bool Upper>
+    size_t search(const T& key) const {
+        const size_t n = size();
+        const T* keys = keys_.data();
+        size_t k = 1;
+        while (k <= n) {
+#if defined(__GNUC__) || defined(__clang__)
+            // Integer arithmetic: the target may lie past the end, which is
+            // harmless for a prefetch but not for a pointer
+            __builtin_prefetch(reinterpret_cast<const void*>(
+                reinterpret_cast<uintptr_t>(keys) + k * KEYS_PER_LINE * sizeof(T)));
+#endif
+            k = 2 * k + (Upper ? !(key < keys[k]) : (keys[k] < key));
+        }
+        // Undo the trailing right turns (and the last left turn) to reach
+        // the last node where the search went left: the answer
+        while (k & 1) k >>= 1;
+        k >>= 1;
+        return k == 0 ? n : rank_of(k);
+    }
+
+    std::vector<T, CacheAlignedAllocator<T>> keys_;  // 1-based; keys_[0] unused
+    int height_ = 0;          // Depth of the last level
+    size_t last_level_ = 0;   // Nodes present on the last level
+};
+
+} // namespace spatio
+
+#endif // EYTZINGER_LAYOUT_HPP
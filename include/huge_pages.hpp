@@ -0,0 +1,63 @@
+#ifndef HUGE_PAGES_HPP
+#define HUGE_PAGES_HPP
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace spatio {
+
+/**
+ * @brief Huge-page and prefault helpers for large, long-lived arrays
+ *
+ * Random traversal over gigabytes of 4 KB pages misses the TLB on almost
+ * every node; 2 MB pages cut the page-table footprint 512-fold. Everything
+ * here is best effort: on kernels or platforms without a feature the
+ * calls change nothing and report it (false / OFF), they never throw.
+ *
+ * TRANSPARENT asks for transparent huge pages (madvise(MADV_HUGEPAGE),
+ * honored unless THP is disabled system-wide). EXPLICIT maps pages from
+ * the reserved hugetlb pool (MAP_HUGETLB; see vm.nr_hugepages) and falls
+ * back to TRANSPARENT when the pool is short.
+ */
+
+enum class HugePages : uint8_t { OFF, TRANSPARENT, EXPLICIT };
+
+constexpr size_t HUGE_PAGE_SIZE = size_t(2) << 20;
+
+// A large array of an index, for advise/prefault passes
+struct MemoryRegion {
+    const void* data;
+    size_t bytes;
+};
+
+// Result of an index's warmup()
+struct WarmupStats {
+    size_t prefaulted_bytes = 0;
+    size_t touched_nodes = 0;     // Upper tree levels read
+    double seconds = 0.0;
+};
+
+// Advise transparent huge pages for the 2 MB-aligned part of the region.
+// Memory already faulted in is collapsed right away where the kernel
+// supports it (MADV_COLLAPSE, Linux 6.1+), otherwise by khugepaged in the
+// background. False if nothing was advised (too small, or unsupported).
+bool advise_huge_pages(const MemoryRegion& region);
+
+// Fault the region in (read access), so first touches later do not take
+// page faults. Returns the number of bytes covered.
+size_t prefault(const MemoryRegion& region);
+
+// Anonymous read-write mapping of at least `bytes`, rounded up to
+// HUGE_PAGE_SIZE, backed as `mode` asks. On return `mode` holds what was
+// granted and `length` the mapped length. nullptr on failure.
+void* map_huge(size_t bytes, HugePages& mode, size_t& length);
+void unmap_huge(void* data, size_t length);
+
+// Bytes of the process backed by transparent huge pages (AnonHugePages in
+// /proc/self/smaps_rollup; 0 if unavailable)
+size_t anon_huge_page_bytes();
+
+} // namespace spatio
+
+#endif // HUGE_PAGES_HPP
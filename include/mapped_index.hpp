@@ -0,0 +1,143 @@
+#ifndef MAPPED_INDEX_HPP
+#define MAPPED_INDEX_HPP
+
+#include "record.hpp"
+#include "huge_pages.hpp"
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+namespace spatio {
+
+/**
+ * @brief Read-only index over a memory-mapped image file
+ *
+ * write() lays records out in a single file with offset-based sections and
+ * no pointers: records in implicit KD-tree order (the median of a range is
+ * its split point) with per-subtree [min start, max end] bounds, start
+ * times sorted within duration classes (as in TemporalIndex) with their
+ * record positions, sorted end times, and an ID -> position table. open() maps the file read-only
+ * and validates the header, so attaching costs a few system calls however
+ * large the image is, and every process mapping the same file shares one
+ * copy in the page cache. Put the file under /dev/shm for a RAM-backed
+ * POSIX shared-memory image.
+ *
+ * Time semantics match SpatioIndexCore: a record matches [t_start, t_end]
+ * when it is active at some time in the window.
+ *
+ * With huge pages requested, the image is read into a private anonymous
+ * mapping backed by 2 MB pages instead of being mapped from the page
+ * cache: attaching then costs a full read and processes no longer share
+ * the copy, in exchange for far fewer TLB misses on large images.
+ */
+class MappedIndex {
+public:
+    // Write an image of `records` to `path` (via a temporary file renamed
+    // into place, so readers never map a partial image). Throws
+    // std::runtime_error on I/O failure.
+    static void write(const std::vector<Record>& records, const std::string& path);
+
+    // Map an image read-only (huge_pages OFF) or load it into huge pages.
+    // Throws std::runtime_error if the file is missing, truncated or not an
+    // image of this format.
+    explicit MappedIndex(const std::string& path, HugePages huge_pages = HugePages::OFF);
+    ~MappedIndex();
+
+    MappedIndex(const MappedIndex&) = delete;
+    MappedIndex& operator=(const MappedIndex&) = delete;
+    MappedIndex(MappedIndex&& other) noexcept;
+    MappedIndex& operator=(MappedIndex&& other) noexcept;
+
+    std::vector<uint64_t> query_radius(float center_lat, float center_lon, double radius_km) const;
+    std::vector<uint64_t> query_box(float lat_min, float lon_min, float lat_max, float lon_max) const;
+    std::vector<uint64_t> query_radius_time(float center_lat, float center_lon, double radius_km,
+                                            double t_start, double t_end) const;
+    std::vector<uint64_t> query_box_time(float lat_min, float lon_min,
+                                         float lat_max, float lon_max,
+                                         double t_start, double t_end) const;
+
+    // Exact k nearest records (active during [t_start, t_end] for the timed
+    // variant), nearest first
+    std::vector<uint64_t> query_knn(float lat, float lon, size_t k) const;
+    std::vector<uint64_t> query_knn_time(float lat, float lon, size_t k,
+                                         double t_start, double t_end) const;
+
+    size_t count_time_range(double t_start, double t_end) const;
+
+    // Pointer into the mapping (valid while this object lives), or nullptr
+    const Record* get_record_ptr(uint64_t id) const;
+
+    size_t size() const;
+    double min_time() const;
+    double max_time() const;
+    size_t mapped_bytes() const { return length_; }
+    const std::string& path() const { return path_; }
+    // What the image is backed by (requests fall back: EXPLICIT ->
+    // TRANSPARENT -> OFF)
+    HugePages huge_pages() const { return huge_pages_; }
+
+    // Fault the whole image in now; returns the bytes covered
+    size_t prefault() const;
+
+    // Start reading the whole image in the background and read the top
+    // `tree_levels` levels of the KD-tree and time-column searches now, so
+    // first queries after attaching do not stall on page faults there
+    WarmupStats warmup(int tree_levels = 18) const;
+
+private:
+    struct Header;
+    struct NodeTimes;
+    struct DurationSlice;
+    static constexpr size_t LEAF_SIZE = 16;
+    // A start-time scan reads records out of order; it is chosen when it
+    // touches TIME_SCAN_COST times fewer records than the tree would, as
+    // estimated from the top ESTIMATE_LEVELS levels
+    static constexpr size_t TIME_SCAN_COST = 4;
+    static constexpr int ESTIMATE_LEVELS = 10;
+
+    const Header& header() const { return *reinterpret_cast<const Header*>(base_); }
+    template <typename T>
+    const T* section(uint64_t offset) const {
+        return reinterpret_cast<const T*>(static_cast<const char*>(base_) + offset);
+    }
+
+    template <typename Visit>
+    void visit_box_time(float lat_min, float lon_min, float lat_max, float lon_max,
+                        double t_start, double t_end, Visit&& visit) const;
+    template <typename Visit>
+    void box_recursive(size_t lo, size_t hi, int depth, size_t node,
+                       float lat_min, float lon_min, float lat_max, float lon_max,
+                       double t_start, double t_end, Visit& visit) const;
+    // Records in the subtrees the box and window reach, `levels` deep
+    size_t box_estimate(size_t lo, size_t hi, int depth, size_t node, int levels,
+                        float lat_min, float lon_min, float lat_max, float lon_max,
+                        double t_start, double t_end) const;
+    // No record of subtree `node` is active during [t_start, t_end]
+    bool outside_window(size_t node, double t_start, double t_end) const;
+    struct KNNCandidate;
+    void knn_recursive(size_t lo, size_t hi, int depth, size_t node, float lat, float lon, size_t k,
+                       double t_start, double t_end,
+                       std::vector<KNNCandidate>& candidates) const;
+
+    // Read the image into anonymous memory backed as `mode` asks
+    void load_copy(int fd, HugePages mode);
+    void release();
+
+    std::string path_;
+    const void* base_ = nullptr;
+    size_t length_ = 0;
+    HugePages huge_pages_ = HugePages::OFF;
+    size_t copy_length_ = 0;                  // Anonymous copy's mapping; 0 if file-mapped
+    const Record* records_ = nullptr;
+    const double* starts_ = nullptr;          // Sorted start times
+    const uint32_t* start_positions_ = nullptr;  // records_ position of starts_[i]
+    const double* ends_ = nullptr;            // Sorted end times
+    const uint32_t* id_positions_ = nullptr;  // Indexed by ID; UINT32_MAX if absent
+    const DurationSlice* classes_ = nullptr;
+    const NodeTimes* node_times_ = nullptr;
+};
+
+} // namespace spatio
+
+#endif // MAPPED_INDEX_HPP
@@ -0,0 +1,50 @@
+#ifndef NUMA_TOPOLOGY_HPP
+#define NUMA_TOPOLOGY_HPP
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace spatio {
+namespace numa {
+
+/**
+ * @brief NUMA placement helpers for spatio_server (Linux)
+ *
+ * The topology comes from sysfs (/sys/devices/system/node), restricted to
+ * the CPUs this process may run on, so taskset and cgroup cpusets are
+ * honored. Memory placement uses set_mempolicy(MPOL_PREFERRED) on the
+ * calling thread: pages it touches first come from its node while that
+ * node has free memory, and from elsewhere rather than failing once it
+ * runs out. No libnuma needed.
+ */
+
+struct Node {
+    int id = 0;
+    std::vector<int> cpus;    // Allowed CPUs on this node
+};
+
+// Nodes with at least one allowed CPU, by ID. A single node holding every
+// allowed CPU if sysfs has no NUMA information.
+std::vector<Node> nodes();
+
+// Position in `nodes` of the node the calling thread runs on (0 if unknown)
+size_t current_node(const std::vector<Node>& nodes);
+
+// Restrict the calling thread to the node's CPUs; false on failure
+bool pin_thread(const Node& node);
+
+// Prefer the node for the calling thread's future allocations; false on failure
+bool prefer_memory(const Node& node);
+
+// Kernel page allocation counters of a node (numastat; system-wide)
+struct PageCounts {
+    uint64_t local = 0;       // Allocated here for a thread running here
+    uint64_t remote = 0;      // Allocated here for a thread on another node
+};
+PageCounts page_counts(int node);
+
+} // namespace numa
+} // namespace spatio
+
+#endif // NUMA_TOPOLOGY_HPP
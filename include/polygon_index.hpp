@@ -0,0 +1,89 @@
+#ifndef POLYGON_INDEX_HPP
+#define POLYGON_INDEX_HPP
+
+#include "static_rtree.hpp"
+#include <vector>
+#include <utility>
+#include <cstdint>
+#include <cstddef>
+
+namespace spatio {
+
+/**
+ * @brief Reverse geofence index: which polygons contain a point
+ *
+ * Companion to SpatioIndexCore for static zone sets. Polygons are added,
+ * then build() bulk-loads an R-tree over their bounding boxes and
+ * precomputes a per-polygon edge grid:
+ * - every grid cell is classified inside / outside / boundary, so most
+ *   points are answered by a single cell lookup
+ * - every grid row keeps the edges crossing its latitude band, so points
+ *   in boundary cells ray-cast against a handful of edges only
+ *
+ * Rings are implicitly closed; containment uses the even-odd rule.
+ */
+class PolygonIndex {
+public:
+    explicit PolygonIndex(size_t max_grid_resolution = 64);
+
+    // vertices are (lat, lon) pairs. Throws std::invalid_argument for < 3 vertices.
+    void add_polygon(uint64_t polygon_id, const std::vector<std::pair<double, double>>& vertices);
+
+    // Bulk-load the R-tree and edge grids. Queries before build() see nothing.
+    void build();
+
+    std::vector<uint64_t> containing_polygons(double lat, double lon) const;
+
+    // Appends matches to `out`
+    void containing_polygons(double lat, double lon, std::vector<uint64_t>& out) const;
+
+    // Batched lookup in CSR form: matches of point i are
+    // ids[offsets[i] .. offsets[i+1]). Large batches are evaluated in
+    // Morton order for cache locality; output order follows the input.
+    void containing_polygons_batch(const double* lats, const double* lons, size_t n,
+                                   std::vector<uint64_t>& offsets,
+                                   std::vector<uint64_t>& ids) const;
+
+    size_t size() const { return polygons_.size(); }
+    bool is_built() const { return built_; }
+    void clear();
+
+private:
+    static constexpr size_t BATCH_SORT_THRESHOLD = 256;
+
+    enum CellState : uint8_t { OUTSIDE = 0, INSIDE = 1, BOUNDARY = 2 };
+
+    // Edge endpoints are copied into every row list they cross, so a ray
+    // cast scans one contiguous block instead of chasing vertex indices
+    struct Edge {
+        double lat0, lon0;
+        double lat1, lon1;
+    };
+
+    // Hot per-polygon header; grid data lives in the shared arenas below
+    struct Polygon {
+        uint64_t id;
+        double min_lat, max_lat, min_lon, max_lon;
+        double cell_lat = 0.0, cell_lon = 0.0;
+        uint32_t rows = 0, cols = 0;
+        uint32_t cells_begin = 0;        // Offset into cells_ (rows * cols states)
+        uint32_t row_offsets_begin = 0;  // Offset into row_offsets_ (rows + 1 entries)
+    };
+
+    void build_grid(size_t poly_idx);
+    bool contains(const Polygon& poly, double lat, double lon) const;
+    bool ray_cast(const Polygon& poly, uint32_t row, double lat, double lon) const;
+
+    size_t max_grid_resolution_;
+    std::vector<Polygon> polygons_;
+    std::vector<std::vector<std::pair<double, double>>> vertices_;  // Kept for rebuilds
+    std::vector<uint8_t> cells_;
+    std::vector<uint32_t> row_offsets_;  // Absolute offsets into edges_
+    std::vector<Edge> edges_;
+    StaticRTree<2> rtree_;
+    bool built_ = false;
+};
+
+} // namespace spatio
+
+#endif // POLYGON_INDEX_HPP
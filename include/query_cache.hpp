@@ -0,0 +1,122 @@
+#ifndef QUERY_CACHE_HPP
+#define QUERY_CACHE_HPP
+
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <mutex>
+#include <cstdint>
+#include <cstddef>
+
+namespace spatio {
+
+// Hit/miss counters and memory usage of a QueryCache
+struct QueryCacheStats {
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t stale = 0;           // Lookups that found an entry invalidated by a write
+    size_t evictions = 0;
+    size_t entries = 0;
+    size_t bytes = 0;
+    size_t max_bytes = 0;
+};
+
+/**
+ * @brief Bounded LRU cache of query results
+ *
+ * Queries are normalized into keys: with a non-zero quantum, coordinates,
+ * radius and time bounds are snapped to that grid so near-identical
+ * viewport refreshes share an entry (and the snapped query is what gets
+ * executed). With quantum 0 keys are exact.
+ *
+ * Invalidation is by write epoch. Every write bumps the epoch of the coarse
+ * spatial partition it lands in; an entry remembers the epochs of the
+ * partitions its query region overlaps and is stale once any of them moved.
+ * Regions overlapping too many partitions fall back to the global epoch.
+ */
+class QueryCache {
+public:
+    struct Config {
+        size_t max_bytes = 64 * 1024 * 1024;
+        double coord_quantum = 0.0;       // Degrees; 0 = exact
+        double radius_quantum_km = 0.0;   // Kilometres; 0 = exact
+        double time_quantum = 0.0;        // Time units; 0 = exact
+        double partition_deg = 1.0;       // Size of an epoch partition cell
+    };
+
+    // Normalized query: the cache key plus the snapped parameters to execute
+    struct Query {
+        enum Kind : uint8_t { RadiusTime = 1, BoxTime = 2 };
+
+        Kind kind;
+        int64_t key[6];
+
+        // Radius: (lat_a, lon_a) is the center. Box: a = min corner, b = max corner.
+        float lat_a = 0.0f, lon_a = 0.0f;
+        float lat_b = 0.0f, lon_b = 0.0f;
+        double radius_km = 0.0;
+        double t_start = 0.0, t_end = 0.0;
+
+        // Region bounding box used for partition epochs
+        double region_lat_min = 0.0, region_lat_max = 0.0;
+        double region_lon_min = 0.0, region_lon_max = 0.0;
+
+        bool operator==(const Query& other) const;
+    };
+
+    explicit QueryCache(const Config& config);
+
+    Query normalize_radius_time(float center_lat, float center_lon, double radius_km,
+                                double t_start, double t_end) const;
+    Query normalize_box_time(float lat_min, float lon_min, float lat_max, float lon_max,
+                             double t_start, double t_end) const;
+
+    // Returns true and fills `out` on a valid hit. On a miss, `fill_epoch`
+    // must be handed back to store() so results racing a write are dropped.
+    bool lookup(const Query& query, std::vector<uint64_t>& out, uint64_t& fill_epoch);
+
+    // Store a result computed for `query` after a missed lookup
+    void store(const Query& query, const std::vector<uint64_t>& ids, uint64_t fill_epoch);
+
+    // Record a write at (lat, lon); entries over that partition become stale
+    void on_write(float lat, float lon);
+
+    // Drop every entry (e.g. on clear())
+    void invalidate_all();
+
+    QueryCacheStats stats() const;
+    const Config& config() const { return config_; }
+
+private:
+    static constexpr size_t NUM_PARTITIONS = 4096;
+    static constexpr size_t MAX_TRACKED_PARTITIONS = 64;
+
+    struct QueryHash {
+        size_t operator()(const Query& q) const;
+    };
+
+    struct Entry {
+        Query query;
+        std::vector<uint64_t> ids;
+        uint64_t global_epoch;                                  // Used when partitions is empty
+        std::vector<std::pair<uint32_t, uint64_t>> partitions;  // (partition, epoch at fill)
+        size_t bytes;
+    };
+
+    size_t partition_of(long cell_lat, long cell_lon) const;
+    void collect_partitions(const Query& query, std::vector<uint32_t>& out) const;
+    bool is_valid(const Entry& entry) const;
+    void erase(std::list<Entry>::iterator it);
+
+    Config config_;
+    mutable std::mutex mutex_;
+    std::list<Entry> lru_;  // Most recently used at the front
+    std::unordered_map<Query, std::list<Entry>::iterator, QueryHash> map_;
+    std::vector<uint64_t> partition_epochs_;
+    uint64_t global_epoch_ = 0;
+    QueryCacheStats stats_;
+};
+
+} // namespace spatio
+
+#endif // QUERY_CACHE_HPP
@@ -0,0 +1,106 @@
+#ifndef QUERY_CURSOR_HPP
+#define QUERY_CURSOR_HPP
+
+#include "spatial_index.hpp"
+#include "record_store.hpp"
+#include <vector>
+#include <cstdint>
+#include <limits>
+#include <shared_mutex>
+
+namespace spatio {
+
+/**
+ * @brief Streaming traversal over a spatial(-temporal) query result
+ *
+ * Instead of materializing every matching ID, the cursor walks the KD-tree
+ * with an explicit stack and hands out results in caller-sized batches.
+ * Peak memory is bounded by the traversal stack plus one batch.
+ *
+ * The cursor holds raw pointers into the index. Inserts are tolerated
+ * (new points may or may not be visited), but anything that restructures
+ * the tree invalidates the cursor and the next call to next_batch() throws
+ * std::runtime_error: clear(), an upsert that moves an object out of its
+ * node's cell (relocation), and the rebalance that follows as many
+ * relocations as the tree holds points.
+ *
+ * With `mutex` set (the owning index's lock), next_batch() holds it
+ * shared, so writes from other threads wait for the chunk to finish.
+ */
+class QueryCursor {
+public:
+    static constexpr size_t DEFAULT_CHUNK_SIZE = 65536;
+
+    /**
+     * @brief Open a cursor over a radius query with optional time filter
+     */
+    static QueryCursor radius(const SpatialIndex& spatial, const RecordStore& records,
+                              float center_lat, float center_lon, double radius_km,
+                              double t_start = std::numeric_limits<double>::lowest(),
+                              double t_end = std::numeric_limits<double>::max(),
+                              size_t chunk_size = DEFAULT_CHUNK_SIZE,
+                              std::shared_mutex* mutex = nullptr);
+
+    /**
+     * @brief Open a cursor over a bounding box query with optional time filter
+     */
+    static QueryCursor box(const SpatialIndex& spatial, const RecordStore& records,
+                           float lat_min, float lon_min, float lat_max, float lon_max,
+                           double t_start = std::numeric_limits<double>::lowest(),
+                           double t_end = std::numeric_limits<double>::max(),
+                           size_t chunk_size = DEFAULT_CHUNK_SIZE,
+                           std::shared_mutex* mutex = nullptr);
+
+    /**
+     * @brief Produce up to max_count further IDs into out
+     *
+     * @return Number of IDs written; 0 once the traversal is exhausted
+     */
+    size_t next_batch(uint64_t* out, size_t max_count);
+
+    /**
+     * @brief Convenience overload producing up to chunk_size() IDs
+     */
+    std::vector<uint64_t> next_batch();
+
+    bool done() const { return stack_.empty(); }
+    size_t chunk_size() const { return chunk_size_; }
+    size_t produced() const { return produced_; }
+
+private:
+    enum class Shape { Radius, Box };
+
+    QueryCursor(const SpatialIndex& spatial, const RecordStore& records, Shape shape,
+                double t_start, double t_end, size_t chunk_size, std::shared_mutex* mutex);
+
+    bool matches(const KDNode* node) const;
+    void push_children(const KDNode* node);
+
+    const SpatialIndex* spatial_;
+    const RecordStore* records_;
+    std::shared_mutex* mutex_;
+    uint64_t structure_version_;
+    Shape shape_;
+
+    // Radius parameters
+    float center_lat_ = 0.0f;
+    float center_lon_ = 0.0f;
+    double radius_m_ = 0.0;
+
+    // Box parameters
+    float lat_min_ = 0.0f, lon_min_ = 0.0f;
+    float lat_max_ = 0.0f, lon_max_ = 0.0f;
+
+    // Time filter (disabled when spanning the full double range)
+    double t_start_;
+    double t_end_;
+    bool time_filtered_;
+
+    size_t chunk_size_;
+    size_t produced_ = 0;
+    std::vector<const KDNode*> stack_;
+};
+
+} // namespace spatio
+
+#endif // QUERY_CURSOR_HPP
@@ -10,7 +10,8 @@ namespace spatio {
  * 
  * A Record is a point in space-time with:
  * - Spatial coordinates (latitude, longitude)
- * - Temporal coordinate (timestamp)
+ * - Temporal coordinate (timestamp, or [t, t_end] for interval records
+ *   such as stays and sessions; instants have t_end == t)
  * - Unique identifier
  */
 struct Record {
@@ -18,17 +19,31 @@ struct Record {
     float lon;        // Longitude in degrees [-180, 180]
     double t;         // Timestamp (seconds since epoch or arbitrary time unit)
     uint64_t id;      // Unique identifier
+    double t_end;     // End of the active interval (inclusive)
 
     /**
      * @brief Default constructor
      */
-    Record() : lat(0.0f), lon(0.0f), t(0.0), id(0) {}
+    Record() : lat(0.0f), lon(0.0f), t(0.0), id(0), t_end(0.0) {}
 
     /**
-     * @brief Parameterized constructor
+     * @brief Parameterized constructor (instant record)
      */
     Record(float _lat, float _lon, double _t, uint64_t _id = 0)
-        : lat(_lat), lon(_lon), t(_t), id(_id) {}
+        : lat(_lat), lon(_lon), t(_t), id(_id), t_end(_t) {}
+
+    /**
+     * @brief Interval record active during [_t, _t_end]
+     */
+    Record(float _lat, float _lon, double _t, double _t_end, uint64_t _id)
+        : lat(_lat), lon(_lon), t(_t), id(_id), t_end(_t_end) {}
+
+    /**
+     * @brief Whether the record is active at some time in [from, to]
+     */
+    bool active_during(double from, double to) const {
+        return t <= to && t_end >= from;
+    }
 };
 
 } // namespace spatio
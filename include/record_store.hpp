@@ -2,6 +2,8 @@
 #define RECORD_STORE_HPP
 
 #include "record.hpp"
+#include "serialization.hpp"
+#include "huge_pages.hpp"
 #include <vector>
 #include <unordered_map>
 #include <optional>
@@ -16,6 +18,9 @@ public:
     // Add record and return assigned ID
     uint64_t add_record(float lat, float lon, double t);
     
+    // Add interval record active during [t, t_end]
+    uint64_t add_record(float lat, float lon, double t, double t_end);
+    
     // Get record by ID (returns nullopt if not found)
     std::optional<Record> get_record(uint64_t id) const;
     
@@ -24,11 +29,27 @@ public:
     // Only safe to use immediately after retrieval
     const Record* get_record_ptr(uint64_t id) const;
     
+    // Overwrite position and timestamp of an existing record (moving objects).
+    // The record becomes an instant at t. Returns false if not found.
+    bool update_record(uint64_t id, float lat, float lon, double t);
+    
+    // All records in insertion order (for bulk scans such as index builds)
+    const std::vector<Record>& records() const { return records_; }
+    
     // Get number of records
     size_t size() const { return records_.size(); }
     
     // Clear all records
     void clear();
+    
+    // Record array, for huge-page advice and prefaulting
+    void memory_regions(std::vector<MemoryRegion>& out) const {
+        out.push_back({records_.data(), records_.size() * sizeof(Record)});
+    }
+    
+    // Raw snapshot of the records; deserialize() replaces the contents
+    void serialize(ByteWriter& out) const;
+    void deserialize(ByteReader& in);
 
 private:
     std::vector<Record> records_;
@@ -0,0 +1,354 @@
+#ifndef SEGMENTED_INDEX_HPP
+#define SEGMENTED_INDEX_HPP
+
+#include <vector>
+#include <algorithm>
+#include <memory>
+#include <unordered_map>
+#include <shared_mutex>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <limits>
+
+namespace spatio {
+
+struct SegmentRecord {
+    float lat;
+    float lon;
+    double t;
+    uint64_t id;
+};
+
+/**
+ * @brief Immutable, fully built segment of a SegmentedIndex
+ *
+ * Records are stored in implicit KD-tree order: the median of a range is
+ * its split point (latitude at even depths, longitude at odd), so the tree
+ * is the record array itself. A second column holds the timestamps sorted,
+ * with the positions they came from; queries whose time window selects
+ * few records scan that range instead of walking the tree.
+ */
+class IndexSegment {
+public:
+    explicit IndexSegment(std::vector<SegmentRecord> records);
+
+    // Call visit(record) for every record in the box during [t_start, t_end]
+    template <typename Visit>
+    void visit_box_time(float lat_min, float lon_min, float lat_max, float lon_max,
+                        double t_start, double t_end, Visit&& visit) const {
+        if (!overlaps(lat_min, lon_min, lat_max, lon_max, t_start, t_end)) return;
+        auto in_box = [&](const SegmentRecord& r) {
+            return r.lat >= lat_min && r.lat <= lat_max && r.lon >= lon_min && r.lon <= lon_max;
+        };
+
+        // Selective time window: scan the sorted time column instead
+        size_t first = std::lower_bound(times_.begin(), times_.end(), t_start) - times_.begin();
+        size_t last = std::upper_bound(times_.begin(), times_.end(), t_end) - times_.begin();
+        if ((last - first) * TIME_SCAN_RATIO < records_.size()) {
+            for (size_t i = first; i < last; i++) {
+                const SegmentRecord& r = records_[time_positions_[i]];
+                if (in_box(r)) visit(r);
+            }
+            return;
+        }
+        box_recursive(0, records_.size(), 0, lat_min, lon_min, lat_max, lon_max,
+                      t_start, t_end, visit);
+    }
+
+    bool overlaps(float lat_min, float lon_min, float lat_max, float lon_max,
+                  double t_start, double t_end) const {
+        return lat_max >= lat_min_ && lat_min <= lat_max_ &&
+               lon_max >= lon_min_ && lon_min <= lon_max_ &&
+               t_end >= t_min_ && t_start <= t_max_;
+    }
+
+    bool contains(uint64_t id) const;
+    size_t size() const { return records_.size(); }
+    const std::vector<SegmentRecord>& records() const { return records_; }
+
+private:
+    static constexpr size_t LEAF_SIZE = 16;
+    static constexpr size_t TIME_SCAN_RATIO = 8;  // Time scan if it selects < 1/8
+
+    void build_tree(size_t lo, size_t hi, int depth);
+
+    template <typename Visit>
+    void box_recursive(size_t lo, size_t hi, int depth,
+                       float lat_min, float lon_min, float lat_max, float lon_max,
+                       double t_start, double t_end, Visit& visit) const {
+        if (hi - lo <= LEAF_SIZE) {
+            for (size_t i = lo; i < hi; i++) {
+                const SegmentRecord& r = records_[i];
+                if (r.lat >= lat_min && r.lat <= lat_max && r.lon >= lon_min &&
+                    r.lon <= lon_max && r.t >= t_start && r.t <= t_end) {
+                    visit(r);
+                }
+            }
+            return;
+        }
+        size_t mid = lo + (hi - lo) / 2;
+        const SegmentRecord& r = records_[mid];
+        float split = depth % 2 == 0 ? r.lat : r.lon;
+        float lo_bound = depth % 2 == 0 ? lat_min : lon_min;
+        float hi_bound = depth % 2 == 0 ? lat_max : lon_max;
+        if (r.lat >= lat_min && r.lat <= lat_max && r.lon >= lon_min && r.lon <= lon_max &&
+            r.t >= t_start && r.t <= t_end) {
+            visit(r);
+        }
+        if (lo_bound <= split) {
+            box_recursive(lo, mid, depth + 1, lat_min, lon_min, lat_max, lon_max, t_start, t_end, visit);
+        }
+        if (hi_bound >= split) {
+            box_recursive(mid + 1, hi, depth + 1, lat_min, lon_min, lat_max, lon_max, t_start, t_end, visit);
+        }
+    }
+
+    std::vector<SegmentRecord> records_;  // Implicit KD-tree order
+    std::vector<double> times_;           // Sorted timestamps
+    std::vector<uint32_t> time_positions_;  // records_ position of times_[i]
+    std::vector<uint64_t> ids_;           // Sorted, for membership tests
+    float lat_min_, lat_max_, lon_min_, lon_max_;
+    double t_min_, t_max_;
+};
+
+/**
+ * @brief Frozen, read-only view of a SegmentedIndex
+ *
+ * Holds references to the segments, sealed batches and tombstone set the
+ * index had when SegmentedIndex::snapshot() was called, plus the filled
+ * prefix of its head. Segments and batches are immutable, and the head is
+ * append-only within its reserved capacity, so nothing is copied: taking a
+ * snapshot costs a few reference-count increments per segment. Later
+ * compactions and removals replace the index's segments and tombstone set
+ * with new ones; memory grows only by what the snapshot keeps alive.
+ *
+ * Queries need no lock and run concurrently with ingest on the index.
+ */
+class SegmentedSnapshot {
+public:
+    std::vector<uint64_t> query_box_time(float lat_min, float lon_min,
+                                         float lat_max, float lon_max,
+                                         double t_start, double t_end) const;
+    std::vector<uint64_t> query_radius_time(float center_lat, float center_lon, double radius_km,
+                                            double t_start, double t_end) const;
+
+    size_t size() const { return live_; }
+
+private:
+    friend class SegmentedIndex;
+
+    std::shared_ptr<const std::vector<SegmentRecord>> head_;
+    const SegmentRecord* head_data_ = nullptr;  // First head_size_ records of *head_
+    size_t head_size_ = 0;
+    std::vector<std::shared_ptr<const std::vector<SegmentRecord>>> sealed_;
+    std::vector<std::shared_ptr<const IndexSegment>> segments_;
+    std::shared_ptr<const std::unordered_map<uint64_t, uint64_t>> tombstones_;
+    size_t live_ = 0;
+};
+
+/**
+ * @brief Log-structured spatio-temporal index for sustained ingest
+ *
+ * Writes go to a small mutable head that queries scan linearly. When the
+ * head fills up it is sealed and handed to the compaction thread, which
+ * builds it into an immutable IndexSegment. Segments are tiered by size:
+ * once merge_factor segments share a tier they are merged into one segment
+ * of the next tier, dropping removed records, so most data ends up in a few
+ * large segments in the static layout.
+ *
+ * Queries fan out over head, sealed batches and segments, pruning segments
+ * by their spatial and time bounds. remove() only records a tombstone;
+ * tombstones are dropped from the set once compaction has discarded the
+ * record. Builds and merges run outside the lock, which is only taken
+ * exclusively to swap segment lists, so ingest never waits for one.
+ * snapshot() returns a consistent view that stays frozen while ingest and
+ * compaction continue.
+ *
+ * Versions: every insert and removal advances version() by one, and a
+ * record's ID is the version that inserted it. query_*_as_of(v) sees the
+ * index as it was before version v. With history_retention set,
+ * compaction moves removed records into history segments instead of
+ * dropping them, stamped with the version that removed them, and drops
+ * them once that removal is older than the retention period. Current
+ * queries never visit history segments, so they pay nothing for it.
+ *
+ * Thread-safe: inserts, removals and queries may come from any thread.
+ */
+class SegmentedIndex {
+public:
+    struct Config {
+        size_t head_capacity = 16384;  // Records per head before sealing
+        size_t merge_factor = 4;       // Segments per tier before a merge
+        bool background = true;        // Compaction thread; false = inline
+        double history_retention = 0.0;  // Seconds removed records stay visible to
+                                         // as-of queries; 0 = drop at compaction
+    };
+
+    struct Stats {
+        size_t head_records = 0;
+        size_t sealed_batches = 0;     // Sealed heads not yet built
+        size_t segments = 0;
+        size_t segment_records = 0;    // Including removed ones not yet compacted
+        size_t tombstones = 0;
+        size_t compactions = 0;        // Segment builds and merges
+        size_t history_segments = 0;
+        size_t history_records = 0;    // Removed, kept for as-of queries
+    };
+
+    SegmentedIndex();
+    explicit SegmentedIndex(const Config& config);
+    ~SegmentedIndex();
+
+    SegmentedIndex(const SegmentedIndex&) = delete;
+    SegmentedIndex& operator=(const SegmentedIndex&) = delete;
+
+    uint64_t insert(float lat, float lon, double t);
+    // IDs are assigned here; the id fields of `records` are ignored
+    std::vector<uint64_t> bulk_insert(const std::vector<SegmentRecord>& records);
+
+    // Returns false if the ID is unknown or already removed
+    bool remove(uint64_t id);
+
+    std::vector<uint64_t> query_box_time(float lat_min, float lon_min,
+                                         float lat_max, float lon_max,
+                                         double t_start, double t_end) const;
+    std::vector<uint64_t> query_radius_time(float center_lat, float center_lon, double radius_km,
+                                            double t_start, double t_end) const;
+
+    // Time travel: the index as it was before version `version`. Throws
+    // std::out_of_range if the version is in the future or older than
+    // oldest_version() (records it would need were garbage collected).
+    std::vector<uint64_t> query_box_time_as_of(uint64_t version,
+                                               float lat_min, float lon_min,
+                                               float lat_max, float lon_max,
+                                               double t_start, double t_end) const;
+    std::vector<uint64_t> query_radius_time_as_of(uint64_t version,
+                                                  float center_lat, float center_lon,
+                                                  double radius_km,
+                                                  double t_start, double t_end) const;
+
+    // Number of inserts and removals so far
+    uint64_t version() const;
+    // Oldest version as-of queries can still answer exactly
+    uint64_t oldest_version() const;
+    // Version of the index at a wall-clock time (seconds since the Unix
+    // epoch), to within 10 ms: mutations up to 10 ms after it may count
+    uint64_t version_at(double wallclock) const;
+
+    // Garbage-collect history past the retention period. Runs after every
+    // compaction pass; call it directly to trim an index that is idle.
+    void collect_history();
+
+    // Consistent read-only view of the current contents (see SegmentedSnapshot)
+    SegmentedSnapshot snapshot() const;
+
+    // Seal the head now (even if not full)
+    void flush();
+    // Flush, then merge everything into a single segment without tombstones
+    void compact_all();
+    // Block until the compaction thread has nothing left to do
+    void wait_for_compaction();
+
+    size_t size() const;
+    Stats stats() const;
+
+private:
+    using SegmentPtr = std::shared_ptr<const IndexSegment>;
+    using Batch = std::shared_ptr<const std::vector<SegmentRecord>>;
+
+    // Removed records kept for as-of queries, built like any segment
+    struct HistorySegment {
+        SegmentPtr segment;
+        uint64_t min_removed;          // Removal versions in the segment
+        uint64_t max_removed;
+    };
+
+    // Output of one compaction step
+    struct Compacted {
+        SegmentPtr output;
+        std::vector<uint64_t> dropped;               // Gone for good
+        uint64_t max_dropped = 0;                    // Newest removal version among them, + 1
+        HistorySegment history{nullptr, 0, 0};       // Removed but retained
+        std::vector<std::pair<uint64_t, uint64_t>> retained;  // (ID, removal version)
+    };
+
+    // Writers take gate_ before mutex_, so new readers queue behind a
+    // waiting writer and a stream of queries cannot starve ingest
+    std::shared_lock<std::shared_mutex> read_lock() const {
+        std::lock_guard<std::mutex> gate(gate_);
+        return std::shared_lock<std::shared_mutex>(mutex_);
+    }
+    std::unique_lock<std::shared_mutex> write_lock() {
+        std::lock_guard<std::mutex> gate(gate_);
+        return std::unique_lock<std::shared_mutex>(mutex_);
+    }
+
+    // Caller holds mutex_ exclusively
+    void seal_locked();
+    uint64_t append_locked(float lat, float lon, double t);
+
+    // One unit of compaction work (build the oldest sealed head, or merge a
+    // full tier; with `major`, merge all segments); false if there was none
+    bool compact_step(bool major);
+    size_t tier_of(size_t records) const;
+    void install(const std::vector<SegmentPtr>& inputs, const Batch& batch, Compacted result);
+    void worker_loop();
+    void notify_worker();
+
+    // Copy-on-write: clones the tombstone set if a snapshot or a compaction
+    // step still shares it. Caller holds mutex_ exclusively.
+    std::unordered_map<uint64_t, uint64_t>& mutable_tombstones();
+
+    // Caller holds mutex_ exclusively
+    void stamp_clock_locked();
+    // Removals older than this are dropped rather than kept as history
+    uint64_t retention_cutoff_locked() const;
+    uint64_t version_at_locked(double wallclock) const;
+    void check_as_of_locked(uint64_t version) const;
+
+    // Visit records in the box as of `version`, history included; caller
+    // holds mutex_ (shared)
+    template <typename Visit>
+    void visit_as_of_locked(uint64_t version, float lat_min, float lon_min,
+                            float lat_max, float lon_max, double t_start, double t_end,
+                            Visit&& visit) const;
+
+    Config config_;
+    mutable std::mutex gate_;
+    mutable std::shared_mutex mutex_;  // Guards everything below
+    // Reserved to head_capacity and sealed when full, so it never reallocates
+    // and snapshots can read its filled prefix while appends continue
+    std::shared_ptr<std::vector<SegmentRecord>> head_;
+    std::vector<Batch> sealed_;                 // Oldest first
+    std::vector<SegmentPtr> segments_;          // Oldest first
+    std::shared_ptr<std::unordered_map<uint64_t, uint64_t>> tombstones_;  // ID -> removal version
+    // Set by snapshot() under the shared lock, hence atomic; cleared on copy
+    mutable std::atomic<bool> tombstones_shared_{false};
+    // Tombstone set the running compaction step reads without the lock
+    const void* compacting_tombstones_ = nullptr;
+    uint64_t next_version_ = 0;                 // Also the next record ID
+    std::vector<HistorySegment> history_;
+    std::unordered_map<uint64_t, uint64_t> removed_at_;  // History record ID -> removal version
+    uint64_t horizon_ = 0;                      // Versions below this lost dropped records
+    std::vector<std::pair<double, uint64_t>> clock_;  // (Wall-clock seconds, version), per 10 ms
+    size_t live_ = 0;
+    size_t compactions_ = 0;
+
+    // Compaction thread; compact_mutex_ serializes compaction steps
+    std::mutex compact_mutex_;
+    std::mutex work_mutex_;
+    std::condition_variable work_cv_;
+    std::condition_variable idle_cv_;
+    bool work_pending_ = false;
+    bool busy_ = false;
+    bool stop_ = false;
+    std::thread worker_;
+};
+
+} // namespace spatio
+
+#endif // SEGMENTED_INDEX_HPP
@@ -0,0 +1,106 @@
+#ifndef SERIALIZATION_HPP
+#define SERIALIZATION_HPP
+
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+#include <stdexcept>
+#include <type_traits>
+
+namespace spatio {
+
+/**
+ * @brief Appends trivially copyable values and arrays to a byte string
+ *
+ * Arrays are written as a uint64 element count followed by their raw
+ * bytes, so columns go out (and come back) with a single memcpy each.
+ * The encoding is native-endian; SpatioIndexCore::serialize() stamps a
+ * byte-order mark that deserialize() checks.
+ */
+class ByteWriter {
+public:
+    explicit ByteWriter(std::string& out) : out_(out) {}
+
+    template <typename T>
+    void put(const T& value) {
+        static_assert(std::is_trivially_copyable<T>::value, "raw bytes only");
+        out_.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template <typename T>
+    void put_array(const T* data, size_t n) {
+        static_assert(std::is_trivially_copyable<T>::value, "raw bytes only");
+        put<uint64_t>(n);
+        out_.append(reinterpret_cast<const char*>(data), n * sizeof(T));
+    }
+
+    template <typename T, typename Alloc>
+    void put_vector(const std::vector<T, Alloc>& values) {
+        put_array(values.data(), values.size());
+    }
+
+    void reserve(size_t bytes) { out_.reserve(out_.size() + bytes); }
+
+private:
+    std::string& out_;
+};
+
+/**
+ * @brief Bounds-checked reader for what ByteWriter produced
+ *
+ * Throws std::invalid_argument when the input ends early or an array
+ * length does not fit in what is left.
+ */
+class ByteReader {
+public:
+    ByteReader(const char* data, size_t size) : pos_(data), end_(data + size) {}
+
+    template <typename T>
+    T get() {
+        static_assert(std::is_trivially_copyable<T>::value, "raw bytes only");
+        require(sizeof(T));
+        T value;
+        std::memcpy(&value, pos_, sizeof(T));
+        pos_ += sizeof(T);
+        return value;
+    }
+
+    // Element count of the next array, checked against the remaining bytes
+    template <typename T>
+    size_t get_count() {
+        uint64_t n = get<uint64_t>();
+        if (n > remaining() / sizeof(T)) {
+            throw std::invalid_argument("Serialized index is truncated or corrupt");
+        }
+        return static_cast<size_t>(n);
+    }
+
+    template <typename T, typename Alloc>
+    void get_vector(std::vector<T, Alloc>& values) {
+        static_assert(std::is_trivially_copyable<T>::value, "raw bytes only");
+        size_t n = get_count<T>();
+        values.resize(n);
+        if (n > 0) {
+            std::memcpy(values.data(), pos_, n * sizeof(T));
+        }
+        pos_ += n * sizeof(T);
+    }
+
+    size_t remaining() const { return static_cast<size_t>(end_ - pos_); }
+
+private:
+    void require(size_t bytes) const {
+        if (remaining() < bytes) {
+            throw std::invalid_argument("Serialized index is truncated or corrupt");
+        }
+    }
+
+    const char* pos_;
+    const char* end_;
+};
+
+} // namespace spatio
+
+#endif // SERIALIZATION_HPP
@@ -0,0 +1,154 @@
+#ifndef SERVER_PROTOCOL_HPP
+#define SERVER_PROTOCOL_HPP
+
+#include "record.hpp"
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+
+namespace spatio {
+namespace protocol {
+
+/**
+ * @brief Wire format of spatio_server
+ *
+ * Every message is a frame: a uint32 length (bytes after the length field)
+ * followed by a fixed header and an op-specific body. Fields are in the
+ * server's byte order (little-endian on x86-64 and AArch64) and naturally
+ * aligned within the frame, so C, Go or Java clients can encode them with
+ * plain struct packing.
+ *
+ * Clients may pipeline: send any number of requests without waiting.
+ * Responses on a connection come back in request order and echo the
+ * request's tag.
+ */
+
+enum Op : uint8_t {
+    OP_PING = 0,              // -> empty
+    OP_SIZE = 1,              // -> uint64 record count
+    OP_INSERT = 2,            // InsertBody -> uint64 record ID
+    OP_BUILD = 3,             // -> empty
+    OP_RADIUS_TIME = 4,       // RadiusTimeBody -> ID list
+    OP_BOX_TIME = 5,          // BoxTimeBody -> ID list
+    OP_KNN = 6,               // KnnBody (times ignored) -> ID list, nearest first
+    OP_KNN_TIME = 7,          // KnnBody -> ID list, nearest first
+    OP_COUNT_TIME = 8,        // TimeRangeBody -> uint64 count
+    OP_COUNT_BOX_TIME = 9,    // BoxTimeBody -> uint64 count
+    OP_GET_RECORD = 10,       // GetRecordBody -> Record (32 bytes)
+    OP_COUNT
+};
+
+enum Status : uint8_t {
+    STATUS_OK = 0,
+    STATUS_BAD_REQUEST = 1,   // Unknown op or body size mismatch
+    STATUS_NOT_FOUND = 2,
+    STATUS_ERROR = 3,         // The index threw; body is the message
+};
+
+struct RequestHeader {
+    uint32_t length;          // Bytes after this field
+    uint32_t tag;             // Echoed in the response
+    uint8_t op;
+    uint8_t reserved[3];
+};
+
+struct ResponseHeader {
+    uint32_t length;
+    uint32_t tag;
+    uint8_t status;
+    uint8_t reserved[3];
+};
+
+// ID lists are a uint32 count followed by that many uint64 IDs
+
+struct InsertBody {
+    float lat, lon;
+    double t;
+    double t_end;             // Equal to t for instants
+};
+
+struct RadiusTimeBody {
+    float lat, lon;
+    double radius_km;
+    double t_start, t_end;
+};
+
+struct BoxTimeBody {
+    float lat_min, lon_min, lat_max, lon_max;
+    double t_start, t_end;
+};
+
+struct KnnBody {
+    float lat, lon;
+    uint64_t k;
+    double t_start, t_end;
+};
+
+struct TimeRangeBody {
+    double t_start, t_end;
+};
+
+struct GetRecordBody {
+    uint64_t id;
+};
+
+constexpr size_t HEADER_SIZE = sizeof(RequestHeader);
+constexpr size_t MAX_BODY_SIZE = 32;
+constexpr uint32_t MAX_FRAME_SIZE = 1 << 20;  // Larger request frames close the connection
+
+static_assert(sizeof(RequestHeader) == 12 && sizeof(ResponseHeader) == 12, "wire layout");
+static_assert(sizeof(InsertBody) == 24 && sizeof(RadiusTimeBody) == 32 &&
+              sizeof(BoxTimeBody) == 32 && sizeof(KnnBody) == 32, "wire layout");
+static_assert(sizeof(Record) == 32, "wire layout");
+
+// Body size of each request op
+inline size_t body_size(uint8_t op) {
+    switch (op) {
+        case OP_INSERT: return sizeof(InsertBody);
+        case OP_RADIUS_TIME: return sizeof(RadiusTimeBody);
+        case OP_BOX_TIME:
+        case OP_COUNT_BOX_TIME: return sizeof(BoxTimeBody);
+        case OP_KNN:
+        case OP_KNN_TIME: return sizeof(KnnBody);
+        case OP_COUNT_TIME: return sizeof(TimeRangeBody);
+        case OP_GET_RECORD: return sizeof(GetRecordBody);
+        default: return 0;
+    }
+}
+
+// Whether the op changes the index (executed alone, in order)
+inline bool is_write(uint8_t op) {
+    return op == OP_INSERT || op == OP_BUILD;
+}
+
+inline void append_request(std::string& out, uint32_t tag, uint8_t op,
+                           const void* body = nullptr, size_t size = 0) {
+    RequestHeader header{static_cast<uint32_t>(sizeof(RequestHeader) - sizeof(uint32_t) + size),
+                         tag, op, {0, 0, 0}};
+    out.append(reinterpret_cast<const char*>(&header), sizeof(header));
+    if (size > 0) out.append(static_cast<const char*>(body), size);
+}
+
+template <typename Body>
+void append_request(std::string& out, uint32_t tag, uint8_t op, const Body& body) {
+    append_request(out, tag, op, &body, sizeof(Body));
+}
+
+// Reserve a response header; finish_response() fills in the length
+inline size_t begin_response(std::string& out, uint32_t tag, uint8_t status) {
+    size_t start = out.size();
+    ResponseHeader header{0, tag, status, {0, 0, 0}};
+    out.append(reinterpret_cast<const char*>(&header), sizeof(header));
+    return start;
+}
+
+inline void finish_response(std::string& out, size_t start) {
+    uint32_t length = static_cast<uint32_t>(out.size() - start - sizeof(uint32_t));
+    std::memcpy(&out[start], &length, sizeof(length));
+}
+
+} // namespace protocol
+} // namespace spatio
+
+#endif // SERVER_PROTOCOL_HPP
@@ -3,45 +3,74 @@
 
 #include <memory>
 #include <vector>
+#include <unordered_map>
 #include <cstdint>
 #include <limits>
+#include <functional>
+#include <cmath>
+#include "serialization.hpp"
 
 namespace spatio {
 
 // KD-tree node with subtree bounding boxes
 struct KDNode {
     float point[2];      // [lat, lon]
+    double t;            // Timestamp of this node's record (interval start)
+    double t_end;        // Interval end; equals t for instant records
     uint64_t id;
     int axis;            // 0=lat, 1=lon
+    float split;         // Splitting value on axis; fixed even if the point later moves
     
     // Subtree spatial bounds (optimization 1)
     float min_lat, max_lat;
     float min_lon, max_lon;
     
+    // Subtree temporal bounds: [min start, max end]
+    double min_t, max_t;
+    
+    // Number of points in this subtree (including this node)
+    size_t subtree_size = 1;
+    
     std::unique_ptr<KDNode> left;
     std::unique_ptr<KDNode> right;
+    KDNode* parent = nullptr;
     
-    KDNode(float lat, float lon, uint64_t id_, int axis_)
-        : id(id_), axis(axis_),
+    KDNode(float lat, float lon, double t_, double t_end_, uint64_t id_, int axis_)
+        : t(t_), t_end(t_end_), id(id_), axis(axis_), split(axis_ == 0 ? lat : lon),
           min_lat(lat), max_lat(lat),
-          min_lon(lon), max_lon(lon) {
+          min_lon(lon), max_lon(lon),
+          min_t(t_), max_t(t_end_) {
         point[0] = lat;
         point[1] = lon;
     }
     
-    // Update bounding box to include child bounds
+    // Shrink bounds back to this node's point, then re-add the children
+    void recompute_bounds() {
+        min_lat = max_lat = point[0];
+        min_lon = max_lon = point[1];
+        min_t = t;
+        max_t = t_end;
+        update_bounds();
+    }
+    
+    // Update bounding box and subtree size to include children
     void update_bounds() {
+        subtree_size = 1 + (left ? left->subtree_size : 0) + (right ? right->subtree_size : 0);
         if (left) {
             min_lat = std::min(min_lat, left->min_lat);
             max_lat = std::max(max_lat, left->max_lat);
             min_lon = std::min(min_lon, left->min_lon);
             max_lon = std::max(max_lon, left->max_lon);
+            min_t = std::min(min_t, left->min_t);
+            max_t = std::max(max_t, left->max_t);
         }
         if (right) {
             min_lat = std::min(min_lat, right->min_lat);
             max_lat = std::max(max_lat, right->max_lat);
             min_lon = std::min(min_lon, right->min_lon);
             max_lon = std::max(max_lon, right->max_lon);
+            min_t = std::min(min_t, right->min_t);
+            max_t = std::max(max_t, right->max_t);
         }
     }
 };
@@ -61,11 +90,58 @@ struct SpatialQueryStats {
     }
 };
 
+// Approximate count with certified bounds: lower_bound <= exact <= upper_bound.
+// count is the midpoint of the two and error_bound() is at most epsilon;
+// with nothing left to split the bounds meet and the count is exact.
+struct ApproxCount {
+    size_t count = 0;
+    size_t lower_bound = 0;
+    size_t upper_bound = 0;
+    double epsilon = 0.0;
+    size_t nodes_visited = 0;
+    
+    // Achieved relative error bound of `count` w.r.t. the exact count,
+    // which is at least lower_bound
+    double error_bound() const {
+        size_t spread = std::max(count - lower_bound, upper_bound - count);
+        if (spread == 0) return 0.0;
+        if (lower_bound == 0) return std::numeric_limits<double>::infinity();
+        return static_cast<double>(spread) / static_cast<double>(lower_bound);
+    }
+};
+
+// Result of a (1+epsilon)-approximate KNN search. Every returned neighbour is
+// within (1+achieved_epsilon) of the distance of the true k-th neighbour.
+struct ApproxKNNResult {
+    std::vector<uint64_t> ids;
+    double epsilon = 0.0;
+    double achieved_epsilon = 0.0;
+};
+
+// Rectangle of grid cells [lat_lo, lat_hi] x [lon_lo, lon_hi], where point
+// (lat, lon) lies in cell (floor(lat / cell_deg), floor(lon / cell_deg))
+struct CellRange {
+    double cell_deg = 0.0;
+    long lat_lo = 0, lat_hi = -1;
+    long lon_lo = 0, lon_hi = -1;
+    
+    bool empty() const { return lat_lo > lat_hi || lon_lo > lon_hi; }
+    long lat_cell(double lat) const { return static_cast<long>(std::floor(lat / cell_deg)); }
+    long lon_cell(double lon) const { return static_cast<long>(std::floor(lon / cell_deg)); }
+    bool contains(float lat, float lon) const {
+        long a = lat_cell(lat), b = lon_cell(lon);
+        return a >= lat_lo && a <= lat_hi && b >= lon_lo && b <= lon_hi;
+    }
+};
+
 class SpatialIndex {
 public:
     SpatialIndex() = default;
     
-    void insert(float lat, float lon, uint64_t id);
+    void insert(float lat, float lon, double t, uint64_t id);
+    
+    // Interval record active during [t_begin, t_end]
+    void insert_interval(float lat, float lon, double t_begin, double t_end, uint64_t id);
     
     // Radius queries
     std::vector<uint64_t> radius_query(float center_lat, float center_lon, 
@@ -78,19 +154,114 @@ public:
     std::vector<uint64_t> box_query(float lat_min, float lon_min,
                                    float lat_max, float lon_max) const;
     
-    // K-nearest neighbors
+    // Spatial + temporal queries: records active at some time in
+    // [t_start, t_end]. Subtrees are pruned by their [min_t, max_t] bounds
+    // during the descent, so no post-filtering is needed.
+    std::vector<uint64_t> radius_query_time(float center_lat, float center_lon, double radius_km,
+                                            double t_start, double t_end) const;
+    std::vector<uint64_t> box_query_time(float lat_min, float lon_min,
+                                         float lat_max, float lon_max,
+                                         double t_start, double t_end) const;
+    
+    // Exact count of records in the box active during [t_start, t_end].
+    // Subtrees inside the box and the window add their size without being
+    // visited. Points in `skip` cells are not counted (the caller has
+    // counted them another way).
+    size_t count_box_time(float lat_min, float lon_min, float lat_max, float lon_max,
+                          double t_start, double t_end,
+                          const CellRange* skip = nullptr) const;
+    
+    // K-nearest neighbors, nearest first
     std::vector<uint64_t> knn_query(float lat, float lon, size_t k) const;
+    ApproxKNNResult knn_query_approx(float lat, float lon, size_t k, double epsilon) const;
+    
+    // Approximate radius+time count. Subtrees wholly inside the radius and
+    // the time window are counted by size without descending; the rest are
+    // split largest first until the bounds are within epsilon. Narrow
+    // windows over mixed timestamps settle few subtrees and cost about as
+    // much as the exact query.
+    ApproxCount count_radius_time_approx(float center_lat, float center_lon, double radius_km,
+                                         double t_start, double t_end, double epsilon) const;
+    
+    // Uniform random sampling without replacement. Candidates may be further
+    // restricted by `filter` (e.g. a time predicate); fewer than n IDs are
+    // returned only when fewer than n points match.
+    std::vector<uint64_t> sample_radius(float center_lat, float center_lon, double radius_km,
+                                        size_t n, uint64_t seed,
+                                        const std::function<bool(uint64_t)>& filter = nullptr) const;
+    std::vector<uint64_t> sample_box(float lat_min, float lon_min,
+                                     float lat_max, float lon_max,
+                                     size_t n, uint64_t seed,
+                                     const std::function<bool(uint64_t)>& filter = nullptr) const;
+    
+    // Moving objects: move point `id` from (old_lat, old_lon) to a new
+    // position and timestamp. The point is updated in place while it stays
+    // inside its node's cell (the region carved out by the ancestors'
+    // splits); otherwise it is unlinked and reinserted. Returns false if no
+    // such point exists.
+    bool move(uint64_t id, float old_lat, float old_lon,
+              float new_lat, float new_lon, double t);
+    
+    // Rebuild as a balanced tree with median splits
+    void rebuild();
     
     size_t size() const { return size_; }
     void clear();
+    
+    // Nodes in preorder with their splits; deserialize() relinks them and
+    // recomputes bounds bottom-up, so the restored tree has the same shape
+    // without any median selection
+    void serialize(ByteWriter& out) const;
+    void deserialize(ByteReader& in);
+    
+    // Read every node in the top `levels` levels (cache and TLB warmup);
+    // returns the number of nodes read
+    size_t touch_levels(int levels) const;
+    
+    // Read-only access for external traversals (QueryCursor)
+    const KDNode* root() const { return root_.get(); }
+    
+    // Bumped whenever nodes are freed; lets traversals detect stale pointers
+    uint64_t structure_version() const { return structure_version_; }
 
 private:
     std::unique_ptr<KDNode> root_;
     size_t size_ = 0;
+    uint64_t structure_version_ = 0;
+    
+    // Moving objects: region a node's point may occupy without changing any
+    // ancestor's routing (lo <= v < hi per axis)
+    struct Cell {
+        float lo[2];
+        float hi[2];
+        
+        static Cell unbounded() {
+            float inf = std::numeric_limits<float>::infinity();
+            return {{-inf, -inf}, {inf, inf}};
+        }
+    };
+    
+    // Handle of a point that has moved before, so later moves skip the descent
+    struct Tracked {
+        KDNode* node;
+        Cell cell;
+    };
+    
+    std::unordered_map<uint64_t, Tracked> tracked_;
+    size_t relocations_since_rebuild_ = 0;
     
     // Insertion helpers
     void insert_recursive(std::unique_ptr<KDNode>& node, float lat, float lon,
-                         uint64_t id, int depth);
+                         double t, double t_end, uint64_t id, int depth);
+    
+    // Moving-object helpers
+    bool find_path(uint64_t id, float lat, float lon, std::vector<KDNode*>& path) const;
+    static void narrow_cell(const KDNode* parent, bool left, Cell& cell);
+    static void propagate_move(KDNode* node);
+    static KDNode* relocation_root(const KDNode* target, const Cell& cell,
+                                   float lat, float lon, Cell& root_cell);
+    std::unique_ptr<KDNode> build_balanced(std::vector<std::unique_ptr<KDNode>>& nodes,
+                                           size_t begin, size_t end, int depth);
     void update_bounds_upward(KDNode* node);
     
     // Radius query helpers
@@ -106,6 +277,17 @@ private:
                             float lat_max, float lon_max,
                             std::vector<uint64_t>& results) const;
     
+    // Time-pruned query helpers
+    void radius_time_recursive(const KDNode* node, float center_lat, float center_lon,
+                               double radius_m, double t_start, double t_end,
+                               std::vector<uint64_t>& results) const;
+    void box_time_recursive(const KDNode* node, float lat_min, float lon_min,
+                            float lat_max, float lon_max, double t_start, double t_end,
+                            std::vector<uint64_t>& results) const;
+    size_t count_box_time_recursive(const KDNode* node, float lat_min, float lon_min,
+                                    float lat_max, float lon_max, double t_start, double t_end,
+                                    const CellRange* skip) const;
+    
     // KNN helpers
     struct KNNCandidate {
         uint64_t id;
@@ -113,12 +295,32 @@ private:
         
         // For std::push_heap - we want a max-heap (largest distance on top)
         bool operator<(const KNNCandidate& other) const {
-            return distance > other.distance;
+            return distance < other.distance;
         }
     };
     
+    // prune_factor = 1+epsilon; min_approx_prune tracks the closest plane
+    // that was skipped only because of the approximation
     void knn_recursive(const KDNode* node, float query_lat, float query_lon,
-                      size_t k, std::vector<KNNCandidate>& candidates) const;
+                      size_t k, std::vector<KNNCandidate>& candidates,
+                      double prune_factor = 1.0, double* min_approx_prune = nullptr) const;
+    
+    // Sampling helpers: a cover is a set of disjoint pieces (whole subtrees
+    // or single nodes) whose union contains every match of the query
+    struct CoverItem {
+        const KDNode* node;
+        bool whole_subtree;
+    };
+    
+    void radius_cover_recursive(const KDNode* node, float center_lat, float center_lon,
+                                double radius_m, std::vector<CoverItem>& cover) const;
+    void box_cover_recursive(const KDNode* node, float lat_min, float lon_min,
+                             float lat_max, float lon_max,
+                             std::vector<CoverItem>& cover) const;
+    std::vector<uint64_t> sample_from_cover(const std::vector<CoverItem>& cover, size_t n,
+                                            uint64_t seed,
+                                            const std::function<bool(const KDNode*)>& contains,
+                                            const std::function<bool(uint64_t)>& filter) const;
     
     // Utility functions
     bool in_box(float lat, float lon, float lat_min, float lon_min,
@@ -131,6 +333,10 @@ private:
     double min_distance_to_bbox(float query_lat, float query_lon,
                                float min_lat, float max_lat,
                                float min_lon, float max_lon) const;
+    
+    double max_distance_to_bbox(float query_lat, float query_lon,
+                               float min_lat, float max_lat,
+                               float min_lon, float max_lon) const;
 };
 
 } // namespace spatio
@@ -4,9 +4,21 @@
 #include "spatial_index.hpp"
 #include "temporal_index.hpp"
 #include "record_store.hpp"
+#include "query_cursor.hpp"
+#include "query_cache.hpp"
+#include "standing_query_index.hpp"
+#include "cell_time_counts.hpp"
+#include "windowed_aggregator.hpp"
+#include "change_feed.hpp"
 #include <vector>
+#include <unordered_map>
 #include <optional>
 #include <limits>
+#include <memory>
+#include <functional>
+#include <string>
+#include <shared_mutex>
+#include <mutex>
 
 namespace spatio {
 
@@ -14,9 +26,24 @@ struct RecordInput {
     float lat;
     float lon;
     double t;
+    double t_end;  // Equals t for instant records
     
     RecordInput(float lat_, float lon_, double t_) 
-        : lat(lat_), lon(lon_), t(t_) {}
+        : lat(lat_), lon(lon_), t(t_), t_end(t_) {}
+    
+    RecordInput(float lat_, float lon_, double t_begin, double t_end_)
+        : lat(lat_), lon(lon_), t(t_begin), t_end(t_end_) {}
+};
+
+// Position update for moving-object mode
+struct ObjectUpdate {
+    uint64_t object_id;
+    float lat;
+    float lon;
+    double t;
+    
+    ObjectUpdate(uint64_t object_id_, float lat_, float lon_, double t_)
+        : object_id(object_id_), lat(lat_), lon(lon_), t(t_) {}
 };
 
 // Comprehensive query statistics (Optimization 4: Instrumentation)
@@ -45,6 +72,12 @@ struct QueryStats {
     }
 };
 
+// Thread safety: every method locks the index, shared for queries and
+// cursor chunks, exclusive for writes, so calls may come from several
+// threads (the Python bindings release the GIL around long calls).
+// Standing-query callbacks run after the lock is released. Pointers and
+// references from get_record_ptr() and records() are only valid until the
+// next write.
 class SpatioIndexCore {
 public:
     SpatioIndexCore() = default;
@@ -54,12 +87,59 @@ public:
     // Online insert (streaming)
     uint64_t insert(float lat, float lon, double t);
     
-    // Bulk insert (batch)
+    // Interval record (stay, session) active during [t_begin, t_end].
+    // Throws std::invalid_argument if t_end < t_begin.
+    uint64_t insert_interval(float lat, float lon, double t_begin, double t_end);
+    
+    // Instant carrying a measurement; the value only feeds window sums
+    uint64_t insert_value(float lat, float lon, double t, double value);
+    
+    // Bulk insert (batch); inputs may mix instants and intervals
     std::vector<uint64_t> bulk_insert(const std::vector<RecordInput>& records);
     
-    // Explicit build phase
+    // Explicit build phase: compacts the temporal index into sorted columns
+    // (and refits its learned model, if enabled)
     void build();
     
+    // Optional learned model for temporal lookups; applied at the next build()
+    void set_learned_temporal_index(bool enabled) {
+        auto lock = write_lock();
+        temporal_index_.set_learned_model(enabled);
+    }
+    
+    // Append ingest mode for streams: in-order instants are appended to the
+    // temporal columns, pings up to `lateness` behind the newest one wait in
+    // a sorted buffer merged as the watermark advances, older ones go
+    // through the ordered set. Everything stays queryable immediately.
+    void enable_append_ingest(double lateness) {
+        auto lock = write_lock();
+        temporal_index_.enable_append_ingest(lateness);
+    }
+    void disable_append_ingest() {
+        auto lock = write_lock();
+        temporal_index_.disable_append_ingest();
+    }
+    TemporalIndex::IngestStats ingest_stats() const {
+        auto lock = read_lock();
+        return temporal_index_.ingest_stats();
+    }
+    
+    // ==================== MOVING OBJECTS ====================
+    // Object-keyed mode: each object owns one record that is moved on every
+    // update, so queries only see current positions and memory is bounded by
+    // the number of objects. Updates older than the stored position are
+    // ignored. Returns the object's record ID, which is stable across moves.
+    
+    uint64_t upsert(uint64_t object_id, float lat, float lon, double t);
+    std::vector<uint64_t> bulk_upsert(const std::vector<ObjectUpdate>& updates);
+    
+    std::optional<uint64_t> record_for_object(uint64_t object_id) const;
+    std::optional<uint64_t> object_for_record(uint64_t record_id) const;
+    size_t object_count() const {
+        auto lock = read_lock();
+        return object_records_.size();
+    }
+    
     // ==================== SPATIAL-ONLY QUERIES ====================
     // Product feature: time should be optional
     
@@ -72,6 +152,8 @@ public:
     std::vector<uint64_t> query_knn(float lat, float lon, size_t k) const;
     
     // ==================== SPATIAL + TEMPORAL QUERIES ====================
+    // A record matches [t_start, t_end] when it is active at some time in the
+    // window: instants inside it, intervals overlapping it.
     
     std::vector<uint64_t> query_radius_time(float center_lat, float center_lon,
                                            double radius_km,
@@ -84,6 +166,120 @@ public:
     std::vector<uint64_t> query_knn_time(float lat, float lon, size_t k,
                                         double t_start, double t_end) const;
     
+    // ==================== STANDING QUERIES ====================
+    // Continuous queries matched incrementally inside insert()/bulk_insert().
+    // Matches go to the callback if one is set, otherwise to a drainable queue.
+    // If the callback throws, the rest of the batch is still delivered and
+    // the first exception is rethrown afterwards.
+    
+    using StandingCallback = std::function<void(uint64_t handle, uint64_t record_id)>;
+    
+    uint64_t register_standing_query(const StandingQuery& query,
+                                     double t_start = std::numeric_limits<double>::lowest(),
+                                     double t_end = std::numeric_limits<double>::max());
+    bool unregister_standing_query(uint64_t handle);
+    size_t standing_query_count() const {
+        auto lock = read_lock();
+        return standing_queries_.size();
+    }
+    
+    // Finest cell of the standing-query grid, in degrees (default 0.01);
+    // about the size of a typical region works best
+    void set_standing_cell_size(double cell_deg) {
+        auto lock = write_lock();
+        standing_queries_.set_cell_size(cell_deg);
+    }
+    double standing_cell_size() const {
+        auto lock = read_lock();
+        return standing_queries_.cell_size();
+    }
+    
+    void set_standing_callback(StandingCallback callback);
+    std::vector<StandingMatch> drain_standing_matches();
+    size_t pending_standing_matches() const {
+        auto lock = read_lock();
+        return standing_matches_.size();
+    }
+    
+    // ==================== RESULT CACHE ====================
+    // Optional LRU cache for query_radius_time / query_box_time. Entries are
+    // invalidated by per-partition write epochs. With non-zero quanta the
+    // snapped query is executed, so near-identical queries share results.
+    
+    void enable_query_cache(const QueryCache::Config& config);
+    void disable_query_cache();
+    bool query_cache_enabled() const {
+        auto lock = read_lock();
+        return query_cache_ != nullptr;
+    }
+    QueryCacheStats query_cache_stats() const;
+    
+    // ==================== COUNTING ====================
+    // Exact counts without materializing record IDs
+    
+    // Rank arithmetic over the temporal columns (see TemporalIndex::count_range)
+    size_t count_time_range(double t_start, double t_end) const;
+    
+    // KD-tree count that adds whole matching subtrees by size. With the
+    // count grid enabled and no writes since build(), cells strictly inside
+    // the box are counted from per-cell sorted endpoints instead, and the
+    // tree only handles the boundary.
+    size_t count_box_time(float lat_min, float lon_min, float lat_max, float lon_max,
+                          double t_start, double t_end) const;
+    
+    // Per-cell temporal counters for count_box_time (off by default); built
+    // now if the index is built, otherwise at the next build()
+    void enable_count_grid(double cell_deg = 0.1);
+    void disable_count_grid() {
+        auto lock = write_lock();
+        count_grid_.reset();
+    }
+    
+    // ==================== WINDOWED AGGREGATION ====================
+    // Per-cell rolling counts and sums maintained on the write path (off by
+    // default). Every inserted or upserted record is one event at its start
+    // time; only insert_value() contributes to sums. Queries cost O(cells in
+    // the viewport) and return nothing while aggregation is disabled.
+    
+    void enable_window_aggregation(const WindowedAggregator::Config& config);
+    void disable_window_aggregation() {
+        auto lock = write_lock();
+        window_aggregator_.reset();
+    }
+    bool window_aggregation_enabled() const {
+        auto lock = read_lock();
+        return window_aggregator_ != nullptr;
+    }
+    
+    std::vector<CellAggregate> window_sliding(float lat_min, float lon_min,
+                                              float lat_max, float lon_max, double now) const;
+    std::vector<CellAggregate> window_tumbling(float lat_min, float lon_min,
+                                               float lat_max, float lon_max, double t) const;
+    
+    // ==================== APPROXIMATE QUERIES ====================
+    // For dashboards that trade some accuracy for latency; see ApproxCount
+    
+    ApproxCount count_radius_time_approx(float center_lat, float center_lon,
+                                         double radius_km,
+                                         double t_start, double t_end,
+                                         double epsilon) const;
+    
+    ApproxKNNResult query_knn_approx(float lat, float lon, size_t k, double epsilon) const;
+    
+    // ==================== SAMPLING ====================
+    // Uniform random sample (without replacement) of n matching records.
+    // Cost is driven by n and tree depth, not by the number of matches.
+    
+    std::vector<uint64_t> sample_radius_time(float center_lat, float center_lon,
+                                             double radius_km,
+                                             double t_start, double t_end,
+                                             size_t n, uint64_t seed) const;
+    
+    std::vector<uint64_t> sample_box_time(float lat_min, float lon_min,
+                                          float lat_max, float lon_max,
+                                          double t_start, double t_end,
+                                          size_t n, uint64_t seed) const;
+    
     // ==================== INSTRUMENTED QUERIES ====================
     // For performance tuning and debugging
     
@@ -92,6 +288,20 @@ public:
                                                          double t_start, double t_end,
                                                          QueryStats& stats) const;
     
+    // ==================== STREAMING QUERIES ====================
+    // Generator-style traversal; results are produced in bounded chunks
+    
+    QueryCursor open_radius_cursor(float center_lat, float center_lon, double radius_km,
+                                   double t_start = std::numeric_limits<double>::lowest(),
+                                   double t_end = std::numeric_limits<double>::max(),
+                                   size_t chunk_size = QueryCursor::DEFAULT_CHUNK_SIZE) const;
+    
+    QueryCursor open_box_cursor(float lat_min, float lon_min,
+                                float lat_max, float lon_max,
+                                double t_start = std::numeric_limits<double>::lowest(),
+                                double t_end = std::numeric_limits<double>::max(),
+                                size_t chunk_size = QueryCursor::DEFAULT_CHUNK_SIZE) const;
+    
     // ==================== DATA ACCESS ====================
     
     // Zero-copy record access (Optimization 5A)
@@ -99,13 +309,93 @@ public:
     
     // Backward compatibility
     std::optional<Record> get_record(uint64_t id) const {
-        const Record* ptr = get_record_ptr(id);
+        auto lock = read_lock();
+        const Record* ptr = record_store_.get_record_ptr(id);
         return ptr ? std::optional<Record>(*ptr) : std::nullopt;
     }
     
-    size_t size() const { return record_store_.size(); }
+    // All records in ID order; not locked, so only while nothing writes
+    const std::vector<Record>& records() const { return record_store_.records(); }
+    
+    // Write the records as a read-only image for MappedIndex (see
+    // MappedIndex::write), holding the lock shared meanwhile
+    void save_mapped(const std::string& path) const;
+    
+    size_t size() const {
+        auto lock = read_lock();
+        return record_store_.size();
+    }
     void clear();
     
+    // ==================== CHANGE FEED ====================
+    // Every mutation (insert, upsert, build, clear) gets the next sequence
+    // number. With the feed enabled it is also logged; take_changes()
+    // returns the pending changes as one compact binary batch (see
+    // ChangeFeed), and apply_changes() replays such a batch into another
+    // instance that started from the same state (empty, or a snapshot from
+    // serialize()). Changes a replica already has are skipped; a batch
+    // starting after a gap throws std::runtime_error before touching
+    // anything, and the replica must resync from a snapshot.
+    // take_changes() may run concurrently with writes.
+    
+    void enable_change_feed(size_t max_pending_bytes = 64 << 20);
+    void disable_change_feed() {
+        auto lock = write_lock();
+        change_feed_.reset();
+    }
+    bool change_feed_enabled() const {
+        auto lock = read_lock();
+        return change_feed_ != nullptr;
+    }
+    std::string take_changes();
+    ChangeFeed::Stats change_feed_stats() const;
+    
+    // Returns the number of changes applied. The batch is applied under one
+    // exclusive lock, so concurrent queries see all of it or none
+    size_t apply_changes(const char* data, size_t size);
+    
+    // Sequence number of the last mutation
+    uint64_t change_seq() const {
+        auto lock = read_lock();
+        return change_seq_;
+    }
+    
+    // ==================== SERIALIZATION ====================
+    // Snapshot of records, KD-tree, temporal columns, object mappings, the
+    // change sequence number and window aggregates as one byte string of
+    // raw arrays (for pickling, process transfer and seeding replicas).
+    // deserialize() replaces the contents without rebuilding: arrays are
+    // copied back and the tree is relinked in the same shape. A snapshot
+    // taken with window aggregation enabled brings its aggregator and
+    // config along; otherwise a local aggregator stays enabled but empty.
+    // Query cache and count grid are not part of the snapshot (the grid is
+    // refilled from the records). Standing queries stay registered, and
+    // pending change-feed entries are dropped.
+    // Throws std::invalid_argument on malformed input and leaves the index
+    // empty.
+    
+    std::string serialize() const;
+    void deserialize(const char* data, size_t size);
+    
+    // ==================== MEMORY ====================
+    // Huge pages for the large contiguous arrays: the record column, the
+    // time columns and their search copy. Enabling advises the current
+    // arrays at once, and build() and deserialize() re-advise the arrays
+    // they leave behind (arrays reallocated by later inserts are covered
+    // at the next build()). KD-tree nodes are individual heap allocations:
+    // to back those too, run with GLIBC_TUNABLES=glibc.malloc.hugetlb=1
+    // (glibc 2.35+), which makes malloc advise its heap the same way.
+    void set_huge_pages(bool enabled);
+    bool huge_pages_enabled() const {
+        auto lock = read_lock();
+        return huge_pages_;
+    }
+    
+    // Fault in the arrays and read the top `tree_levels` levels of the
+    // KD-tree, so the first queries after a load or a long idle period do
+    // not pay page faults and cold TLB/cache misses on the hot path
+    WarmupStats warmup(int tree_levels = 18) const;
+    
     // ==================== STATISTICS & DIAGNOSTICS ====================
     
     struct IndexStats {
@@ -114,16 +404,100 @@ public:
         size_t temporal_entries = 0;
         double min_time = 0.0;
         double max_time = 0.0;
+        size_t temporal_model_segments = 0;  // 0 when the learned model is off
         bool is_built = false;
     };
     
     IndexStats get_index_stats() const;
 
 private:
+    std::shared_lock<std::shared_mutex> read_lock() const {
+        return std::shared_lock<std::shared_mutex>(mutex_);
+    }
+    std::unique_lock<std::shared_mutex> write_lock() const {
+        return std::unique_lock<std::shared_mutex>(mutex_);
+    }
+    
+    mutable std::shared_mutex mutex_;  // Guards everything below
     RecordStore record_store_;
     SpatialIndex spatial_index_;
     TemporalIndex temporal_index_;
     bool build_completed_ = false;
+    std::unique_ptr<QueryCache> query_cache_;
+    std::unique_ptr<CellTimeCounts> count_grid_;
+    std::unique_ptr<WindowedAggregator> window_aggregator_;
+    StandingQueryIndex standing_queries_;
+    std::vector<StandingMatch> standing_matches_;
+    // Shared so delivery can call it without the lock while it is replaced
+    std::shared_ptr<const StandingCallback> standing_callback_;
+    std::vector<uint64_t> standing_scratch_;
+    std::unordered_map<uint64_t, uint64_t> object_records_;  // object ID -> record ID
+    std::unordered_map<uint64_t, uint64_t> record_objects_;  // record ID -> object ID
+    uint64_t change_seq_ = 0;
+    std::unique_ptr<ChangeFeed> change_feed_;
+    bool huge_pages_ = false;
+    
+    // Helpers below expect the caller to hold mutex_ (exclusively if they
+    // write), except deliver_standing() and write_and_deliver()
+    
+    // Number the next mutation and log it to the feed, if any
+    template <typename Payload>
+    void log_change(ChangeKind kind, const Payload& payload) {
+        change_seq_++;
+        if (change_feed_) change_feed_->append(change_seq_, kind, &payload, sizeof(Payload));
+    }
+    void log_change(ChangeKind kind) {
+        change_seq_++;
+        if (change_feed_) change_feed_->append(change_seq_, kind, nullptr, 0);
+    }
+    
+    // clear() without logging
+    void reset_contents();
+    void build_locked();
+    
+    // Large arrays of the record store and temporal index
+    std::vector<MemoryRegion> memory_regions() const;
+    void advise_huge_pages() const;
+    
+    // Upsert without delivering standing-query callbacks
+    uint64_t apply_upsert(const ObjectUpdate& update);
+    
+    // Store and index one record, without delivering standing-query callbacks
+    uint64_t add_indexed(float lat, float lon, double t, double t_end, double value = 0.0);
+    
+    // Queue matches of a newly written record against standing queries
+    void match_standing(float lat, float lon, double t, double t_end, uint64_t id);
+    // With a callback set, detach queued matches from position `first` on
+    // for deliver_standing()
+    std::vector<StandingMatch> take_standing(size_t first);
+    // Hand detached matches to the callback, without holding mutex_
+    void deliver_standing(std::vector<StandingMatch> matches);
+    
+    // Run `write` under the exclusive lock, then deliver the standing
+    // matches it queued
+    template <typename Write>
+    auto write_and_deliver(Write&& write) {
+        std::vector<StandingMatch> matches;
+        auto result = [&] {
+            auto lock = write_lock();
+            size_t first = standing_matches_.size();
+            auto written = write();
+            matches = take_standing(first);
+            return written;
+        }();
+        deliver_standing(std::move(matches));
+        return result;
+    }
+    
+    // Hook for every mutation at (lat, lon)
+    void note_write(float lat, float lon);
+    
+    // Uncached query bodies
+    std::vector<uint64_t> radius_time_impl(float center_lat, float center_lon, double radius_km,
+                                           double t_start, double t_end) const;
+    std::vector<uint64_t> box_time_impl(float lat_min, float lon_min,
+                                        float lat_max, float lon_max,
+                                        double t_start, double t_end) const;
     
     // Shared filtering logic
     std::vector<uint64_t> filter_by_time(const std::vector<uint64_t>& spatial_ids,
@@ -0,0 +1,189 @@
+#ifndef SPATIO_SERVER_HPP
+#define SPATIO_SERVER_HPP
+
+#include "spatio_index_core.hpp"
+#include "server_protocol.hpp"
+#include "numa_topology.hpp"
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+namespace spatio {
+
+/**
+ * @brief Serves a SpatioIndexCore over the binary protocol of server_protocol.hpp
+ *
+ * One event-loop thread owns every socket (epoll, level-triggered). It
+ * reads whatever each readable connection has, cuts complete frames into
+ * the next batch and, while the previous batch is executing, keeps
+ * accumulating; so under load batches grow and the per-request cost of
+ * system calls and thread hand-offs shrinks. A batch is split into chunks
+ * that the worker pool executes in parallel; a batch containing writes
+ * runs in order on one worker instead, since the index is single-writer.
+ * The last worker to finish signals an eventfd, and the loop appends the
+ * responses to each connection's output in request order.
+ *
+ * Connections whose output backs up, or which arrive while the next batch
+ * is full, stop being read until things drain.
+ *
+ * With Config::numa on a multi-node machine, workers are spread over the
+ * NUMA nodes, pinned to their node's CPUs and allocate from its memory.
+ * The node the server is constructed on serves the index itself; every
+ * other node gets a replica, deserialized at the start of run() by a thread on that node so
+ * its pages are local. A worker always queries its own node's copy, so
+ * reads never cross the interconnect. Write batches run on every node, in
+ * order: the index answers, replicas apply only the writes and, starting
+ * from the same state, assign the same IDs. The cost is one copy of the
+ * index per extra node. On a single node (or with fewer than two workers)
+ * the option does nothing.
+ *
+ * Linux only (epoll, eventfd). While run() is active, the index must not be
+ * touched by anything else.
+ */
+class SpatioServer {
+public:
+    struct Config {
+        std::string unix_path;        // Unix domain socket path ("" = none)
+        int tcp_port = 0;             // TCP port on tcp_host (0 = none)
+        std::string tcp_host = "127.0.0.1";
+        size_t threads = 0;           // Workers; 0 = hardware concurrency
+        size_t max_batch = 8192;      // Requests per batch
+        size_t max_output = 8 << 20;  // Pending output bytes before a connection is paused
+        bool numa = false;            // Replica per NUMA node, workers pinned to their node
+    };
+
+    // Per serving node (one entry when NUMA placement is off)
+    struct NodeStats {
+        int node = 0;                 // NUMA node ID
+        size_t workers = 0;
+        bool replica = false;         // Serves a replica rather than the index
+        uint64_t requests = 0;        // Executed here (write batches run on every node)
+        uint64_t response_bytes = 0;
+        double busy_seconds = 0.0;    // Worker time spent executing
+        uint64_t local_pages = 0;     // Node's numastat local_node / other_node growth
+        uint64_t remote_pages = 0;    //   since construction (system-wide)
+    };
+
+    struct Stats {
+        uint64_t requests = 0;
+        uint64_t batches = 0;
+        uint64_t connections = 0;     // Accepted so far
+        uint64_t bad_requests = 0;
+        std::vector<NodeStats> nodes;
+    };
+
+    SpatioServer(SpatioIndexCore& index, const Config& config);
+    ~SpatioServer();
+
+    SpatioServer(const SpatioServer&) = delete;
+    SpatioServer& operator=(const SpatioServer&) = delete;
+
+    // Bind the listeners. Throws std::runtime_error on failure.
+    void listen();
+    // Serve until stop(); calls listen() first if needed
+    void run();
+    // Thread- and async-signal-safe
+    void stop();
+
+    Stats stats() const;
+
+private:
+    struct Connection;
+
+    struct Request {
+        uint64_t connection;
+        uint32_t tag;
+        uint8_t op;
+        uint8_t body_size;
+        alignas(8) char body[protocol::MAX_BODY_SIZE];
+    };
+
+    // Requests are executed in chunks of CHUNK; chunk c writes the
+    // responses of its requests back to back into outputs[c]
+    struct Batch {
+        std::vector<Request> requests;
+        std::vector<uint32_t> response_end;  // Offset past request i's response in its chunk
+        std::vector<std::string> outputs;
+        bool has_writes = false;
+    };
+    static constexpr size_t CHUNK = 64;
+
+    // A NUMA node serving requests, or the whole machine when placement is off
+    struct ServingNode {
+        numa::Node placement;
+        bool pinned = false;          // Workers pinned and memory preferred
+        SpatioIndexCore* index = nullptr;             // index_ or *replica
+        std::unique_ptr<SpatioIndexCore> replica;
+        size_t workers = 0;
+        bool write_pending = false;   // Guarded by work_mutex_
+        numa::PageCounts pages_start;
+        std::atomic<uint64_t> requests{0};
+        std::atomic<uint64_t> response_bytes{0};
+        std::atomic<uint64_t> busy_ns{0};
+    };
+
+    // Event loop
+    void add_watch(int fd, uint64_t key, uint32_t events);
+    void accept_all(int listener);
+    void on_readable(Connection& conn);
+    void on_writable(Connection& conn);
+    void parse_frames(Connection& conn);
+    bool flush(Connection& conn);  // false if the connection was closed
+    void update_interest(Connection& conn);
+    void close_connection(uint64_t id);
+    void submit_batch();
+    void finish_batch();
+    void resume_paused();
+
+    // Workers
+    void place_nodes();
+    void build_replicas();
+    void worker_loop(ServingNode& node);
+    void execute_unit(size_t unit, ServingNode& node);
+    void execute_chunk(Batch& batch, size_t chunk, SpatioIndexCore& index);
+    void execute(const Request& request, std::string& out, SpatioIndexCore& index);
+
+    SpatioIndexCore& index_;
+    Config config_;
+    int epoll_fd_ = -1;
+    int stop_fd_ = -1;   // eventfd: stop()
+    int done_fd_ = -1;   // eventfd: a batch finished
+    std::vector<int> listeners_;
+    bool listening_ = false;
+
+    std::unordered_map<uint64_t, std::unique_ptr<Connection>> connections_;
+    std::vector<uint64_t> paused_;   // Connections not read while the next batch is full
+    uint64_t next_connection_ = 1;
+
+    Batch batches_[2];               // Filling and executing; swapped on submit
+    Batch* filling_ = &batches_[0];
+    Batch* executing_ = nullptr;
+
+    // Work hand-off: workers claim units of executing_ under work_mutex_;
+    // a read batch's chunks go to any worker, a write batch to one worker
+    // per node
+    std::vector<std::unique_ptr<ServingNode>> nodes_;
+    std::vector<std::thread> workers_;
+    std::mutex work_mutex_;
+    std::condition_variable work_cv_;
+    size_t units_ = 0;
+    size_t next_unit_ = 0;
+    size_t units_left_ = 0;
+    bool stopping_ = false;
+
+    std::atomic<uint64_t> requests_{0};
+    std::atomic<uint64_t> batches_done_{0};
+    std::atomic<uint64_t> accepted_{0};
+    std::atomic<uint64_t> bad_requests_{0};
+};
+
+} // namespace spatio
+
+#endif // SPATIO_SERVER_HPP
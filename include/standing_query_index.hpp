@@ -0,0 +1,114 @@
+#ifndef STANDING_QUERY_INDEX_HPP
+#define STANDING_QUERY_INDEX_HPP
+
+#include <vector>
+#include <unordered_map>
+#include <utility>
+#include <cstdint>
+#include <limits>
+#include <cstddef>
+
+namespace spatio {
+
+/**
+ * @brief Region of a standing (continuous) query: a circle or a box
+ */
+struct StandingQuery {
+    enum class Shape { Circle, Box };
+
+    Shape shape = Shape::Box;
+    // Circle: (lat_a, lon_a) is the center. Box: a = min corner, b = max corner.
+    float lat_a = 0.0f, lon_a = 0.0f;
+    float lat_b = 0.0f, lon_b = 0.0f;
+    double radius_km = 0.0;
+
+    static StandingQuery circle(float center_lat, float center_lon, double radius_km);
+    static StandingQuery box(float lat_min, float lon_min, float lat_max, float lon_max);
+
+    bool contains(float lat, float lon) const;
+};
+
+// A delivered match: (standing query handle, record ID)
+using StandingMatch = std::pair<uint64_t, uint64_t>;
+
+/**
+ * @brief Index of standing query regions ("an index of queries")
+ *
+ * Registered regions are bucketed into a hierarchy of lat/lon grids, each
+ * LEVEL_FANOUT times coarser than the one below, starting at cell_deg. A
+ * region goes into the finest level where its bounding box spans at most
+ * LEVEL_FANOUT cells per axis, so it is referenced from at most
+ * LEVEL_FANOUT^2 cells whatever its size. An incoming record probes one
+ * cell per occupied level and exact-tests the regions registered there.
+ */
+class StandingQueryIndex {
+public:
+    explicit StandingQueryIndex(double cell_deg = 0.01);
+    
+    // Re-bucket every registered region for a new finest cell size; handles
+    // are kept
+    void set_cell_size(double cell_deg);
+    double cell_size() const { return cell_deg_; }
+
+    uint64_t add(const StandingQuery& query,
+                 double t_start = std::numeric_limits<double>::lowest(),
+                 double t_end = std::numeric_limits<double>::max());
+
+    // Returns false for unknown handles
+    bool remove(uint64_t handle);
+
+    // Append the handles of every standing query matching the record
+    void match(float lat, float lon, double t, std::vector<uint64_t>& handles) const {
+        match(lat, lon, t, t, handles);
+    }
+
+    // Interval records match when [t, t_end] overlaps the query's window
+    void match(float lat, float lon, double t, double t_end,
+               std::vector<uint64_t>& handles) const;
+
+    size_t size() const { return queries_.size(); }
+    void clear();
+
+private:
+    static constexpr long LEVEL_FANOUT = 4;
+
+    // Copied into each of the (at most LEVEL_FANOUT^2) cells the region
+    // covers so matching never leaves the cell. The bounding box rejects
+    // most candidates before the exact (haversine) test
+    struct CellEntry {
+        StandingQuery query;
+        float lat_min, lat_max;
+        float lon_min, lon_max;
+        double t_start;
+        double t_end;
+        uint64_t handle;
+    };
+
+    struct Entry {
+        CellEntry cell_entry;
+        size_t level;
+        long lat_cell_min, lat_cell_max;
+        long lon_cell_min, lon_cell_max;
+    };
+
+    struct Level {
+        double cell_deg;
+        size_t regions = 0;
+        std::unordered_map<uint64_t, std::vector<CellEntry>> cells;
+    };
+
+    // Choose the level for entry.cell_entry and add it to that level's cells
+    void place(Entry& entry);
+    void reset_levels();
+    static long cell_of(double deg, double cell_deg);
+    static uint64_t cell_key(long lat_cell, long lon_cell);
+
+    double cell_deg_;
+    uint64_t next_handle_ = 1;
+    std::unordered_map<uint64_t, Entry> queries_;
+    std::vector<Level> levels_;
+};
+
+} // namespace spatio
+
+#endif // STANDING_QUERY_INDEX_HPP
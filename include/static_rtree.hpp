@@ -0,0 +1,186 @@
+#ifndef STATIC_RTREE_HPP
+#define STATIC_RTREE_HPP
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstddef>
+#include <limits>
+
+namespace spatio {
+
+/**
+ * @brief Axis-aligned box in D dimensions
+ */
+template <int D>
+struct RTreeBox {
+    double lo[D];
+    double hi[D];
+
+    static RTreeBox empty() {
+        RTreeBox box;
+        for (int d = 0; d < D; d++) {
+            box.lo[d] = std::numeric_limits<double>::max();
+            box.hi[d] = std::numeric_limits<double>::lowest();
+        }
+        return box;
+    }
+
+    void expand(const RTreeBox& other) {
+        for (int d = 0; d < D; d++) {
+            lo[d] = std::min(lo[d], other.lo[d]);
+            hi[d] = std::max(hi[d], other.hi[d]);
+        }
+    }
+
+    // Branch-free: tree traversal tests many boxes with unpredictable outcomes
+    bool overlaps(const RTreeBox& other) const {
+        bool result = true;
+        for (int d = 0; d < D; d++) {
+            result &= (hi[d] >= other.lo[d]) & (lo[d] <= other.hi[d]);
+        }
+        return result;
+    }
+
+    double center(int d) const { return 0.5 * (lo[d] + hi[d]); }
+};
+
+/**
+ * @brief Read-only R-tree bulk loaded with Sort-Tile-Recursive packing
+ *
+ * Nodes live in one flat array, level by level, with the root last. Leaves
+ * reference item indices (positions in the vector passed to build()), so
+ * callers keep their payloads in their own arrays.
+ */
+template <int D, size_t NodeCapacity = 16>
+class StaticRTree {
+public:
+    void build(const std::vector<RTreeBox<D>>& boxes) {
+        clear();
+        if (boxes.empty()) return;
+
+        std::vector<uint32_t> order(boxes.size());
+        for (uint32_t i = 0; i < order.size(); i++) order[i] = i;
+        str_sort(order.begin(), order.end(), 0, boxes);
+        items_ = order;
+        item_boxes_.reserve(order.size());
+        for (uint32_t i : order) item_boxes_.push_back(boxes[i]);
+
+        // Leaf level over items (already in STR order)
+        uint32_t level_begin = 0;
+        for (size_t i = 0; i < items_.size(); i += NodeCapacity) {
+            Node node{RTreeBox<D>::empty(), static_cast<uint32_t>(i),
+                      static_cast<uint32_t>(std::min(NodeCapacity, items_.size() - i)), true};
+            for (uint32_t j = 0; j < node.count; j++) {
+                node.box.expand(boxes[items_[i + j]]);
+            }
+            nodes_.push_back(node);
+        }
+
+        // Pack upper levels until a single root remains
+        while (nodes_.size() - level_begin > 1) {
+            uint32_t level_end = static_cast<uint32_t>(nodes_.size());
+            size_t level_size = level_end - level_begin;
+
+            // Reorder this level in place so each parent's children are contiguous
+            std::vector<RTreeBox<D>> level_boxes;
+            level_boxes.reserve(level_size);
+            for (uint32_t n = level_begin; n < level_end; n++) level_boxes.push_back(nodes_[n].box);
+            std::vector<uint32_t> local(level_size);
+            for (uint32_t i = 0; i < local.size(); i++) local[i] = i;
+            str_sort(local.begin(), local.end(), 0, level_boxes);
+
+            std::vector<Node> reordered;
+            reordered.reserve(level_size);
+            for (uint32_t i : local) reordered.push_back(nodes_[level_begin + i]);
+            std::copy(reordered.begin(), reordered.end(), nodes_.begin() + level_begin);
+
+            for (size_t i = 0; i < level_size; i += NodeCapacity) {
+                Node node{RTreeBox<D>::empty(), static_cast<uint32_t>(level_begin + i),
+                          static_cast<uint32_t>(std::min(NodeCapacity, level_size - i)), false};
+                for (uint32_t j = 0; j < node.count; j++) {
+                    node.box.expand(nodes_[node.first + j].box);
+                }
+                nodes_.push_back(node);
+            }
+            level_begin = level_end;
+        }
+        root_ = level_begin;
+    }
+
+    // Calls visit(item_index) for every item whose box overlaps `query`
+    template <typename Visitor>
+    void query(const RTreeBox<D>& query, Visitor&& visit) const {
+        if (nodes_.empty() || !nodes_[root_].box.overlaps(query)) return;
+
+        // Children are tested before being pushed, so popped nodes always overlap.
+        // Depth is at most ~8 for 32-bit item counts; 256 slots cover the fan-out
+        uint32_t stack[256];
+        size_t top = 0;
+        stack[top++] = root_;
+        while (top > 0) {
+            const Node& node = nodes_[stack[--top]];
+            if (node.leaf) {
+                for (uint32_t j = node.first; j < node.first + node.count; j++) {
+                    if (item_boxes_[j].overlaps(query)) visit(items_[j]);
+                }
+            } else {
+                for (uint32_t j = 0; j < node.count; j++) {
+                    if (nodes_[node.first + j].box.overlaps(query)) {
+                        stack[top++] = node.first + j;
+                    }
+                }
+            }
+        }
+    }
+
+    size_t size() const { return items_.size(); }
+    size_t node_count() const { return nodes_.size(); }
+
+    void clear() {
+        nodes_.clear();
+        items_.clear();
+        item_boxes_.clear();
+        root_ = 0;
+    }
+
+private:
+    struct Node {
+        RTreeBox<D> box;
+        uint32_t first;   // Leaf: offset into items_. Internal: first child node.
+        uint32_t count;
+        bool leaf;
+    };
+
+    // Sort-Tile-Recursive: sort by dimension d, cut into slabs, recurse on d+1
+    template <typename It>
+    static void str_sort(It begin, It end, int d, const std::vector<RTreeBox<D>>& boxes) {
+        size_t n = static_cast<size_t>(end - begin);
+        std::sort(begin, end, [&](uint32_t a, uint32_t b) {
+            return boxes[a].center(d) < boxes[b].center(d);
+        });
+        if (d == D - 1 || n <= NodeCapacity) return;
+
+        double pages = std::ceil(static_cast<double>(n) / NodeCapacity);
+        size_t slabs = static_cast<size_t>(std::ceil(std::pow(pages, 1.0 / (D - d))));
+        size_t per_slab = static_cast<size_t>(
+            std::ceil(static_cast<double>(n) / static_cast<double>(slabs)));
+        // Keep slab boundaries aligned to node capacity
+        per_slab = ((per_slab + NodeCapacity - 1) / NodeCapacity) * NodeCapacity;
+
+        for (size_t i = 0; i < n; i += per_slab) {
+            It slab_end = begin + static_cast<std::ptrdiff_t>(std::min(n, i + per_slab));
+            str_sort(begin + static_cast<std::ptrdiff_t>(i), slab_end, d + 1, boxes);
+        }
+    }
+
+    std::vector<Node> nodes_;
+    std::vector<uint32_t> items_;
+    std::vector<RTreeBox<D>> item_boxes_;  // Parallel to items_
+    uint32_t root_ = 0;
+};
+
+} // namespace spatio
+
+#endif // STATIC_RTREE_HPP
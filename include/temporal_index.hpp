@@ -1,18 +1,48 @@
 #ifndef TEMPORAL_INDEX_HPP
 #define TEMPORAL_INDEX_HPP
 
+#include "eytzinger_layout.hpp"
+#include "serialization.hpp"
+#include "huge_pages.hpp"
+#include <set>
 #include <map>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 #include <cstdint>
 #include <limits>
+#include <cstddef>
 
 namespace spatio {
 
 /**
- * @brief Temporal index using multimap for time-based queries
+ * @brief Temporal index using an ordered set for time-based queries
  * 
- * Uses std::multimap to maintain records sorted by timestamp,
- * enabling efficient range queries.
+ * Keeps (timestamp, ID) pairs sorted, enabling efficient range queries;
+ * ordering ties by ID lets a single entry be found in O(log n) even when
+ * many records share a timestamp.
+ * 
+ * Interval records are kept sorted by start in duration classes (powers of
+ * two). Within a class every interval overlapping [t_start, t_end] starts in
+ * [t_start - max_duration, t_end]; since durations in a class differ by less
+ * than 2x, only that short lead-in window can yield non-matches.
+ * 
+ * build() compacts the instants into sorted columns; the set then only
+ * holds writes made since (a delta). With the learned model enabled, a
+ * piecewise-linear model of position-by-timestamp with bounded error is
+ * fitted to the columns, so locating a range start costs a lookup in a
+ * small segment table plus a search over 2 * MODEL_ERROR entries instead of
+ * a full binary search. Without it, lookups go through an Eytzinger copy of
+ * the timestamps.
+ * 
+ * In append ingest mode, instants arriving in (t, ID) order are appended to
+ * the columns (searched by plain binary search past the last build()).
+ * Out-of-order instants no older than the watermark (latest appended time
+ * minus the allowed lateness) wait in a small sorted buffer, which is merged
+ * into the column tail once the watermark has passed its oldest entry and
+ * advanced by at least the lateness since the previous merge. A merge only
+ * rewrites the tail newer than the buffer, so in-order data costs O(1)
+ * amortized. Instants older than the watermark go to the ordered set.
  */
 class TemporalIndex {
 public:
@@ -25,7 +55,67 @@ public:
     void insert(double t, uint64_t id);
 
     /**
-     * @brief Find all IDs within a time range
+     * @brief Enable append ingest mode with the given allowed lateness
+     * 
+     * Instants later than `lateness` behind the newest appended one still
+     * get indexed, through the ordered set.
+     */
+    void enable_append_ingest(double lateness);
+    
+    /**
+     * @brief Leave append ingest mode; the late buffer is merged first
+     */
+    void disable_append_ingest();
+    bool append_ingest_enabled() const { return append_ingest_; }
+    
+    struct IngestStats {
+        size_t appended = 0;        // In-order fast path
+        size_t buffered_late = 0;   // Out of order, within the lateness
+        size_t too_late = 0;        // Behind the watermark
+        size_t merges = 0;          // Late-buffer merges into the columns
+        size_t pending_late = 0;    // Currently waiting in the late buffer
+        double watermark = std::numeric_limits<double>::lowest();
+    };
+    IngestStats ingest_stats() const;
+
+    /**
+     * @brief Insert an interval record active during [t_begin, t_end]
+     */
+    void insert_interval(double t_begin, double t_end, uint64_t id);
+
+    /**
+     * @brief Change the timestamp of an existing entry (moving objects)
+     * 
+     * Reuses the set node, so no allocation. Time bounds only grow; they
+     * stay valid as conservative bounds.
+     * 
+     * @return false if (old_t, id) was not present
+     */
+    bool update(double old_t, double new_t, uint64_t id);
+
+    /**
+     * @brief Compact instants into sorted columns and refit the learned model
+     * 
+     * Entries written afterwards stay in the ordered set until the next build().
+     */
+    void build();
+
+    /**
+     * @brief Enable the learned model for column lookups (off by default)
+     * 
+     * Takes effect at the next build(). If the fitted model needs more than
+     * one segment per MIN_KEYS_PER_SEGMENT distinct timestamps (data far
+     * from piecewise linear), it is dropped and lookups use the Eytzinger copy.
+     */
+    void set_learned_model(bool enabled) { learned_model_enabled_ = enabled; }
+    bool learned_model_active() const { return !segments_.empty(); }
+    size_t model_segments() const { return segments_.size(); }
+
+    /**
+     * @brief Find all IDs active within a time range
+     * 
+     * Instants match when they fall inside the range, intervals when they
+     * overlap it.
      * 
      * @param t_start Start of time range (inclusive)
      * @param t_end End of time range (inclusive)
@@ -33,6 +123,18 @@ public:
      */
     std::vector<uint64_t> range_query(double t_start, double t_end) const;
 
+    /**
+     * @brief Count IDs active within a time range without materializing them
+     * 
+     * Compacted entries are counted by rank arithmetic: instants as
+     * rank(t_end) - rank(t_start), intervals as #(start <= t_end) minus
+     * #(end < t_start), and tombstones through a Fenwick tree. Instants
+     * written since the last build() are counted by walking their range of
+     * the ordered maps; intervals written since are scanned in full, so
+     * call build() before counting heavily after many interval writes.
+     */
+    size_t count_range(double t_start, double t_end) const;
+
     /**
      * @brief Get all record IDs in the index
      * 
@@ -48,7 +150,7 @@ public:
     double min_time() const { return min_time_; }
 
     /**
-     * @brief Get the maximum timestamp in the index
+     * @brief Get the maximum timestamp (latest interval end) in the index
      * 
      * @return The maximum timestamp
      */
@@ -59,15 +161,105 @@ public:
      */
     void clear();
 
+    /**
+     * @brief Write the columns, model, buffers and interval classes as raw arrays
+     * 
+     * deserialize() replaces the contents. Only the Eytzinger search copy
+     * is re-derived (a linear pass); ordered sets are refilled in order.
+     */
+    void serialize(ByteWriter& out) const;
+    void deserialize(ByteReader& in);
+
+    /**
+     * @brief Append the column arrays (times, IDs, search copy, interval
+     * starts and ends) for huge-page advice and prefaulting
+     */
+    void memory_regions(std::vector<MemoryRegion>& out) const;
+
     /**
      * @brief Get number of entries in the index
      */
-    size_t size() const { return time_index_.size(); }
+    size_t size() const {
+        return time_index_.size() + late_.size() + (column_times_.size() - column_dead_count_) +
+               interval_count_;
+    }
 
 private:
-    std::multimap<double, uint64_t> time_index_;
+    using Entries = std::set<std::pair<double, uint64_t>>;
+    
+    static constexpr size_t MODEL_ERROR = 16;           // Max |predicted - true| position
+    static constexpr size_t MIN_KEYS_PER_SEGMENT = 64;
+    
+    // Position ~= pos + slope * (t - key) for key <= t < next segment's key
+    struct ModelSegment {
+        double slope;
+        double pos;
+    };
+    
+    // Intervals whose duration lies in [2^k, 2^(k+1)), keyed by (start, ID)
+    struct DurationClass {
+        std::map<std::pair<double, uint64_t>, double> ends;
+        double max_duration = 0.0;
+    };
+    
+    Entries time_index_;
+    
+    // Instants compacted by build(), sorted by (t, ID), followed by those
+    // appended since in ingest mode. Entries moved since are tombstoned
+    // rather than erased.
+    std::vector<double> column_times_;
+    std::vector<uint64_t> column_ids_;
+    std::vector<bool> column_dead_;
+    size_t column_dead_count_ = 0;
+    std::vector<uint32_t> dead_tree_;  // Fenwick tree over column_dead_ (1-based), built lazily
+    EytzingerLayout<double> column_search_;  // Built when the learned model is off
+    size_t indexed_ = 0;  // Column prefix covered by column_search_ / the model
+    
+    // Append ingest mode
+    bool append_ingest_ = false;
+    double lateness_ = 0.0;
+    Entries late_;  // Out-of-order instants within the lateness, sorted
+    double last_merge_watermark_ = std::numeric_limits<double>::lowest();
+    IngestStats ingest_stats_;
+    
+    // Learned model over column_times_; keys are kept apart from the segments
+    // so the segment search touches as few cache lines as possible
+    bool learned_model_enabled_ = false;
+    std::vector<double> segment_keys_;
+    std::vector<ModelSegment> segments_;
+    
+    std::map<int, DurationClass> interval_classes_;  // Keyed by k
+    size_t interval_count_ = 0;
+    
+    // Interval endpoints for counting: sorted columns as of build(), plus
+    // the (start, end) pairs inserted since
+    std::vector<double> interval_starts_;
+    std::vector<double> interval_ends_;
+    std::vector<std::pair<double, double>> interval_delta_;
+    std::unordered_map<uint64_t, Entries::iterator> tracked_;  // IDs updated before
     double min_time_ = std::numeric_limits<double>::max();
     double max_time_ = std::numeric_limits<double>::lowest();
+    
+    void fit_model();
+    // First column position with time >= t (or > t when `after`)
+    size_t column_lower_bound(double t, bool after) const;
+    // Same, within the prefix covered by the search copy or the model
+    size_t indexed_lower_bound(double t, bool after) const;
+    
+    // Append ingest mode: route one instant, and merge the late buffer
+    void ingest(double t, uint64_t id);
+    void append_column(double t, uint64_t id);
+    void merge_late();
+    double watermark() const {
+        return column_times_.empty() ? std::numeric_limits<double>::lowest()
+                                     : column_times_.back() - lateness_;
+    }
+    
+    bool kill_column_entry(double t, uint64_t id);
+    // Tombstones in column positions [0, end)
+    size_t dead_before(size_t end) const;
+    // Extend the Fenwick tree by one column position
+    void dead_tree_append(bool dead);
 };
 
 } // namespace spatio
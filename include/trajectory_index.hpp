@@ -0,0 +1,75 @@
+#ifndef TRAJECTORY_INDEX_HPP
+#define TRAJECTORY_INDEX_HPP
+
+#include "static_rtree.hpp"
+#include "eytzinger_layout.hpp"
+#include <vector>
+#include <tuple>
+#include <cstdint>
+#include <cstddef>
+
+namespace spatio {
+
+/**
+ * @brief Trajectory store with segment-level space-time queries
+ *
+ * Companion to SpatioIndexCore for GPS traces. Pings are grouped by object
+ * and ordered by time; consecutive pings of an object form a segment along
+ * which the position is linearly interpolated. build() bulk-loads an R-tree
+ * over the segments' (lat, lon, t) bounding boxes, so a box-time query only
+ * clips the few segments whose boxes overlap the query volume. This finds
+ * objects whose pings straddle the box without any ping falling inside it.
+ *
+ * Interpolation is linear in degrees (no antimeridian wrap).
+ */
+class TrajectoryIndex {
+public:
+    void add_point(uint64_t object_id, double lat, double lon, double t);
+
+    // Sort pings per object and bulk-load the segment R-tree.
+    // Queries before build() see nothing.
+    void build();
+
+    // Object IDs whose interpolated path enters the box during [t_start, t_end],
+    // sorted ascending. Objects with a single ping are treated as stationary.
+    std::vector<uint64_t> query_trajectories_box_time(double lat_min, double lon_min,
+                                                      double lat_max, double lon_max,
+                                                      double t_start, double t_end) const;
+
+    // Time-ordered (lat, lon, t) pings of one object (as of the last build())
+    std::vector<std::tuple<double, double, double>> trajectory(uint64_t object_id) const;
+
+    size_t point_count() const { return pending_.size(); }
+    size_t object_count() const { return object_ids_.size(); }
+    size_t segment_count() const { return rtree_.size(); }
+    bool is_built() const { return built_; }
+    void clear();
+
+private:
+    struct Ping {
+        uint64_t object_id;
+        double lat, lon, t;
+    };
+
+    // A segment runs from points_[first] to points_[first + 1]; for
+    // single-ping objects both ends are points_[first]
+    struct Segment {
+        uint32_t first;
+        uint32_t object;  // Index into object_ids_
+    };
+
+    bool segment_hits(const Segment& seg, const RTreeBox<3>& box) const;
+
+    std::vector<Ping> pending_;            // Insertion order, kept for rebuilds
+    std::vector<Ping> points_;             // Sorted by (object, t)
+    std::vector<uint64_t> object_ids_;     // Sorted; object i owns points_[object_offsets_[i] ..]
+    std::vector<uint32_t> object_offsets_; // object_ids_.size() + 1 entries
+    EytzingerLayout<uint64_t> object_search_;
+    std::vector<Segment> segments_;
+    StaticRTree<3> rtree_;
+    bool built_ = false;
+};
+
+} // namespace spatio
+
+#endif // TRAJECTORY_INDEX_HPP
@@ -2,11 +2,23 @@
 
 #define _USE_MATH_DEFINES
 #include <cmath>
+#include <algorithm>
 
 #ifndef M_PI
     #define M_PI 3.14159265358979323846
 #endif
 
+// Hot kernels built with -DSPATIO_DISPATCH are compiled twice, for
+// x86-64-v3 (AVX2, FMA, BMI) and the baseline ISA, and the loader picks one
+// on the running CPU (GNU ifunc). Put it on the definition only; a no-op
+// elsewhere and in LTO builds (see CMakeLists.txt)
+#if defined(SPATIO_DISPATCH) && defined(__x86_64__) && defined(__gnu_linux__) && \
+    defined(__GNUC__) && !defined(__clang__)
+    #define SPATIO_TARGET_CLONES __attribute__((target_clones("arch=x86-64-v3", "default")))
+#else
+    #define SPATIO_TARGET_CLONES
+#endif
+
 namespace spatio {
 
 // Calculate great-circle distance in meters
@@ -20,4 +32,41 @@ inline float haversine_distance(float lat1, float lon1, float lat2, float lon2)
     return R * 2 * std::atan2(std::sqrt(a), std::sqrt(1-a));
 }
 
+// Conservative lat/lon bounding box of a circle (ignores antimeridian wrap;
+// near the poles the longitude range opens up to the full [-180, 180])
+inline void radius_bbox(double lat, double lon, double radius_km,
+                        double& lat_min, double& lat_max,
+                        double& lon_min, double& lon_max) {
+    // 6371 km * pi / 180 (the haversine sphere), rounded down so the box
+    // also absorbs float rounding of the coordinates
+    const double KM_PER_DEG_LAT = 111.19;
+    double dlat = radius_km / KM_PER_DEG_LAT;
+    lat_min = std::max(-90.0, lat - dlat);
+    lat_max = std::min(90.0, lat + dlat);
+    double cos_lat = std::cos(std::max(std::fabs(lat_min), std::fabs(lat_max)) * M_PI / 180.0);
+    double dlon = cos_lat > 1e-6 ? radius_km / (KM_PER_DEG_LAT * cos_lat) : 360.0;
+    if (dlon >= 180.0) {
+        lon_min = -180.0;
+        lon_max = 180.0;
+    } else {
+        lon_min = lon - dlon;
+        lon_max = lon + dlon;
+    }
+}
+
+// Lower bound in meters on the distance from (lat, lon) to any point on the
+// other side of a KD split. For a meridian split this is the great-circle
+// distance to the meridian (a path along the parallel overestimates it), and
+// the far side also reaches around through the antimeridian.
+inline double split_distance_bound(float lat, float lon, bool by_lat, float split) {
+    const double R = 6371000.0;
+    if (by_lat) {
+        return R * std::fabs(static_cast<double>(lat) - split) * M_PI / 180.0;
+    }
+    double dlon = std::min(std::fabs(static_cast<double>(lon) - split),
+                           180.0 - std::fabs(static_cast<double>(lon)));
+    dlon = std::min(std::max(dlon, 0.0), 90.0) * M_PI / 180.0;  // 90: via the pole
+    return R * std::asin(std::min(1.0, std::cos(lat * M_PI / 180.0) * std::sin(dlon)));
+}
+
 } // namespace spatio
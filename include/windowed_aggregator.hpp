@@ -0,0 +1,97 @@
+#ifndef WINDOWED_AGGREGATOR_HPP
+#define WINDOWED_AGGREGATOR_HPP
+
+#include <vector>
+#include <unordered_map>
+#include <limits>
+#include <cstdint>
+#include <cstddef>
+#include "serialization.hpp"
+
+namespace spatio {
+
+// Event count and value sum of one grid cell over a window
+struct CellAggregate {
+    long lat_cell = 0;       // floor(lat / cell_deg)
+    long lon_cell = 0;       // floor(lon / cell_deg)
+    double lat_min = 0.0;    // South-west corner of the cell
+    double lon_min = 0.0;
+    uint64_t count = 0;
+    double sum = 0.0;
+};
+
+/**
+ * @brief Rolling per-cell counts and sums fed from the insert path
+ *
+ * Time is cut into buckets of bucket_width; a window is window_buckets
+ * consecutive buckets. Every cell owns a ring of 2 * window_buckets bucket
+ * slots, so the current (filling) tumbling window and the previous complete
+ * one are both retained. Slots are tagged with their bucket index and
+ * recycled lazily: a write into a slot holding an older bucket resets it,
+ * and reads ignore slots whose tag is not the bucket asked for. Nothing is
+ * ever swept.
+ *
+ * An event is dropped (and counted in late_events()) only if its slot
+ * already holds a newer bucket, i.e. it is more than a ring behind its cell.
+ */
+class WindowedAggregator {
+public:
+    struct Config {
+        double cell_deg = 0.01;       // Square cells, in degrees
+        double bucket_width = 60.0;   // Time units per bucket
+        size_t window_buckets = 5;    // Buckets per window
+    };
+
+    explicit WindowedAggregator(const Config& config);
+
+    // Account one event; returns false if it was too late to be kept
+    bool add(float lat, float lon, double t, double value = 0.0);
+
+    // Sliding window: the window_buckets buckets ending with the one
+    // containing `now`. Only cells with events in the window are returned.
+    std::vector<CellAggregate> sliding(float lat_min, float lon_min,
+                                       float lat_max, float lon_max, double now) const;
+
+    // Tumbling window: the bucket-aligned window containing `t`
+    std::vector<CellAggregate> tumbling(float lat_min, float lon_min,
+                                        float lat_max, float lon_max, double t) const;
+
+    const Config& config() const { return config_; }
+    size_t cell_count() const { return cell_lat_.size(); }
+    uint64_t late_events() const { return late_events_; }
+    void clear();
+
+    // Raw snapshot of the cells and their rings (not the config, which the
+    // owner writes and constructs with); deserialize() replaces the contents
+    void serialize(ByteWriter& out) const;
+    void deserialize(ByteReader& in);
+
+private:
+    struct Bucket {
+        int64_t index = std::numeric_limits<int64_t>::min();  // Bucket this slot currently holds
+        uint64_t count = 0;
+        double sum = 0.0;
+    };
+
+    int64_t bucket_of(double t) const;
+    long cell_of(double coord) const;
+    static uint64_t cell_key(long lat_cell, long lon_cell);
+
+    // Sum buckets [first, last] of every cell overlapping the box
+    std::vector<CellAggregate> aggregate(float lat_min, float lon_min,
+                                         float lat_max, float lon_max,
+                                         int64_t first, int64_t last) const;
+    void aggregate_cell(size_t cell, int64_t first, int64_t last,
+                        std::vector<CellAggregate>& out) const;
+
+    Config config_;
+    size_t ring_size_;
+    std::unordered_map<uint64_t, uint32_t> cell_index_;  // Cell key -> position
+    std::vector<long> cell_lat_, cell_lon_;
+    std::vector<Bucket> buckets_;   // ring_size_ slots per cell, cell-major
+    uint64_t late_events_ = 0;
+};
+
+} // namespace spatio
+
+#endif // WINDOWED_AGGREGATOR_HPP
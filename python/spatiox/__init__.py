@@ -29,14 +29,21 @@ Example:
 
 from typing import Any, List, Optional, Dict
 try:
-    from ._spatio_core import SpatioIndexCore, Record
+    from ._spatio_core import (SpatioIndexCore, Record, QueryCursor, PolygonIndex,
+                               TrajectoryIndex, SegmentedIndex, MappedIndex)
 except ImportError:
     # Module not built yet
     SpatioIndexCore = None
     Record = None
+    QueryCursor = None
+    PolygonIndex = None
+    TrajectoryIndex = None
+    SegmentedIndex = None
+    MappedIndex = None
 
 __version__ = "0.1.0"
-__all__ = ["SpatioIndex", "Record"]
+__all__ = ["SpatioIndex", "Record", "PolygonIndex", "TrajectoryIndex", "SegmentedIndex",
+           "MappedIndex"]
 
 
 class SpatioIndex:
@@ -84,6 +91,65 @@ class SpatioIndex:
             self._payloads[record_id] = payload
         return record_id
     
+    def insert_interval(self, lat: float, lon: float, t_begin: float, t_end: float,
+                        payload: Any = None) -> int:
+        """
+        Insert a record active during [t_begin, t_end] (a stay or session).
+        
+        Time-filtered queries return it when the interval overlaps the
+        query window, so one record replaces a start/end pair.
+        
+        Args:
+            lat: Latitude in degrees [-90, 90]
+            lon: Longitude in degrees [-180, 180]
+            t_begin: Start of the interval (inclusive)
+            t_end: End of the interval (inclusive); must not precede t_begin
+            payload: Optional user data to associate with this record
+        
+        Returns:
+            Unique record ID
+        
+        Example:
+            >>> stay_id = index.insert_interval(40.7128, -74.0060, 1634567890.0, 1634571490.0)
+        """
+        record_id = self._core.insert_interval(lat, lon, t_begin, t_end)
+        if payload is not None:
+            self._payloads[record_id] = payload
+        return record_id
+    
+    def upsert(self, object_id: int, lat: float, lon: float, t: float,
+               payload: Any = None) -> int:
+        """
+        Move a tracked object to its latest position (moving-object mode).
+        
+        Each object owns a single record that is updated in place, so queries
+        only see current positions. Updates older than the stored one are
+        ignored.
+        
+        Args:
+            object_id: Caller-chosen object key (e.g. vehicle ID)
+            lat: Latitude in degrees [-90, 90]
+            lon: Longitude in degrees [-180, 180]
+            t: Timestamp of the position fix
+            payload: Optional user data; replaces the previous payload
+        
+        Returns:
+            The object's record ID (stable across moves)
+        
+        Example:
+            >>> rid = index.upsert(42, 40.7128, -74.0060, 1634567890.0)
+            >>> index.upsert(42, 40.7130, -74.0057, 1634567895.0) == rid
+            True
+        """
+        record_id = self._core.upsert(object_id, lat, lon, t)
+        if payload is not None:
+            self._payloads[record_id] = payload
+        return record_id
+    
+    def object_id(self, record_id: int) -> Optional[int]:
+        """Object key of a record created by upsert(), or None"""
+        return self._core.object_for_record(record_id)
+    
     def query_radius_time(self, center_lat: float, center_lon: float, 
                          radius_km: float, t_start: float, t_end: float) -> List[int]:
         """
@@ -139,6 +205,57 @@ class SpatioIndex:
         """
         return self._core.query_box_time(lat_min, lon_min, lat_max, lon_max, t_start, t_end)
     
+    def sample_radius_time(self, center_lat: float, center_lon: float, radius_km: float,
+                           t_start: float, t_end: float, n: int, seed: int = 0) -> List[int]:
+        """
+        Draw a uniform random sample of up to ``n`` records within a radius
+        and time range, without fetching the full result.
+        
+        Returns fewer than ``n`` IDs only when fewer records match.
+        """
+        return self._core.sample_radius_time(center_lat, center_lon, radius_km,
+                                             t_start, t_end, n, seed)
+    
+    def sample_box_time(self, lat_min: float, lon_min: float,
+                        lat_max: float, lon_max: float,
+                        t_start: float, t_end: float, n: int, seed: int = 0) -> List[int]:
+        """
+        Draw a uniform random sample of up to ``n`` records within a bounding
+        box and time range. See sample_radius_time.
+        """
+        return self._core.sample_box_time(lat_min, lon_min, lat_max, lon_max,
+                                          t_start, t_end, n, seed)
+    
+    def iter_radius_time(self, center_lat: float, center_lon: float, radius_km: float,
+                         t_start: float, t_end: float,
+                         chunk_size: int = 65536) -> "QueryCursor":
+        """
+        Stream records within a radius and time range in NumPy chunks.
+        
+        Unlike query_radius_time, the result is never materialized as a
+        whole: each iteration produces at most ``chunk_size`` IDs as a
+        ``numpy.uint64`` array, with the GIL released while it is filled.
+        Requires NumPy.
+        
+        Example:
+            >>> for chunk in index.iter_radius_time(40.7589, -73.9851, 50.0, 0.0, 1e12):
+            ...     process(chunk)
+        """
+        return self._core.open_radius_cursor(center_lat, center_lon, radius_km,
+                                             t_start, t_end, chunk_size)
+    
+    def iter_box_time(self, lat_min: float, lon_min: float,
+                      lat_max: float, lon_max: float,
+                      t_start: float, t_end: float,
+                      chunk_size: int = 65536) -> "QueryCursor":
+        """
+        Stream records within a bounding box and time range in NumPy chunks.
+        
+        See iter_radius_time for the chunking semantics.
+        """
+        return self._core.open_box_cursor(lat_min, lon_min, lat_max, lon_max,
+                                          t_start, t_end, chunk_size)
+    
     def get_record(self, record_id: int) -> Optional[Record]:
         """
         Get the Record object by ID.
@@ -172,6 +289,41 @@ class SpatioIndex:
         """
         return self._core.size()
     
+    def save_mapped(self, path: str):
+        """
+        Write a read-only image that other processes attach with MappedIndex.
+        
+        Payloads stay in this process; the image holds records only.
+        
+        Args:
+            path: Image file; a path under /dev/shm keeps it in shared memory
+        """
+        self._core.save_mapped(path)
+    
+    def set_huge_pages(self, enabled: bool):
+        """
+        Back the large index arrays with transparent huge pages.
+        
+        Applies from the next build; fewer TLB misses on big indexes.
+        
+        Args:
+            enabled: Whether to advise huge pages
+        """
+        self._core.set_huge_pages(enabled)
+    
+    def warmup(self, tree_levels: int = 18):
+        """
+        Fault the index in and read the upper KD-tree levels, so the first
+        queries after a load do not pay for page faults.
+        
+        Args:
+            tree_levels: KD-tree levels to read
+        
+        Returns:
+            WarmupStats (prefaulted_bytes, touched_nodes, seconds)
+        """
+        return self._core.warmup(tree_levels)
+    
     def clear(self):
         """
         Clear all records and payloads from the index.
@@ -13,6 +13,17 @@ ext_modules = [
             "src/spatial_index.cpp",
             "src/temporal_index.cpp",
             "src/spatio_index_core.cpp",
+            "src/query_cursor.cpp",
+            "src/query_cache.cpp",
+            "src/standing_query_index.cpp",
+            "src/polygon_index.cpp",
+            "src/trajectory_index.cpp",
+            "src/cell_time_counts.cpp",
+            "src/windowed_aggregator.cpp",
+            "src/segmented_index.cpp",
+            "src/mapped_index.cpp",
+            "src/change_feed.cpp",
+            "src/huge_pages.cpp",
             "src/bindings.cpp",
         ],
         include_dirs=[
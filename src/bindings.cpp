@@ -1,6 +1,12 @@
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
+#include <pybind11/numpy.h>
+#include <pybind11/functional.h>
 #include "spatio_index_core.hpp"
+#include "polygon_index.hpp"
+#include "trajectory_index.hpp"
+#include "segmented_index.hpp"
+#include "mapped_index.hpp"
 #include "record.hpp"
 
 namespace py = pybind11;
@@ -13,9 +19,12 @@ PYBIND11_MODULE(_spatio_core, m) {
     py::class_<spatio::RecordInput>(m, "RecordInput")
         .def(py::init<float, float, double>(),
              py::arg("lat"), py::arg("lon"), py::arg("t"))
+        .def(py::init<float, float, double, double>(),
+             py::arg("lat"), py::arg("lon"), py::arg("t"), py::arg("t_end"))
         .def_readwrite("lat", &spatio::RecordInput::lat)
         .def_readwrite("lon", &spatio::RecordInput::lon)
-        .def_readwrite("t", &spatio::RecordInput::t);
+        .def_readwrite("t", &spatio::RecordInput::t)
+        .def_readwrite("t_end", &spatio::RecordInput::t_end);
 
     py::class_<spatio::Record>(m, "Record")
         .def(py::init<>())
@@ -25,13 +34,28 @@ PYBIND11_MODULE(_spatio_core, m) {
         .def_readwrite("lon", &spatio::Record::lon)
         .def_readwrite("t", &spatio::Record::t)
         .def_readwrite("id", &spatio::Record::id)
+        .def_readwrite("t_end", &spatio::Record::t_end)
+        .def("active_during", &spatio::Record::active_during,
+             py::arg("t_start"), py::arg("t_end"))
         .def("__repr__", [](const spatio::Record &r) {
             return "Record(lat=" + std::to_string(r.lat) + 
                    ", lon=" + std::to_string(r.lon) +
                    ", t=" + std::to_string(r.t) +
+                   (r.t_end != r.t ? ", t_end=" + std::to_string(r.t_end) : std::string()) +
                    ", id=" + std::to_string(r.id) + ")";
         });
 
+    py::class_<spatio::StandingQuery>(m, "StandingQuery")
+        .def_static("circle", &spatio::StandingQuery::circle,
+                    py::arg("center_lat"), py::arg("center_lon"), py::arg("radius_km"),
+                    "Circular standing query region")
+        .def_static("box", &spatio::StandingQuery::box,
+                    py::arg("lat_min"), py::arg("lon_min"),
+                    py::arg("lat_max"), py::arg("lon_max"),
+                    "Bounding box standing query region")
+        .def("contains", &spatio::StandingQuery::contains,
+             py::arg("lat"), py::arg("lon"));
+
     // ==================== STATISTICS ====================
     
     py::class_<spatio::SpatioIndexCore::IndexStats>(m, "IndexStats")
@@ -40,6 +64,7 @@ PYBIND11_MODULE(_spatio_core, m) {
         .def_readonly("temporal_entries", &spatio::SpatioIndexCore::IndexStats::temporal_entries)
         .def_readonly("min_time", &spatio::SpatioIndexCore::IndexStats::min_time)
         .def_readonly("max_time", &spatio::SpatioIndexCore::IndexStats::max_time)
+        .def_readonly("temporal_model_segments", &spatio::SpatioIndexCore::IndexStats::temporal_model_segments)
         .def_readonly("is_built", &spatio::SpatioIndexCore::IndexStats::is_built)
         .def("__repr__", [](const spatio::SpatioIndexCore::IndexStats &s) {
             return "IndexStats(records=" + std::to_string(s.total_records) + 
@@ -49,6 +74,43 @@ PYBIND11_MODULE(_spatio_core, m) {
                    std::string(s.is_built ? "True" : "False") + ")";
         });
 
+    py::class_<spatio::WarmupStats>(m, "WarmupStats")
+        .def_readonly("prefaulted_bytes", &spatio::WarmupStats::prefaulted_bytes)
+        .def_readonly("touched_nodes", &spatio::WarmupStats::touched_nodes)
+        .def_readonly("seconds", &spatio::WarmupStats::seconds)
+        .def("__repr__", [](const spatio::WarmupStats &s) {
+            return "WarmupStats(prefaulted_bytes=" + std::to_string(s.prefaulted_bytes) +
+                   ", touched_nodes=" + std::to_string(s.touched_nodes) +
+                   ", seconds=" + std::to_string(s.seconds) + ")";
+        });
+
+    py::class_<spatio::TemporalIndex::IngestStats>(m, "IngestStats")
+        .def_readonly("appended", &spatio::TemporalIndex::IngestStats::appended)
+        .def_readonly("buffered_late", &spatio::TemporalIndex::IngestStats::buffered_late)
+        .def_readonly("too_late", &spatio::TemporalIndex::IngestStats::too_late)
+        .def_readonly("merges", &spatio::TemporalIndex::IngestStats::merges)
+        .def_readonly("pending_late", &spatio::TemporalIndex::IngestStats::pending_late)
+        .def_readonly("watermark", &spatio::TemporalIndex::IngestStats::watermark)
+        .def("__repr__", [](const spatio::TemporalIndex::IngestStats &s) {
+            return "IngestStats(appended=" + std::to_string(s.appended) +
+                   ", buffered_late=" + std::to_string(s.buffered_late) +
+                   ", too_late=" + std::to_string(s.too_late) +
+                   ", merges=" + std::to_string(s.merges) +
+                   ", pending_late=" + std::to_string(s.pending_late) + ")";
+        });
+
+    py::class_<spatio::ChangeFeed::Stats>(m, "ChangeFeedStats")
+        .def_readonly("appended", &spatio::ChangeFeed::Stats::appended)
+        .def_readonly("batches", &spatio::ChangeFeed::Stats::batches)
+        .def_readonly("dropped", &spatio::ChangeFeed::Stats::dropped)
+        .def_readonly("pending_bytes", &spatio::ChangeFeed::Stats::pending_bytes)
+        .def("__repr__", [](const spatio::ChangeFeed::Stats &s) {
+            return "ChangeFeedStats(appended=" + std::to_string(s.appended) +
+                   ", batches=" + std::to_string(s.batches) +
+                   ", dropped=" + std::to_string(s.dropped) +
+                   ", pending_bytes=" + std::to_string(s.pending_bytes) + ")";
+        });
+
     py::class_<spatio::QueryStats>(m, "QueryStats")
         .def_readonly("spatial_nodes_visited", &spatio::QueryStats::spatial_nodes_visited)
         .def_readonly("spatial_distance_checks", &spatio::QueryStats::spatial_distance_checks)
@@ -65,6 +127,88 @@ PYBIND11_MODULE(_spatio_core, m) {
                    ", results=" + std::to_string(s.result_count) + ")";
         });
 
+    py::class_<spatio::QueryCacheStats>(m, "QueryCacheStats")
+        .def_readonly("hits", &spatio::QueryCacheStats::hits)
+        .def_readonly("misses", &spatio::QueryCacheStats::misses)
+        .def_readonly("stale", &spatio::QueryCacheStats::stale)
+        .def_readonly("evictions", &spatio::QueryCacheStats::evictions)
+        .def_readonly("entries", &spatio::QueryCacheStats::entries)
+        .def_readonly("bytes", &spatio::QueryCacheStats::bytes)
+        .def_readonly("max_bytes", &spatio::QueryCacheStats::max_bytes)
+        .def("__repr__", [](const spatio::QueryCacheStats &s) {
+            return "QueryCacheStats(hits=" + std::to_string(s.hits) +
+                   ", misses=" + std::to_string(s.misses) +
+                   ", stale=" + std::to_string(s.stale) +
+                   ", evictions=" + std::to_string(s.evictions) +
+                   ", entries=" + std::to_string(s.entries) +
+                   ", bytes=" + std::to_string(s.bytes) + ")";
+        });
+
+    py::class_<spatio::ApproxCount>(m, "ApproxCount")
+        .def_readonly("count", &spatio::ApproxCount::count)
+        .def_readonly("lower_bound", &spatio::ApproxCount::lower_bound)
+        .def_readonly("upper_bound", &spatio::ApproxCount::upper_bound)
+        .def_readonly("epsilon", &spatio::ApproxCount::epsilon)
+        .def_readonly("nodes_visited", &spatio::ApproxCount::nodes_visited)
+        .def_property_readonly("error_bound", &spatio::ApproxCount::error_bound)
+        .def("__repr__", [](const spatio::ApproxCount &c) {
+            return "ApproxCount(count=" + std::to_string(c.count) +
+                   ", bounds=[" + std::to_string(c.lower_bound) + ", " +
+                   std::to_string(c.upper_bound) + "], error_bound=" +
+                   std::to_string(c.error_bound()) + ")";
+        });
+
+    py::class_<spatio::CellAggregate>(m, "CellAggregate")
+        .def_readonly("lat_cell", &spatio::CellAggregate::lat_cell)
+        .def_readonly("lon_cell", &spatio::CellAggregate::lon_cell)
+        .def_readonly("lat_min", &spatio::CellAggregate::lat_min)
+        .def_readonly("lon_min", &spatio::CellAggregate::lon_min)
+        .def_readonly("count", &spatio::CellAggregate::count)
+        .def_readonly("sum", &spatio::CellAggregate::sum)
+        .def("__repr__", [](const spatio::CellAggregate &c) {
+            return "CellAggregate(cell=(" + std::to_string(c.lat_cell) + ", " +
+                   std::to_string(c.lon_cell) + "), count=" + std::to_string(c.count) +
+                   ", sum=" + std::to_string(c.sum) + ")";
+        });
+
+    py::class_<spatio::ApproxKNNResult>(m, "ApproxKNNResult")
+        .def_readonly("ids", &spatio::ApproxKNNResult::ids)
+        .def_readonly("epsilon", &spatio::ApproxKNNResult::epsilon)
+        .def_readonly("achieved_epsilon", &spatio::ApproxKNNResult::achieved_epsilon)
+        .def("__repr__", [](const spatio::ApproxKNNResult &r) {
+            return "ApproxKNNResult(k=" + std::to_string(r.ids.size()) +
+                   ", achieved_epsilon=" + std::to_string(r.achieved_epsilon) + ")";
+        });
+
+    // ==================== STREAMING ====================
+    
+    py::class_<spatio::QueryCursor>(m, "QueryCursor")
+        .def("__iter__", [](py::object self) { return self; })
+        .def("__next__",
+             [](spatio::QueryCursor& self) {
+                 py::array_t<uint64_t> chunk(static_cast<py::ssize_t>(self.chunk_size()));
+                 uint64_t* out = chunk.mutable_data();
+                 size_t n;
+                 {
+                     // next_batch() holds the index lock shared; let other threads run
+                     py::gil_scoped_release release;
+                     n = self.next_batch(out, self.chunk_size());
+                 }
+                 if (n == 0) {
+                     throw py::stop_iteration();
+                 }
+                 if (n < self.chunk_size()) {
+                     chunk.resize({static_cast<py::ssize_t>(n)}, false);
+                 }
+                 return chunk;
+             },
+             "Next chunk of record IDs as a NumPy uint64 array")
+        .def_property_readonly("chunk_size", &spatio::QueryCursor::chunk_size)
+        .def_property_readonly("produced", &spatio::QueryCursor::produced,
+                               "Number of IDs produced so far")
+        .def("done", &spatio::QueryCursor::done,
+             "True once the traversal is exhausted");
+
     // ==================== MAIN INDEX CLASS ====================
     
     py::class_<spatio::SpatioIndexCore>(m, "SpatioIndexCore")
@@ -75,6 +219,14 @@ PYBIND11_MODULE(_spatio_core, m) {
              py::arg("lat"), py::arg("lon"), py::arg("t"),
              "Insert a single record (online/streaming path)")
         
+        .def("insert_interval", &spatio::SpatioIndexCore::insert_interval,
+             py::arg("lat"), py::arg("lon"), py::arg("t_begin"), py::arg("t_end"),
+             "Insert a record active during [t_begin, t_end]")
+        
+        .def("insert_value", &spatio::SpatioIndexCore::insert_value,
+             py::arg("lat"), py::arg("lon"), py::arg("t"), py::arg("value"),
+             "Insert a single record carrying a measurement for window sums")
+        
         .def("bulk_insert", 
              [](spatio::SpatioIndexCore& self, const std::vector<std::tuple<float, float, double>>& data) {
                  std::vector<spatio::RecordInput> records;
@@ -87,9 +239,70 @@ PYBIND11_MODULE(_spatio_core, m) {
              py::arg("records"),
              "Bulk insert from list of (lat, lon, t) tuples")
         
+        .def("bulk_insert_intervals",
+             [](spatio::SpatioIndexCore& self,
+                const std::vector<std::tuple<float, float, double, double>>& data) {
+                 std::vector<spatio::RecordInput> records;
+                 records.reserve(data.size());
+                 for (const auto& [lat, lon, t_begin, t_end] : data) {
+                     records.emplace_back(lat, lon, t_begin, t_end);
+                 }
+                 return self.bulk_insert(records);
+             },
+             py::arg("records"),
+             "Bulk insert from list of (lat, lon, t_begin, t_end) tuples")
+        
         .def("build", &spatio::SpatioIndexCore::build,
              "Explicit build phase")
         
+        .def("set_learned_temporal_index", &spatio::SpatioIndexCore::set_learned_temporal_index,
+             py::arg("enabled"),
+             "Use a piecewise-linear learned model for temporal lookups (applied at build())")
+        
+        .def("enable_append_ingest", &spatio::SpatioIndexCore::enable_append_ingest,
+             py::arg("lateness"),
+             "Append in-order instants; buffer pings up to `lateness` late until the watermark passes")
+        
+        .def("disable_append_ingest", &spatio::SpatioIndexCore::disable_append_ingest)
+        
+        .def("ingest_stats", &spatio::SpatioIndexCore::ingest_stats,
+             "Counters of the append ingest mode")
+        
+        // ===== MOVING OBJECTS =====
+        .def("upsert", &spatio::SpatioIndexCore::upsert,
+             py::arg("object_id"), py::arg("lat"), py::arg("lon"), py::arg("t"),
+             "Move an object to its latest position; returns its record ID")
+        
+        .def("bulk_upsert",
+             [](spatio::SpatioIndexCore& self,
+                py::array_t<uint64_t, py::array::c_style | py::array::forcecast> object_ids,
+                py::array_t<float, py::array::c_style | py::array::forcecast> lats,
+                py::array_t<float, py::array::c_style | py::array::forcecast> lons,
+                py::array_t<double, py::array::c_style | py::array::forcecast> ts) {
+                 py::ssize_t n = object_ids.size();
+                 if (lats.size() != n || lons.size() != n || ts.size() != n) {
+                     throw std::invalid_argument("object_ids, lats, lons and ts must have equal length");
+                 }
+                 std::vector<spatio::ObjectUpdate> updates;
+                 updates.reserve(static_cast<size_t>(n));
+                 const uint64_t* ids = object_ids.data();
+                 const float* lat = lats.data();
+                 const float* lon = lons.data();
+                 const double* t = ts.data();
+                 for (py::ssize_t i = 0; i < n; i++) {
+                     updates.emplace_back(ids[i], lat[i], lon[i], t[i]);
+                 }
+                 return self.bulk_upsert(updates);
+             },
+             py::arg("object_ids"), py::arg("lats"), py::arg("lons"), py::arg("ts"),
+             "Batched upsert from equal-length arrays")
+        
+        .def("record_for_object", &spatio::SpatioIndexCore::record_for_object,
+             py::arg("object_id"))
+        .def("object_for_record", &spatio::SpatioIndexCore::object_for_record,
+             py::arg("record_id"))
+        .def("object_count", &spatio::SpatioIndexCore::object_count)
+        
         // ===== SPATIAL-ONLY QUERIES =====
         .def("query_radius", &spatio::SpatioIndexCore::query_radius,
              py::arg("center_lat"), py::arg("center_lon"), py::arg("radius_km"),
@@ -121,6 +334,122 @@ PYBIND11_MODULE(_spatio_core, m) {
              py::arg("t_start"), py::arg("t_end"),
              "K-nearest neighbors with time filter")
         
+        // ===== STANDING QUERIES =====
+        .def("register_standing_query", &spatio::SpatioIndexCore::register_standing_query,
+             py::arg("shape"),
+             py::arg("t_start") = std::numeric_limits<double>::lowest(),
+             py::arg("t_end") = std::numeric_limits<double>::max(),
+             "Register a continuous query matched on every insert. Returns a handle")
+        
+        .def("unregister_standing_query", &spatio::SpatioIndexCore::unregister_standing_query,
+             py::arg("handle"),
+             "Remove a standing query. Returns False for unknown handles")
+        
+        .def("set_standing_callback", &spatio::SpatioIndexCore::set_standing_callback,
+             py::arg("callback"),
+             "Deliver matches as callback(handle, record_id); None switches back to the queue")
+        
+        .def("drain_standing_matches", &spatio::SpatioIndexCore::drain_standing_matches,
+             "Pop all queued (handle, record_id) matches")
+        
+        .def("standing_query_count", &spatio::SpatioIndexCore::standing_query_count,
+             "Number of registered standing queries")
+        
+        .def("set_standing_cell_size", &spatio::SpatioIndexCore::set_standing_cell_size,
+             py::arg("cell_deg"),
+             "Finest standing-query grid cell in degrees; registered queries are re-bucketed")
+        .def("standing_cell_size", &spatio::SpatioIndexCore::standing_cell_size)
+        
+        // ===== RESULT CACHE =====
+        .def("enable_query_cache",
+             [](spatio::SpatioIndexCore& self, size_t max_bytes, double coord_quantum,
+                double radius_quantum_km, double time_quantum, double partition_deg) {
+                 spatio::QueryCache::Config config;
+                 config.max_bytes = max_bytes;
+                 config.coord_quantum = coord_quantum;
+                 config.radius_quantum_km = radius_quantum_km;
+                 config.time_quantum = time_quantum;
+                 config.partition_deg = partition_deg;
+                 self.enable_query_cache(config);
+             },
+             py::arg("max_bytes") = 64 * 1024 * 1024,
+             py::arg("coord_quantum") = 0.0,
+             py::arg("radius_quantum_km") = 0.0,
+             py::arg("time_quantum") = 0.0,
+             py::arg("partition_deg") = 1.0,
+             "Enable the LRU result cache for radius/box + time queries")
+        
+        .def("disable_query_cache", &spatio::SpatioIndexCore::disable_query_cache,
+             "Disable and drop the result cache")
+        
+        .def("query_cache_stats", &spatio::SpatioIndexCore::query_cache_stats,
+             "Hit/miss counters and memory usage of the result cache")
+        
+        // ===== APPROXIMATE QUERIES =====
+        .def("count_time_range", &spatio::SpatioIndexCore::count_time_range,
+             py::arg("t_start"), py::arg("t_end"),
+             "Exact number of records active during [t_start, t_end]")
+        
+        .def("count_box_time", &spatio::SpatioIndexCore::count_box_time,
+             py::arg("lat_min"), py::arg("lon_min"), py::arg("lat_max"), py::arg("lon_max"),
+             py::arg("t_start"), py::arg("t_end"),
+             "Exact number of records in the box active during [t_start, t_end]")
+        
+        .def("enable_count_grid", &spatio::SpatioIndexCore::enable_count_grid,
+             py::arg("cell_deg") = 0.1,
+             "Keep per-cell temporal counters (built at build()) for count_box_time")
+        
+        .def("disable_count_grid", &spatio::SpatioIndexCore::disable_count_grid)
+        
+        .def("enable_window_aggregation",
+             [](spatio::SpatioIndexCore& self, double cell_deg, double bucket_width,
+                size_t window_buckets) {
+                 spatio::WindowedAggregator::Config config;
+                 config.cell_deg = cell_deg;
+                 config.bucket_width = bucket_width;
+                 config.window_buckets = window_buckets;
+                 self.enable_window_aggregation(config);
+             },
+             py::arg("cell_deg") = 0.01,
+             py::arg("bucket_width") = 60.0,
+             py::arg("window_buckets") = 5,
+             "Maintain per-cell rolling counts and sums for subsequent writes")
+        
+        .def("disable_window_aggregation", &spatio::SpatioIndexCore::disable_window_aggregation)
+        
+        .def("window_sliding", &spatio::SpatioIndexCore::window_sliding,
+             py::arg("lat_min"), py::arg("lon_min"), py::arg("lat_max"), py::arg("lon_max"),
+             py::arg("now"),
+             "Per-cell aggregates over the window_buckets buckets ending at `now`")
+        
+        .def("window_tumbling", &spatio::SpatioIndexCore::window_tumbling,
+             py::arg("lat_min"), py::arg("lon_min"), py::arg("lat_max"), py::arg("lon_max"),
+             py::arg("t"),
+             "Per-cell aggregates over the aligned window containing `t`")
+        
+        .def("count_radius_time_approx", &spatio::SpatioIndexCore::count_radius_time_approx,
+             py::arg("center_lat"), py::arg("center_lon"), py::arg("radius_km"),
+             py::arg("t_start"), py::arg("t_end"), py::arg("epsilon") = 0.02,
+             "Radius+time count within a certified relative error of epsilon")
+        
+        .def("query_knn_approx", &spatio::SpatioIndexCore::query_knn_approx,
+             py::arg("lat"), py::arg("lon"), py::arg("k"), py::arg("epsilon") = 0.1,
+             "(1+epsilon)-approximate K-nearest neighbors (no time filter)")
+        
+        // ===== SAMPLING =====
+        .def("sample_radius_time", &spatio::SpatioIndexCore::sample_radius_time,
+             py::arg("center_lat"), py::arg("center_lon"), py::arg("radius_km"),
+             py::arg("t_start"), py::arg("t_end"),
+             py::arg("n"), py::arg("seed") = 0,
+             "Uniform random sample of n records within radius and time range")
+        
+        .def("sample_box_time", &spatio::SpatioIndexCore::sample_box_time,
+             py::arg("lat_min"), py::arg("lon_min"),
+             py::arg("lat_max"), py::arg("lon_max"),
+             py::arg("t_start"), py::arg("t_end"),
+             py::arg("n"), py::arg("seed") = 0,
+             "Uniform random sample of n records within bounding box and time range")
+        
         // ===== INSTRUMENTED QUERIES =====
         .def("query_radius_time_instrumented",
              [](const spatio::SpatioIndexCore& self, float lat, float lon, double radius,
@@ -134,6 +463,24 @@ PYBIND11_MODULE(_spatio_core, m) {
              py::arg("t_start"), py::arg("t_end"),
              "Query with performance statistics. Returns (results, stats)")
         
+        // ===== STREAMING QUERIES =====
+        .def("open_radius_cursor", &spatio::SpatioIndexCore::open_radius_cursor,
+             py::arg("center_lat"), py::arg("center_lon"), py::arg("radius_km"),
+             py::arg("t_start") = std::numeric_limits<double>::lowest(),
+             py::arg("t_end") = std::numeric_limits<double>::max(),
+             py::arg("chunk_size") = spatio::QueryCursor::DEFAULT_CHUNK_SIZE,
+             py::keep_alive<0, 1>(),
+             "Iterator over radius(+time) matches yielding NumPy chunks of record IDs")
+        
+        .def("open_box_cursor", &spatio::SpatioIndexCore::open_box_cursor,
+             py::arg("lat_min"), py::arg("lon_min"),
+             py::arg("lat_max"), py::arg("lon_max"),
+             py::arg("t_start") = std::numeric_limits<double>::lowest(),
+             py::arg("t_end") = std::numeric_limits<double>::max(),
+             py::arg("chunk_size") = spatio::QueryCursor::DEFAULT_CHUNK_SIZE,
+             py::keep_alive<0, 1>(),
+             "Iterator over box(+time) matches yielding NumPy chunks of record IDs")
+        
         // ===== DATA ACCESS =====
         .def("get_record", &spatio::SpatioIndexCore::get_record,
              py::arg("id"),
@@ -142,10 +489,430 @@ PYBIND11_MODULE(_spatio_core, m) {
         .def("size", &spatio::SpatioIndexCore::size,
              "Get total number of records")
         
+        .def("save_mapped", &spatio::SpatioIndexCore::save_mapped,
+             py::arg("path"),
+             py::call_guard<py::gil_scoped_release>(),
+             "Write a read-only image for MappedIndex (e.g. under /dev/shm)")
+
+        // ===== MEMORY =====
+        .def("set_huge_pages", &spatio::SpatioIndexCore::set_huge_pages,
+             py::arg("enabled"),
+             "Back the large index arrays with transparent huge pages")
+        .def("huge_pages_enabled", &spatio::SpatioIndexCore::huge_pages_enabled)
+        // warmup() holds the index lock shared while the GIL is released
+        .def("warmup", &spatio::SpatioIndexCore::warmup,
+             py::arg("tree_levels") = 18,
+             py::call_guard<py::gil_scoped_release>(),
+             "Fault the index in and read the upper tree levels before serving")
+
+        // ===== CHANGE FEED =====
+        .def("enable_change_feed", &spatio::SpatioIndexCore::enable_change_feed,
+             py::arg("max_pending_bytes") = static_cast<size_t>(64) << 20,
+             "Log every mutation for replication; pending changes beyond the bound are dropped")
+        .def("disable_change_feed", &spatio::SpatioIndexCore::disable_change_feed)
+        .def("change_feed_enabled", &spatio::SpatioIndexCore::change_feed_enabled)
+        .def("take_changes",
+             [](spatio::SpatioIndexCore& self) {
+                 std::string batch;
+                 {
+                     py::gil_scoped_release release;
+                     batch = self.take_changes();
+                 }
+                 return py::bytes(batch);
+             },
+             "Pending changes as one binary batch (b'' if there are none)")
+        .def("apply_changes",
+             [](spatio::SpatioIndexCore& self, py::buffer batch) {
+                 py::buffer_info info = batch.request();
+                 if (info.ndim != 1 || info.strides[0] != info.itemsize) {
+                     throw std::invalid_argument("apply_changes expects a contiguous 1-D buffer");
+                 }
+                 // apply_changes() holds the index lock exclusively; standing
+                 // callbacks reacquire the GIL after it is released
+                 py::gil_scoped_release release;
+                 return self.apply_changes(static_cast<const char*>(info.ptr),
+                                           static_cast<size_t>(info.size * info.itemsize));
+             },
+             py::arg("batch"),
+             "Replay a batch from take_changes(); returns the number of changes applied")
+        .def("change_seq", &spatio::SpatioIndexCore::change_seq,
+             "Sequence number of the last mutation")
+        .def("change_feed_stats", &spatio::SpatioIndexCore::change_feed_stats)
+
+        // ===== SERIALIZATION =====
+        .def("serialize",
+             [](const spatio::SpatioIndexCore& self) {
+                 // serialize() holds the index lock shared
+                 auto state = std::make_unique<std::string>();
+                 {
+                     py::gil_scoped_release release;
+                     *state = self.serialize();
+                 }
+                 // Zero-copy: the array owns the buffer, via a capsule that
+                 // takes it over only once it exists
+                 py::capsule owner(state.get(), [](void* p) { delete static_cast<std::string*>(p); });
+                 std::string* buffer = state.release();
+                 return py::array_t<uint8_t>({static_cast<py::ssize_t>(buffer->size())}, {1},
+                                             reinterpret_cast<const uint8_t*>(buffer->data()),
+                                             owner);
+             },
+             "Snapshot of the index as a uint8 array of raw columns and tree nodes")
+
+        .def("deserialize",
+             [](spatio::SpatioIndexCore& self, py::buffer state) {
+                 py::buffer_info info = state.request();
+                 if (info.ndim != 1 || info.strides[0] != info.itemsize) {
+                     throw std::invalid_argument("state must be a contiguous 1-D buffer");
+                 }
+                 // deserialize() holds the index lock exclusively
+                 py::gil_scoped_release release;
+                 self.deserialize(static_cast<const char*>(info.ptr),
+                                  static_cast<size_t>(info.size * info.itemsize));
+             },
+             py::arg("state"),
+             "Replace the contents with a snapshot from serialize() (no rebuild)")
+
+        // Pickle: protocol 5 hands the snapshot over as an out-of-band
+        // PickleBuffer, so no extra copy is made on either side
+        .def("__reduce_ex__",
+             [](py::object self, int protocol) {
+                 py::object state = self.attr("serialize")();
+                 if (protocol >= 5) {
+                     state = py::module_::import("pickle").attr("PickleBuffer")(state);
+                 } else {
+                     state = py::bytes(state.attr("tobytes")());
+                 }
+                 return py::make_tuple(self.attr("__class__"), py::tuple(), state);
+             },
+             py::arg("protocol"))
+
+        .def("__setstate__",
+             [](py::object self, py::object state) {
+                 self.attr("deserialize")(state);
+             })
+
         .def("clear", &spatio::SpatioIndexCore::clear,
              "Clear all data")
         
         // ===== STATISTICS =====
         .def("get_index_stats", &spatio::SpatioIndexCore::get_index_stats,
              "Get comprehensive index statistics");
-}
\ No newline at end of file
+
+    // ==================== POLYGON INDEX ====================
+
+    py::class_<spatio::PolygonIndex>(m, "PolygonIndex")
+        .def(py::init<size_t>(), py::arg("max_grid_resolution") = 64)
+
+        .def("add_polygon", &spatio::PolygonIndex::add_polygon,
+             py::arg("polygon_id"), py::arg("vertices"),
+             "Add a polygon given as a list of (lat, lon) vertices")
+
+        .def("build", &spatio::PolygonIndex::build,
+             "Bulk-load the bbox R-tree and per-polygon edge grids")
+
+        .def("containing_polygons",
+             py::overload_cast<double, double>(&spatio::PolygonIndex::containing_polygons, py::const_),
+             py::arg("lat"), py::arg("lon"),
+             "IDs of all polygons containing the point")
+
+        .def("containing_polygons_batch",
+             [](const spatio::PolygonIndex& self,
+                py::array_t<double, py::array::c_style | py::array::forcecast> lats,
+                py::array_t<double, py::array::c_style | py::array::forcecast> lons) {
+                 if (lats.ndim() != 1 || lons.ndim() != 1 || lats.shape(0) != lons.shape(0)) {
+                     throw std::invalid_argument("lats and lons must be 1-D arrays of equal length");
+                 }
+                 std::vector<uint64_t> offsets, ids;
+                 {
+                     py::gil_scoped_release release;
+                     self.containing_polygons_batch(lats.data(), lons.data(),
+                                                    static_cast<size_t>(lats.shape(0)),
+                                                    offsets, ids);
+                 }
+                 py::array_t<uint64_t> offsets_arr(offsets.size());
+                 py::array_t<uint64_t> ids_arr(ids.size());
+                 std::copy(offsets.begin(), offsets.end(), offsets_arr.mutable_data());
+                 std::copy(ids.begin(), ids.end(), ids_arr.mutable_data());
+                 return py::make_tuple(offsets_arr, ids_arr);
+             },
+             py::arg("lats"), py::arg("lons"),
+             "Batched lookup: returns (offsets, ids) with matches of point i in ids[offsets[i]:offsets[i+1]]")
+
+        .def("size", &spatio::PolygonIndex::size)
+        .def("is_built", &spatio::PolygonIndex::is_built)
+        .def("clear", &spatio::PolygonIndex::clear);
+
+    // TrajectoryIndex class
+    py::class_<spatio::TrajectoryIndex>(m, "TrajectoryIndex")
+        .def(py::init<>())
+
+        .def("add_point", &spatio::TrajectoryIndex::add_point,
+             py::arg("object_id"), py::arg("lat"), py::arg("lon"), py::arg("t"),
+             "Add one GPS ping of an object")
+
+        .def("add_points",
+             [](spatio::TrajectoryIndex& self,
+                py::array_t<uint64_t, py::array::c_style | py::array::forcecast> object_ids,
+                py::array_t<double, py::array::c_style | py::array::forcecast> lats,
+                py::array_t<double, py::array::c_style | py::array::forcecast> lons,
+                py::array_t<double, py::array::c_style | py::array::forcecast> ts) {
+                 py::ssize_t n = object_ids.size();
+                 if (lats.size() != n || lons.size() != n || ts.size() != n) {
+                     throw std::invalid_argument("object_ids, lats, lons and ts must have equal length");
+                 }
+                 const uint64_t* ids = object_ids.data();
+                 const double* lat = lats.data();
+                 const double* lon = lons.data();
+                 const double* t = ts.data();
+                 for (py::ssize_t i = 0; i < n; i++) {
+                     self.add_point(ids[i], lat[i], lon[i], t[i]);
+                 }
+             },
+             py::arg("object_ids"), py::arg("lats"), py::arg("lons"), py::arg("ts"),
+             "Add pings from equal-length arrays")
+
+        .def("build", &spatio::TrajectoryIndex::build,
+             py::call_guard<py::gil_scoped_release>(),
+             "Group pings into per-object segments and bulk-load the segment R-tree")
+
+        .def("query_trajectories_box_time", &spatio::TrajectoryIndex::query_trajectories_box_time,
+             py::arg("lat_min"), py::arg("lon_min"), py::arg("lat_max"), py::arg("lon_max"),
+             py::arg("t_start"), py::arg("t_end"),
+             "Object IDs whose interpolated path intersects the box during [t_start, t_end]")
+
+        .def("trajectory", &spatio::TrajectoryIndex::trajectory,
+             py::arg("object_id"),
+             "Time-ordered (lat, lon, t) pings of an object")
+
+        .def("point_count", &spatio::TrajectoryIndex::point_count)
+        .def("object_count", &spatio::TrajectoryIndex::object_count)
+        .def("segment_count", &spatio::TrajectoryIndex::segment_count)
+        .def("is_built", &spatio::TrajectoryIndex::is_built)
+        .def("clear", &spatio::TrajectoryIndex::clear);
+
+    // ==================== SEGMENTED INDEX ====================
+
+    py::class_<spatio::SegmentedIndex::Stats>(m, "SegmentedIndexStats")
+        .def_readonly("head_records", &spatio::SegmentedIndex::Stats::head_records)
+        .def_readonly("sealed_batches", &spatio::SegmentedIndex::Stats::sealed_batches)
+        .def_readonly("segments", &spatio::SegmentedIndex::Stats::segments)
+        .def_readonly("segment_records", &spatio::SegmentedIndex::Stats::segment_records)
+        .def_readonly("tombstones", &spatio::SegmentedIndex::Stats::tombstones)
+        .def_readonly("compactions", &spatio::SegmentedIndex::Stats::compactions)
+        .def_readonly("history_segments", &spatio::SegmentedIndex::Stats::history_segments)
+        .def_readonly("history_records", &spatio::SegmentedIndex::Stats::history_records)
+        .def("__repr__", [](const spatio::SegmentedIndex::Stats &s) {
+            return "SegmentedIndexStats(head_records=" + std::to_string(s.head_records) +
+                   ", sealed_batches=" + std::to_string(s.sealed_batches) +
+                   ", segments=" + std::to_string(s.segments) +
+                   ", segment_records=" + std::to_string(s.segment_records) +
+                   ", tombstones=" + std::to_string(s.tombstones) +
+                   ", compactions=" + std::to_string(s.compactions) +
+                   ", history_records=" + std::to_string(s.history_records) + ")";
+        });
+
+    py::class_<spatio::SegmentedSnapshot>(m, "SegmentedSnapshot")
+        .def("query_box_time", &spatio::SegmentedSnapshot::query_box_time,
+             py::arg("lat_min"), py::arg("lon_min"), py::arg("lat_max"), py::arg("lon_max"),
+             py::arg("t_start"), py::arg("t_end"),
+             py::call_guard<py::gil_scoped_release>())
+
+        .def("query_radius_time", &spatio::SegmentedSnapshot::query_radius_time,
+             py::arg("center_lat"), py::arg("center_lon"), py::arg("radius_km"),
+             py::arg("t_start"), py::arg("t_end"),
+             py::call_guard<py::gil_scoped_release>())
+
+        .def("size", &spatio::SegmentedSnapshot::size)
+        .def("__len__", &spatio::SegmentedSnapshot::size);
+
+    py::class_<spatio::SegmentedIndex>(m, "SegmentedIndex")
+        .def(py::init([](size_t head_capacity, size_t merge_factor, bool background,
+                         double history_retention) {
+                 spatio::SegmentedIndex::Config config;
+                 config.head_capacity = head_capacity;
+                 config.merge_factor = merge_factor;
+                 config.background = background;
+                 config.history_retention = history_retention;
+                 return std::make_unique<spatio::SegmentedIndex>(config);
+             }),
+             py::arg("head_capacity") = 16384,
+             py::arg("merge_factor") = 4,
+             py::arg("background") = true,
+             py::arg("history_retention") = 0.0)
+
+        .def("insert", &spatio::SegmentedIndex::insert,
+             py::arg("lat"), py::arg("lon"), py::arg("t"),
+             py::call_guard<py::gil_scoped_release>(),
+             "Insert a record into the mutable head; returns its ID")
+
+        .def("bulk_insert",
+             [](spatio::SegmentedIndex& self,
+                py::array_t<float, py::array::c_style | py::array::forcecast> lats,
+                py::array_t<float, py::array::c_style | py::array::forcecast> lons,
+                py::array_t<double, py::array::c_style | py::array::forcecast> ts) {
+                 py::ssize_t n = lats.size();
+                 if (lons.size() != n || ts.size() != n) {
+                     throw std::invalid_argument("lats, lons and ts must have equal length");
+                 }
+                 std::vector<spatio::SegmentRecord> records;
+                 records.reserve(static_cast<size_t>(n));
+                 const float* lat = lats.data();
+                 const float* lon = lons.data();
+                 const double* t = ts.data();
+                 for (py::ssize_t i = 0; i < n; i++) {
+                     records.push_back({lat[i], lon[i], t[i], 0});
+                 }
+                 py::gil_scoped_release release;
+                 return self.bulk_insert(records);
+             },
+             py::arg("lats"), py::arg("lons"), py::arg("ts"),
+             "Insert records from equal-length arrays; returns their IDs")
+
+        .def("remove", &spatio::SegmentedIndex::remove,
+             py::arg("id"),
+             py::call_guard<py::gil_scoped_release>(),
+             "Tombstone a record; compaction drops it later")
+
+        .def("query_box_time", &spatio::SegmentedIndex::query_box_time,
+             py::arg("lat_min"), py::arg("lon_min"), py::arg("lat_max"), py::arg("lon_max"),
+             py::arg("t_start"), py::arg("t_end"),
+             py::call_guard<py::gil_scoped_release>())
+
+        .def("query_radius_time", &spatio::SegmentedIndex::query_radius_time,
+             py::arg("center_lat"), py::arg("center_lon"), py::arg("radius_km"),
+             py::arg("t_start"), py::arg("t_end"),
+             py::call_guard<py::gil_scoped_release>())
+
+        // as_of: an int version, or a float wall-clock time (Unix seconds)
+        .def("query_box_time_as_of",
+             [](const spatio::SegmentedIndex& self, py::object as_of,
+                float lat_min, float lon_min, float lat_max, float lon_max,
+                double t_start, double t_end) {
+                 bool wallclock = py::isinstance<py::float_>(as_of);
+                 double when = wallclock ? as_of.cast<double>() : 0.0;
+                 uint64_t version = wallclock ? 0 : as_of.cast<uint64_t>();
+                 py::gil_scoped_release release;
+                 if (wallclock) version = self.version_at(when);
+                 return self.query_box_time_as_of(version, lat_min, lon_min, lat_max, lon_max,
+                                                  t_start, t_end);
+             },
+             py::arg("as_of"), py::arg("lat_min"), py::arg("lon_min"), py::arg("lat_max"),
+             py::arg("lon_max"), py::arg("t_start"), py::arg("t_end"),
+             "Box query over the index as it was at a version or wall-clock time")
+
+        .def("query_radius_time_as_of",
+             [](const spatio::SegmentedIndex& self, py::object as_of,
+                float center_lat, float center_lon, double radius_km,
+                double t_start, double t_end) {
+                 bool wallclock = py::isinstance<py::float_>(as_of);
+                 double when = wallclock ? as_of.cast<double>() : 0.0;
+                 uint64_t version = wallclock ? 0 : as_of.cast<uint64_t>();
+                 py::gil_scoped_release release;
+                 if (wallclock) version = self.version_at(when);
+                 return self.query_radius_time_as_of(version, center_lat, center_lon, radius_km,
+                                                     t_start, t_end);
+             },
+             py::arg("as_of"), py::arg("center_lat"), py::arg("center_lon"),
+             py::arg("radius_km"), py::arg("t_start"), py::arg("t_end"),
+             "Radius query over the index as it was at a version or wall-clock time")
+
+        .def("version", &spatio::SegmentedIndex::version,
+             "Number of inserts and removals so far")
+        .def("oldest_version", &spatio::SegmentedIndex::oldest_version,
+             "Oldest version as-of queries can still answer")
+        .def("version_at", &spatio::SegmentedIndex::version_at, py::arg("wallclock"),
+             "Version at a wall-clock time (Unix seconds), to within 10 ms")
+        .def("collect_history", &spatio::SegmentedIndex::collect_history,
+             py::call_guard<py::gil_scoped_release>(),
+             "Drop history older than the retention period now")
+
+        .def("snapshot", &spatio::SegmentedIndex::snapshot,
+             py::call_guard<py::gil_scoped_release>(),
+             "Frozen read-only view sharing the current segments (no copy)")
+
+        .def("flush", &spatio::SegmentedIndex::flush,
+             py::call_guard<py::gil_scoped_release>(),
+             "Seal the head for compaction even if it is not full")
+
+        .def("compact_all", &spatio::SegmentedIndex::compact_all,
+             py::call_guard<py::gil_scoped_release>(),
+             "Merge everything into one segment and drop all tombstones")
+
+        .def("wait_for_compaction", &spatio::SegmentedIndex::wait_for_compaction,
+             py::call_guard<py::gil_scoped_release>())
+
+        .def("size", &spatio::SegmentedIndex::size)
+        .def("__len__", &spatio::SegmentedIndex::size)
+        .def("stats", &spatio::SegmentedIndex::stats);
+
+    // ==================== MAPPED INDEX ====================
+
+    py::class_<spatio::MappedIndex>(m, "MappedIndex")
+        .def(py::init([](const std::string& path, const std::string& huge_pages) {
+                 spatio::HugePages mode;
+                 if (huge_pages == "off") mode = spatio::HugePages::OFF;
+                 else if (huge_pages == "transparent") mode = spatio::HugePages::TRANSPARENT;
+                 else if (huge_pages == "explicit") mode = spatio::HugePages::EXPLICIT;
+                 else throw std::invalid_argument("huge_pages must be 'off', 'transparent' or 'explicit'");
+                 return new spatio::MappedIndex(path, mode);
+             }),
+             py::arg("path"), py::arg("huge_pages") = "off",
+             "Attach read-only to an image written by SpatioIndexCore.save_mapped; "
+             "with huge_pages the image is copied into huge-page backed memory")
+
+        .def("query_radius", &spatio::MappedIndex::query_radius,
+             py::arg("center_lat"), py::arg("center_lon"), py::arg("radius_km"),
+             py::call_guard<py::gil_scoped_release>())
+
+        .def("query_box", &spatio::MappedIndex::query_box,
+             py::arg("lat_min"), py::arg("lon_min"), py::arg("lat_max"), py::arg("lon_max"),
+             py::call_guard<py::gil_scoped_release>())
+
+        .def("query_knn", &spatio::MappedIndex::query_knn,
+             py::arg("lat"), py::arg("lon"), py::arg("k"),
+             py::call_guard<py::gil_scoped_release>())
+
+        .def("query_radius_time", &spatio::MappedIndex::query_radius_time,
+             py::arg("center_lat"), py::arg("center_lon"), py::arg("radius_km"),
+             py::arg("t_start"), py::arg("t_end"),
+             py::call_guard<py::gil_scoped_release>())
+
+        .def("query_box_time", &spatio::MappedIndex::query_box_time,
+             py::arg("lat_min"), py::arg("lon_min"), py::arg("lat_max"), py::arg("lon_max"),
+             py::arg("t_start"), py::arg("t_end"),
+             py::call_guard<py::gil_scoped_release>())
+
+        .def("query_knn_time", &spatio::MappedIndex::query_knn_time,
+             py::arg("lat"), py::arg("lon"), py::arg("k"), py::arg("t_start"), py::arg("t_end"),
+             py::call_guard<py::gil_scoped_release>())
+
+        .def("count_time_range", &spatio::MappedIndex::count_time_range,
+             py::arg("t_start"), py::arg("t_end"))
+
+        .def("get_record",
+             [](const spatio::MappedIndex& self, uint64_t id) -> std::optional<spatio::Record> {
+                 const spatio::Record* ptr = self.get_record_ptr(id);
+                 return ptr ? std::optional<spatio::Record>(*ptr) : std::nullopt;
+             },
+             py::arg("id"),
+             "Get record by ID (returns None if not found)")
+
+        .def("size", &spatio::MappedIndex::size)
+        .def("__len__", &spatio::MappedIndex::size)
+        .def("mapped_bytes", &spatio::MappedIndex::mapped_bytes)
+        .def("huge_pages",
+             [](const spatio::MappedIndex& self) {
+                 switch (self.huge_pages()) {
+                     case spatio::HugePages::TRANSPARENT: return "transparent";
+                     case spatio::HugePages::EXPLICIT: return "explicit";
+                     default: return "off";
+                 }
+             },
+             "Backing actually granted: 'off', 'transparent' or 'explicit'")
+        .def("prefault", &spatio::MappedIndex::prefault,
+             py::call_guard<py::gil_scoped_release>())
+        .def("warmup", &spatio::MappedIndex::warmup,
+             py::arg("tree_levels") = 18,
+             py::call_guard<py::gil_scoped_release>())
+        .def_property_readonly("path", &spatio::MappedIndex::path);
+}
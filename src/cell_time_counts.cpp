@@ -0,0 +1,118 @@
+#include "cell_time_counts.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace spatio {
+
+CellTimeCounts::CellTimeCounts(double cell_deg)
+    : cell_deg_(cell_deg > 0.0 ? cell_deg : 0.1) {}
+
+void CellTimeCounts::build(const std::vector<Record>& records) {
+    clear();
+    CellRange grid;
+    grid.cell_deg = cell_deg_;
+
+    // Assign cells, then lay records out cell by cell (counting sort)
+    std::vector<uint32_t> record_cell(records.size());
+    std::vector<size_t> counts;
+    for (size_t i = 0; i < records.size(); i++) {
+        long a = grid.lat_cell(records[i].lat);
+        long b = grid.lon_cell(records[i].lon);
+        auto [it, inserted] = cell_index_.try_emplace(cell_key(a, b),
+                                                      static_cast<uint32_t>(cell_keys_.size()));
+        if (inserted) {
+            cell_keys_.push_back(it->first);
+            cell_lat_.push_back(a);
+            cell_lon_.push_back(b);
+            counts.push_back(0);
+        }
+        record_cell[i] = it->second;
+        counts[it->second]++;
+    }
+
+    offsets_.assign(cell_keys_.size() + 1, 0);
+    for (size_t c = 0; c < cell_keys_.size(); c++) {
+        offsets_[c + 1] = offsets_[c] + counts[c];
+    }
+    starts_.resize(records.size());
+    ends_.resize(records.size());
+    std::vector<size_t> fill(offsets_.begin(), offsets_.end() - 1);
+    for (size_t i = 0; i < records.size(); i++) {
+        size_t pos = fill[record_cell[i]]++;
+        starts_[pos] = records[i].t;
+        ends_[pos] = records[i].t_end;
+    }
+    for (size_t c = 0; c < cell_keys_.size(); c++) {
+        std::sort(starts_.begin() + offsets_[c], starts_.begin() + offsets_[c + 1]);
+        std::sort(ends_.begin() + offsets_[c], ends_.begin() + offsets_[c + 1]);
+    }
+}
+
+size_t CellTimeCounts::count_interior(float lat_min, float lon_min, float lat_max, float lon_max,
+                                      double t_start, double t_end, CellRange& covered) const {
+    // Cells strictly inside the box: a point assigned to cell lat_lo has
+    // lat / cell_deg >= lat_lo > lat_min / cell_deg, and division rounding is
+    // monotone, so it really lies inside (likewise for the other sides)
+    covered = CellRange();
+    covered.cell_deg = cell_deg_;
+    covered.lat_lo = covered.lat_cell(lat_min) + 1;
+    covered.lat_hi = covered.lat_cell(lat_max) - 1;
+    covered.lon_lo = covered.lon_cell(lon_min) + 1;
+    covered.lon_hi = covered.lon_cell(lon_max) - 1;
+    if (covered.empty() || t_end < t_start) {
+        covered = CellRange();
+        return 0;
+    }
+
+    size_t count = 0;
+    double range_cells = static_cast<double>(covered.lat_hi - covered.lat_lo + 1) *
+                         static_cast<double>(covered.lon_hi - covered.lon_lo + 1);
+    if (range_cells <= static_cast<double>(cell_keys_.size())) {
+        for (long a = covered.lat_lo; a <= covered.lat_hi; a++) {
+            for (long b = covered.lon_lo; b <= covered.lon_hi; b++) {
+                auto it = cell_index_.find(cell_key(a, b));
+                if (it != cell_index_.end()) {
+                    count += count_cell(it->second, t_start, t_end);
+                }
+            }
+        }
+    } else {
+        // Box spans more cells than are occupied: scan the occupied ones
+        for (size_t c = 0; c < cell_keys_.size(); c++) {
+            if (cell_lat_[c] >= covered.lat_lo && cell_lat_[c] <= covered.lat_hi &&
+                cell_lon_[c] >= covered.lon_lo && cell_lon_[c] <= covered.lon_hi) {
+                count += count_cell(c, t_start, t_end);
+            }
+        }
+    }
+    return count;
+}
+
+size_t CellTimeCounts::count_cell(size_t cell, double t_start, double t_end) const {
+    auto starts_begin = starts_.begin() + offsets_[cell];
+    auto starts_end = starts_.begin() + offsets_[cell + 1];
+    auto ends_begin = ends_.begin() + offsets_[cell];
+    auto ends_end = ends_.begin() + offsets_[cell + 1];
+    // Records ending before t_start also start before it, so the
+    // subtraction never goes below zero
+    size_t started = std::upper_bound(starts_begin, starts_end, t_end) - starts_begin;
+    size_t ended = std::lower_bound(ends_begin, ends_end, t_start) - ends_begin;
+    return started - ended;
+}
+
+void CellTimeCounts::clear() {
+    cell_index_.clear();
+    cell_keys_.clear();
+    cell_lat_.clear();
+    cell_lon_.clear();
+    offsets_.clear();
+    starts_.clear();
+    ends_.clear();
+}
+
+uint64_t CellTimeCounts::cell_key(long lat_cell, long lon_cell) {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(lat_cell)) << 32) |
+           static_cast<uint32_t>(lon_cell);
+}
+
+} // namespace spatio
@@ -0,0 +1,175 @@
+#include "change_feed.hpp"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace spatio {
+
+namespace {
+
+constexpr char BATCH_MAGIC[8] = {'S', 'P', 'X', 'C', 'H', 'G', '\0', '\1'};
+
+struct BatchHeader {
+    char magic[8];
+    uint64_t first_seq;
+    uint32_t count;
+    uint32_t reserved;
+};
+
+static_assert(sizeof(BatchHeader) == 24, "batch layout");
+
+template <typename Payload>
+Payload read_payload(const char* data) {
+    Payload payload;
+    std::memcpy(&payload, data, sizeof(Payload));
+    return payload;
+}
+
+} // namespace
+
+ChangeFeed::ChangeFeed(size_t max_pending_bytes) : max_pending_bytes_(max_pending_bytes) {}
+
+size_t ChangeFeed::payload_size(ChangeKind kind) {
+    switch (kind) {
+        case ChangeKind::INSERT: return sizeof(InsertPayload);
+        case ChangeKind::INSERT_INTERVAL: return sizeof(IntervalPayload);
+        case ChangeKind::INSERT_VALUE: return sizeof(ValuePayload);
+        case ChangeKind::UPSERT: return sizeof(UpsertPayload);
+        case ChangeKind::BUILD:
+        case ChangeKind::CLEAR: return 0;
+    }
+    return 0;
+}
+
+void ChangeFeed::append(uint64_t seq, ChangeKind kind, const void* payload, size_t size) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (pending_.size() + 1 + size > max_pending_bytes_ && count_ > 0) {
+        // Nobody is draining: drop what is pending rather than grow forever
+        stats_.dropped += count_;
+        pending_.clear();
+        count_ = 0;
+    }
+    if (count_ == 0) {
+        first_seq_ = seq;
+    }
+    pending_.push_back(static_cast<char>(kind));
+    if (size > 0) pending_.append(static_cast<const char*>(payload), size);
+    count_++;
+    stats_.appended++;
+}
+
+std::string ChangeFeed::take() {
+    std::string entries;
+    BatchHeader header;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (count_ == 0) return std::string();
+        std::memcpy(header.magic, BATCH_MAGIC, sizeof(header.magic));
+        header.first_seq = first_seq_;
+        header.count = count_;
+        header.reserved = 0;
+        entries.swap(pending_);
+        count_ = 0;
+        stats_.batches++;
+    }
+
+    std::string batch;
+    batch.reserve(sizeof(header) + entries.size());
+    batch.append(reinterpret_cast<const char*>(&header), sizeof(header));
+    batch.append(entries);
+    return batch;
+}
+
+void ChangeFeed::reset() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.dropped += count_;
+    pending_.clear();
+    count_ = 0;
+}
+
+ChangeFeed::Stats ChangeFeed::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stats stats = stats_;
+    stats.pending_bytes = pending_.size();
+    return stats;
+}
+
+std::vector<Change> ChangeFeed::decode(const char* data, size_t size) {
+    if (size < sizeof(BatchHeader)) {
+        throw std::invalid_argument("Change batch is truncated");
+    }
+    BatchHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, BATCH_MAGIC, sizeof(header.magic)) != 0) {
+        throw std::invalid_argument("Not a change batch");
+    }
+
+    std::vector<Change> changes;
+    changes.reserve(std::min<size_t>(header.count, size - sizeof(BatchHeader)));
+    size_t pos = sizeof(BatchHeader);
+    for (uint32_t i = 0; i < header.count; i++) {
+        if (pos >= size) {
+            throw std::invalid_argument("Change batch is truncated");
+        }
+        auto kind = static_cast<ChangeKind>(data[pos]);
+        if (kind < ChangeKind::INSERT || kind > ChangeKind::CLEAR) {
+            throw std::invalid_argument("Change batch has an unknown change kind");
+        }
+        size_t payload = payload_size(kind);
+        if (size - pos - 1 < payload) {
+            throw std::invalid_argument("Change batch is truncated");
+        }
+        const char* p = data + pos + 1;
+
+        Change change{};
+        change.kind = kind;
+        change.seq = header.first_seq + i;
+        switch (kind) {
+            case ChangeKind::INSERT: {
+                auto in = read_payload<InsertPayload>(p);
+                change.lat = in.lat;
+                change.lon = in.lon;
+                change.t = change.t_end = in.t;
+                break;
+            }
+            case ChangeKind::INSERT_INTERVAL: {
+                auto in = read_payload<IntervalPayload>(p);
+                change.lat = in.lat;
+                change.lon = in.lon;
+                change.t = in.t;
+                change.t_end = in.t_end;
+                if (!(in.t_end >= in.t)) {
+                    throw std::invalid_argument("Change batch has an interval ending before it starts");
+                }
+                break;
+            }
+            case ChangeKind::INSERT_VALUE: {
+                auto in = read_payload<ValuePayload>(p);
+                change.lat = in.lat;
+                change.lon = in.lon;
+                change.t = change.t_end = in.t;
+                change.value = in.value;
+                break;
+            }
+            case ChangeKind::UPSERT: {
+                auto in = read_payload<UpsertPayload>(p);
+                change.object_id = in.object_id;
+                change.lat = in.lat;
+                change.lon = in.lon;
+                change.t = change.t_end = in.t;
+                break;
+            }
+            case ChangeKind::BUILD:
+            case ChangeKind::CLEAR:
+                break;
+        }
+        changes.push_back(change);
+        pos += 1 + payload;
+    }
+    if (pos != size) {
+        throw std::invalid_argument("Change batch has trailing bytes");
+    }
+    return changes;
+}
+
+} // namespace spatio
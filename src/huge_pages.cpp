@@ -0,0 +1,124 @@
+#include "huge_pages.hpp"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// Newer than some libc headers (values from linux/mman.h)
+#if defined(__linux__) && !defined(MADV_POPULATE_READ)
+#define MADV_POPULATE_READ 22
+#endif
+#if defined(__linux__) && !defined(MADV_COLLAPSE)
+#define MADV_COLLAPSE 25
+#endif
+
+namespace spatio {
+
+namespace {
+
+size_t page_size() {
+#ifndef _WIN32
+    static const size_t size = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+    return size;
+#else
+    return 4096;
+#endif
+}
+
+} // namespace
+
+bool advise_huge_pages(const MemoryRegion& region) {
+#ifdef __linux__
+    uintptr_t begin = reinterpret_cast<uintptr_t>(region.data);
+    uintptr_t end = begin + region.bytes;
+    begin = (begin + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+    end &= ~(HUGE_PAGE_SIZE - 1);
+    if (end <= begin) return false;
+    void* data = reinterpret_cast<void*>(begin);
+    if (::madvise(data, end - begin, MADV_HUGEPAGE) != 0) return false;
+    ::madvise(data, end - begin, MADV_COLLAPSE);  // Best effort
+    return true;
+#else
+    (void)region;
+    return false;
+#endif
+}
+
+size_t prefault(const MemoryRegion& region) {
+    if (region.bytes == 0) return 0;
+    const size_t page = page_size();
+    uintptr_t begin = reinterpret_cast<uintptr_t>(region.data) & ~(page - 1);
+    uintptr_t end = reinterpret_cast<uintptr_t>(region.data) + region.bytes;
+#ifdef __linux__
+    // One system call (Linux 5.14+); file mappings are read ahead in bulk
+    if (::madvise(reinterpret_cast<void*>(begin), end - begin, MADV_POPULATE_READ) == 0) {
+        return region.bytes;
+    }
+#endif
+    const volatile char* bytes = static_cast<const volatile char*>(region.data);
+    uintptr_t first = reinterpret_cast<uintptr_t>(region.data);
+    for (uintptr_t p = std::max(begin, first); p < end; p = (p & ~(page - 1)) + page) {
+        (void)bytes[p - first];
+    }
+    return region.bytes;
+}
+
+void* map_huge(size_t bytes, HugePages& mode, size_t& length) {
+    length = (bytes + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+    if (length == 0) length = HUGE_PAGE_SIZE;
+#ifndef _WIN32
+#ifdef MAP_HUGETLB
+    if (mode == HugePages::EXPLICIT) {
+        void* data = ::mmap(nullptr, length, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (data != MAP_FAILED) return data;
+        mode = HugePages::TRANSPARENT;  // Pool too small, or none reserved
+    }
+#endif
+    // Over-map by one huge page so the mapping can start 2 MB-aligned
+    size_t padded = mode == HugePages::OFF ? length : length + HUGE_PAGE_SIZE;
+    void* raw = ::mmap(nullptr, padded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED) return nullptr;
+    if (mode == HugePages::OFF) return raw;
+
+    uintptr_t start = reinterpret_cast<uintptr_t>(raw);
+    uintptr_t aligned = (start + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+    if (aligned > start) ::munmap(raw, aligned - start);
+    uintptr_t tail = aligned + length;
+    if (start + padded > tail) ::munmap(reinterpret_cast<void*>(tail), start + padded - tail);
+    void* data = reinterpret_cast<void*>(aligned);
+    if (!advise_huge_pages({data, length})) mode = HugePages::OFF;
+    return data;
+#else
+    mode = HugePages::OFF;
+    return nullptr;
+#endif
+}
+
+void unmap_huge(void* data, size_t length) {
+#ifndef _WIN32
+    if (data) ::munmap(data, length);
+#else
+    (void)data;
+    (void)length;
+#endif
+}
+
+size_t anon_huge_page_bytes() {
+    std::ifstream in("/proc/self/smaps_rollup");
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        std::string name;
+        size_t kb = 0;
+        if (fields >> name >> kb && name == "AnonHugePages:") return kb * 1024;
+    }
+    return 0;
+}
+
+} // namespace spatio
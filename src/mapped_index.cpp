@@ -0,0 +1,670 @@
+#include "mapped_index.hpp"
+#include "utils.hpp"
+#include <algorithm>
+#include <chrono>
+#include <numeric>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace spatio {
+
+namespace {
+
+constexpr char IMAGE_MAGIC[8] = {'S', 'P', 'X', 'I', 'M', 'G', '\0', '\1'};
+constexpr uint32_t IMAGE_VERSION = 2;
+constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+constexpr uint64_t SECTION_ALIGNMENT = 64;
+constexpr uint32_t NO_POSITION = std::numeric_limits<uint32_t>::max();
+
+uint64_t align_up(uint64_t offset) {
+    return (offset + SECTION_ALIGNMENT - 1) / SECTION_ALIGNMENT * SECTION_ALIGNMENT;
+}
+
+// Implicit KD-tree: the median of [lo, hi) splits it, by latitude at even depths
+void build_kd(std::vector<Record>& records, size_t lo, size_t hi, int depth, size_t leaf_size) {
+    if (hi - lo <= leaf_size) return;
+    size_t mid = lo + (hi - lo) / 2;
+    bool by_lat = depth % 2 == 0;
+    std::nth_element(records.begin() + lo, records.begin() + mid, records.begin() + hi,
+                     [by_lat](const Record& a, const Record& b) {
+                         return by_lat ? a.lat < b.lat : a.lon < b.lon;
+                     });
+    build_kd(records, lo, mid, depth + 1, leaf_size);
+    build_kd(records, mid + 1, hi, depth + 1, leaf_size);
+}
+
+// Duration class of an interval: instants first, then powers of two as in
+// TemporalIndex
+int duration_class(const Record& r) {
+    double duration = r.t_end - r.t;
+    return duration > 0.0 ? std::ilogb(duration) : std::numeric_limits<int>::min();
+}
+
+std::pair<double, double> fill_node_times(const std::vector<Record>& records, size_t lo, size_t hi,
+                                          size_t node, size_t leaf_size,
+                                          std::vector<std::pair<double, double>>& out) {
+    std::pair<double, double> bounds{std::numeric_limits<double>::max(),
+                                     std::numeric_limits<double>::lowest()};
+    if (lo >= hi) return bounds;
+    if (hi - lo <= leaf_size) {
+        for (size_t i = lo; i < hi; i++) {
+            bounds.first = std::min(bounds.first, records[i].t);
+            bounds.second = std::max(bounds.second, records[i].t_end);
+        }
+    } else {
+        size_t mid = lo + (hi - lo) / 2;
+        auto left = fill_node_times(records, lo, mid, 2 * node + 1, leaf_size, out);
+        auto right = fill_node_times(records, mid + 1, hi, 2 * node + 2, leaf_size, out);
+        bounds.first = std::min({records[mid].t, left.first, right.first});
+        bounds.second = std::max({records[mid].t_end, left.second, right.second});
+    }
+    if (out.size() <= node) {
+        out.resize(node + 1, {std::numeric_limits<double>::max(),
+                              std::numeric_limits<double>::lowest()});
+    }
+    out[node] = bounds;
+    return bounds;
+}
+
+} // namespace
+
+// Per-subtree time bounds of the implicit tree, heap-numbered: the root
+// range is node 0 and node i splits into 2i+1 (below the median) and 2i+2
+struct MappedIndex::NodeTimes {
+    double min_start;
+    double max_end;
+};
+
+// Start times of one duration class: starts_[begin, begin + count)
+struct MappedIndex::DurationSlice {
+    uint64_t begin;
+    uint64_t count;
+    double max_duration;
+};
+
+// Fixed-size image header; all sections are addressed by byte offset
+struct MappedIndex::Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint64_t file_size;
+    uint64_t record_count;
+    uint64_t id_count;  // Largest ID + 1
+    double min_time;
+    double max_time;
+    uint64_t class_count;
+    uint64_t node_count;
+    uint64_t records_offset;
+    uint64_t starts_offset;            // Sorted by (duration class, start)
+    uint64_t start_positions_offset;
+    uint64_t ends_offset;
+    uint64_t id_positions_offset;
+    uint64_t classes_offset;           // DurationSlice per class
+    uint64_t node_times_offset;        // NodeTimes per implicit tree node
+};
+
+static_assert(std::is_trivially_copyable<Record>::value && sizeof(Record) == 32,
+              "Record is stored verbatim in mapped images");
+
+struct MappedIndex::KNNCandidate {
+    uint64_t id;
+    double distance;
+    bool operator<(const KNNCandidate& other) const { return distance < other.distance; }
+};
+
+// ==================== WRITING ====================
+
+void MappedIndex::write(const std::vector<Record>& records, const std::string& path) {
+    if (records.size() >= NO_POSITION) {
+        throw std::runtime_error("MappedIndex::write: too many records for 32-bit positions");
+    }
+    const size_t n = records.size();
+
+    std::vector<Record> ordered(records);
+    build_kd(ordered, 0, n, 0, LEAF_SIZE);
+
+    Header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, IMAGE_MAGIC, sizeof(IMAGE_MAGIC));
+    header.version = IMAGE_VERSION;
+    header.byte_order = BYTE_ORDER_MARK;
+    header.record_count = n;
+    header.min_time = std::numeric_limits<double>::max();
+    header.max_time = std::numeric_limits<double>::lowest();
+
+    uint64_t max_id = 0;
+    for (const Record& r : ordered) {
+        max_id = std::max(max_id, r.id);
+        header.min_time = std::min(header.min_time, r.t);
+        header.max_time = std::max(header.max_time, r.t_end);
+    }
+    header.id_count = n > 0 ? max_id + 1 : 0;
+
+    // One long interval would otherwise widen the start-time scan for all
+    std::vector<uint32_t> start_positions(n);
+    std::iota(start_positions.begin(), start_positions.end(), 0u);
+    std::sort(start_positions.begin(), start_positions.end(), [&](uint32_t a, uint32_t b) {
+        int class_a = duration_class(ordered[a]);
+        int class_b = duration_class(ordered[b]);
+        return class_a != class_b ? class_a < class_b : ordered[a].t < ordered[b].t;
+    });
+    std::vector<double> starts(n), ends(n);
+    std::vector<DurationSlice> classes;
+    for (size_t i = 0; i < n; i++) {
+        const Record& r = ordered[start_positions[i]];
+        if (i == 0 || duration_class(r) != duration_class(ordered[start_positions[i - 1]])) {
+            classes.push_back({i, 0, 0.0});
+        }
+        classes.back().count++;
+        classes.back().max_duration = std::max(classes.back().max_duration, r.t_end - r.t);
+        starts[i] = r.t;
+        ends[i] = ordered[i].t_end;
+    }
+    std::sort(ends.begin(), ends.end());
+    header.class_count = classes.size();
+
+    std::vector<std::pair<double, double>> node_bounds;
+    fill_node_times(ordered, 0, n, 0, LEAF_SIZE, node_bounds);
+    std::vector<NodeTimes> node_times(node_bounds.size());
+    for (size_t i = 0; i < node_bounds.size(); i++) {
+        node_times[i] = {node_bounds[i].first, node_bounds[i].second};
+    }
+    header.node_count = node_times.size();
+    std::vector<uint32_t> id_positions(header.id_count, NO_POSITION);
+    for (size_t i = 0; i < n; i++) {
+        id_positions[ordered[i].id] = static_cast<uint32_t>(i);
+    }
+
+    header.records_offset = align_up(sizeof(Header));
+    header.starts_offset = align_up(header.records_offset + n * sizeof(Record));
+    header.start_positions_offset = align_up(header.starts_offset + n * sizeof(double));
+    header.ends_offset = align_up(header.start_positions_offset + n * sizeof(uint32_t));
+    header.id_positions_offset = align_up(header.ends_offset + n * sizeof(double));
+    header.classes_offset = align_up(header.id_positions_offset +
+                                     id_positions.size() * sizeof(uint32_t));
+    header.node_times_offset = align_up(header.classes_offset +
+                                        classes.size() * sizeof(DurationSlice));
+    header.file_size = header.node_times_offset + node_times.size() * sizeof(NodeTimes);
+
+    // Write next to the target and rename, so readers see old or new image
+    std::string tmp_path = path + ".tmp";
+    {
+        std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            throw std::runtime_error("MappedIndex::write: cannot create " + tmp_path);
+        }
+        uint64_t written = 0;
+        auto put = [&](uint64_t offset, const void* data, size_t bytes) {
+            static const char zeros[SECTION_ALIGNMENT] = {};
+            while (written < offset) {
+                size_t pad = static_cast<size_t>(std::min<uint64_t>(offset - written, sizeof(zeros)));
+                out.write(zeros, static_cast<std::streamsize>(pad));
+                written += pad;
+            }
+            out.write(static_cast<const char*>(data), static_cast<std::streamsize>(bytes));
+            written += bytes;
+        };
+        put(0, &header, sizeof(header));
+        put(header.records_offset, ordered.data(), n * sizeof(Record));
+        put(header.starts_offset, starts.data(), n * sizeof(double));
+        put(header.start_positions_offset, start_positions.data(), n * sizeof(uint32_t));
+        put(header.ends_offset, ends.data(), n * sizeof(double));
+        put(header.id_positions_offset, id_positions.data(), id_positions.size() * sizeof(uint32_t));
+        put(header.classes_offset, classes.data(), classes.size() * sizeof(DurationSlice));
+        put(header.node_times_offset, node_times.data(), node_times.size() * sizeof(NodeTimes));
+        out.flush();
+        if (!out) {
+            std::remove(tmp_path.c_str());
+            throw std::runtime_error("MappedIndex::write: write failed for " + tmp_path);
+        }
+    }
+    if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+        std::remove(tmp_path.c_str());
+        throw std::runtime_error("MappedIndex::write: cannot rename to " + path + ": " +
+                                 std::strerror(errno));
+    }
+}
+
+// ==================== MAPPING ====================
+
+MappedIndex::MappedIndex(const std::string& path, HugePages huge_pages) : path_(path) {
+#ifdef _WIN32
+    throw std::runtime_error("MappedIndex: memory-mapped images need a POSIX system");
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("MappedIndex: cannot open " + path + ": " + std::strerror(errno));
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(Header)) {
+        ::close(fd);
+        throw std::runtime_error("MappedIndex: " + path + " is not an index image");
+    }
+    length_ = static_cast<size_t>(st.st_size);
+    if (huge_pages != HugePages::OFF) {
+        load_copy(fd, huge_pages);
+    } else {
+        void* base = ::mmap(nullptr, length_, PROT_READ, MAP_SHARED, fd, 0);
+        if (base == MAP_FAILED) {
+            int saved = errno;
+            ::close(fd);
+            length_ = 0;
+            throw std::runtime_error("MappedIndex: cannot map " + path + ": " + std::strerror(saved));
+        }
+        base_ = base;
+    }
+    ::close(fd);  // A file mapping keeps the file referenced
+
+    const Header& h = header();
+    const uint64_t n = h.record_count;
+    auto section_fits = [&](uint64_t offset, uint64_t bytes) {
+        return offset % SECTION_ALIGNMENT == 0 && offset <= h.file_size &&
+               bytes <= h.file_size - offset;
+    };
+    bool valid = std::memcmp(h.magic, IMAGE_MAGIC, sizeof(IMAGE_MAGIC)) == 0 &&
+                 h.version == IMAGE_VERSION && h.byte_order == BYTE_ORDER_MARK &&
+                 h.file_size == length_ && n < NO_POSITION &&
+                 section_fits(h.records_offset, n * sizeof(Record)) &&
+                 section_fits(h.starts_offset, n * sizeof(double)) &&
+                 section_fits(h.start_positions_offset, n * sizeof(uint32_t)) &&
+                 section_fits(h.ends_offset, n * sizeof(double)) &&
+                 h.id_count <= h.file_size / sizeof(uint32_t) &&
+                 section_fits(h.id_positions_offset, h.id_count * sizeof(uint32_t)) &&
+                 h.class_count <= n &&
+                 section_fits(h.classes_offset, h.class_count * sizeof(DurationSlice)) &&
+                 h.node_count <= h.file_size / sizeof(NodeTimes) &&
+                 section_fits(h.node_times_offset, h.node_count * sizeof(NodeTimes));
+    if (!valid) {
+        release();
+        throw std::runtime_error("MappedIndex: " + path + " is not a valid index image");
+    }
+
+    records_ = section<Record>(h.records_offset);
+    starts_ = section<double>(h.starts_offset);
+    start_positions_ = section<uint32_t>(h.start_positions_offset);
+    ends_ = section<double>(h.ends_offset);
+    id_positions_ = section<uint32_t>(h.id_positions_offset);
+    classes_ = section<DurationSlice>(h.classes_offset);
+    node_times_ = section<NodeTimes>(h.node_times_offset);
+    for (uint64_t c = 0; c < h.class_count; c++) {
+        if (classes_[c].begin > n || classes_[c].count > n - classes_[c].begin) {
+            release();
+            throw std::runtime_error("MappedIndex: " + path + " is not a valid index image");
+        }
+    }
+#endif
+}
+
+MappedIndex::~MappedIndex() {
+    release();
+}
+
+MappedIndex::MappedIndex(MappedIndex&& other) noexcept {
+    *this = std::move(other);
+}
+
+MappedIndex& MappedIndex::operator=(MappedIndex&& other) noexcept {
+    if (this != &other) {
+        release();
+        path_ = std::move(other.path_);
+        std::swap(base_, other.base_);
+        std::swap(length_, other.length_);
+        std::swap(huge_pages_, other.huge_pages_);
+        std::swap(copy_length_, other.copy_length_);
+        std::swap(records_, other.records_);
+        std::swap(starts_, other.starts_);
+        std::swap(start_positions_, other.start_positions_);
+        std::swap(ends_, other.ends_);
+        std::swap(id_positions_, other.id_positions_);
+        std::swap(classes_, other.classes_);
+        std::swap(node_times_, other.node_times_);
+    }
+    return *this;
+}
+
+void MappedIndex::load_copy(int fd, HugePages mode) {
+#ifndef _WIN32
+    size_t length = 0;
+    void* data = map_huge(length_, mode, length);
+    if (!data) {
+        int saved = errno;
+        ::close(fd);
+        length_ = 0;
+        throw std::runtime_error("MappedIndex: cannot allocate " + path_ + ": " + std::strerror(saved));
+    }
+    size_t done = 0;
+    while (done < length_) {
+        ssize_t got = ::pread(fd, static_cast<char*>(data) + done, length_ - done,
+                              static_cast<off_t>(done));
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) {
+            int saved = got < 0 ? errno : EIO;
+            unmap_huge(data, length);
+            ::close(fd);
+            length_ = 0;
+            throw std::runtime_error("MappedIndex: cannot read " + path_ + ": " + std::strerror(saved));
+        }
+        done += static_cast<size_t>(got);
+    }
+    ::mprotect(data, length, PROT_READ);
+    base_ = data;
+    copy_length_ = length;
+    huge_pages_ = mode;
+#else
+    (void)fd;
+    (void)mode;
+#endif
+}
+
+void MappedIndex::release() {
+#ifndef _WIN32
+    if (base_ && copy_length_ > 0) {
+        unmap_huge(const_cast<void*>(base_), copy_length_);
+    } else if (base_) {
+        ::munmap(const_cast<void*>(base_), length_);
+    }
+#endif
+    base_ = nullptr;
+    length_ = 0;
+    huge_pages_ = HugePages::OFF;
+    copy_length_ = 0;
+    records_ = nullptr;
+    starts_ = nullptr;
+    start_positions_ = nullptr;
+    ends_ = nullptr;
+    id_positions_ = nullptr;
+    classes_ = nullptr;
+    node_times_ = nullptr;
+}
+
+// ==================== QUERIES ====================
+
+template <typename Visit>
+void MappedIndex::visit_box_time(float lat_min, float lon_min, float lat_max, float lon_max,
+                                 double t_start, double t_end, Visit&& visit) const {
+    const size_t n = size();
+    if (n == 0 || t_end < t_start || t_end < min_time() || t_start > max_time()) return;
+
+    // Within a duration class every active record starts at most the
+    // class's max_duration before t_start, so only that stretch of its
+    // start times can match
+    struct Stretch {
+        size_t first, last;
+    };
+    std::vector<Stretch> stretches;
+    size_t scan = 0;
+    for (uint64_t c = 0; c < header().class_count; c++) {
+        const double* begin = starts_ + classes_[c].begin;
+        const double* end = begin + classes_[c].count;
+        const double* first = std::lower_bound(begin, end, t_start - classes_[c].max_duration);
+        const double* last = std::upper_bound(first, end, t_end);
+        stretches.push_back({static_cast<size_t>(first - starts_), static_cast<size_t>(last - starts_)});
+        scan += stretches.back().last - stretches.back().first;
+    }
+    if (scan * TIME_SCAN_COST < n &&
+        scan * TIME_SCAN_COST < box_estimate(0, n, 0, 0, ESTIMATE_LEVELS, lat_min, lon_min,
+                                             lat_max, lon_max, t_start, t_end)) {
+        for (const Stretch& stretch : stretches) {
+            for (size_t i = stretch.first; i < stretch.last; i++) {
+                const Record& r = records_[start_positions_[i]];
+                if (r.lat >= lat_min && r.lat <= lat_max && r.lon >= lon_min && r.lon <= lon_max &&
+                    r.active_during(t_start, t_end)) {
+                    visit(r);
+                }
+            }
+        }
+        return;
+    }
+    box_recursive(0, n, 0, 0, lat_min, lon_min, lat_max, lon_max, t_start, t_end, visit);
+}
+
+bool MappedIndex::outside_window(size_t node, double t_start, double t_end) const {
+    return node < header().node_count &&
+           (node_times_[node].max_end < t_start || node_times_[node].min_start > t_end);
+}
+
+size_t MappedIndex::box_estimate(size_t lo, size_t hi, int depth, size_t node, int levels,
+                                 float lat_min, float lon_min, float lat_max, float lon_max,
+                                 double t_start, double t_end) const {
+    if (lo >= hi || outside_window(node, t_start, t_end)) return 0;
+    if (depth >= levels || hi - lo <= LEAF_SIZE) return hi - lo;
+    size_t mid = lo + (hi - lo) / 2;
+    bool by_lat = depth % 2 == 0;
+    float split = by_lat ? records_[mid].lat : records_[mid].lon;
+    size_t count = 1;
+    if ((by_lat ? lat_min : lon_min) <= split) {
+        count += box_estimate(lo, mid, depth + 1, 2 * node + 1, levels,
+                              lat_min, lon_min, lat_max, lon_max, t_start, t_end);
+    }
+    if ((by_lat ? lat_max : lon_max) >= split) {
+        count += box_estimate(mid + 1, hi, depth + 1, 2 * node + 2, levels,
+                              lat_min, lon_min, lat_max, lon_max, t_start, t_end);
+    }
+    return count;
+}
+
+template <typename Visit>
+void MappedIndex::box_recursive(size_t lo, size_t hi, int depth, size_t node,
+                                float lat_min, float lon_min, float lat_max, float lon_max,
+                                double t_start, double t_end, Visit& visit) const {
+    if (lo >= hi || outside_window(node, t_start, t_end)) return;
+    auto check = [&](const Record& r) {
+        if (r.lat >= lat_min && r.lat <= lat_max && r.lon >= lon_min && r.lon <= lon_max &&
+            r.active_during(t_start, t_end)) {
+            visit(r);
+        }
+    };
+    if (hi - lo <= LEAF_SIZE) {
+        for (size_t i = lo; i < hi; i++) check(records_[i]);
+        return;
+    }
+    size_t mid = lo + (hi - lo) / 2;
+    const Record& r = records_[mid];
+    bool by_lat = depth % 2 == 0;
+    float split = by_lat ? r.lat : r.lon;
+    check(r);
+    if ((by_lat ? lat_min : lon_min) <= split) {
+        box_recursive(lo, mid, depth + 1, 2 * node + 1,
+                      lat_min, lon_min, lat_max, lon_max, t_start, t_end, visit);
+    }
+    if ((by_lat ? lat_max : lon_max) >= split) {
+        box_recursive(mid + 1, hi, depth + 1, 2 * node + 2,
+                      lat_min, lon_min, lat_max, lon_max, t_start, t_end, visit);
+    }
+}
+
+std::vector<uint64_t> MappedIndex::query_box_time(float lat_min, float lon_min,
+                                                  float lat_max, float lon_max,
+                                                  double t_start, double t_end) const {
+    std::vector<uint64_t> results;
+    visit_box_time(lat_min, lon_min, lat_max, lon_max, t_start, t_end,
+                   [&](const Record& r) { results.push_back(r.id); });
+    return results;
+}
+
+std::vector<uint64_t> MappedIndex::query_box(float lat_min, float lon_min,
+                                             float lat_max, float lon_max) const {
+    return query_box_time(lat_min, lon_min, lat_max, lon_max,
+                          std::numeric_limits<double>::lowest(), std::numeric_limits<double>::max());
+}
+
+std::vector<uint64_t> MappedIndex::query_radius_time(float center_lat, float center_lon,
+                                                     double radius_km,
+                                                     double t_start, double t_end) const {
+    std::vector<uint64_t> results;
+    double lat_min, lat_max, lon_min, lon_max;
+    radius_bbox(center_lat, center_lon, radius_km, lat_min, lat_max, lon_min, lon_max);
+    double radius_m = radius_km * 1000.0;
+    visit_box_time(static_cast<float>(lat_min), static_cast<float>(lon_min),
+                   static_cast<float>(lat_max), static_cast<float>(lon_max), t_start, t_end,
+                   [&](const Record& r) {
+                       if (haversine_distance(center_lat, center_lon, r.lat, r.lon) <= radius_m) {
+                           results.push_back(r.id);
+                       }
+                   });
+    return results;
+}
+
+std::vector<uint64_t> MappedIndex::query_radius(float center_lat, float center_lon,
+                                                double radius_km) const {
+    return query_radius_time(center_lat, center_lon, radius_km,
+                             std::numeric_limits<double>::lowest(), std::numeric_limits<double>::max());
+}
+
+std::vector<uint64_t> MappedIndex::query_knn_time(float lat, float lon, size_t k,
+                                                  double t_start, double t_end) const {
+    std::vector<uint64_t> results;
+    if (k == 0 || size() == 0 || t_end < t_start) return results;
+
+    std::vector<KNNCandidate> candidates;
+    candidates.reserve(k);
+    knn_recursive(0, size(), 0, 0, lat, lon, k, t_start, t_end, candidates);
+
+    std::sort_heap(candidates.begin(), candidates.end());
+    results.reserve(candidates.size());
+    for (const auto& cand : candidates) {
+        results.push_back(cand.id);
+    }
+    return results;
+}
+
+std::vector<uint64_t> MappedIndex::query_knn(float lat, float lon, size_t k) const {
+    return query_knn_time(lat, lon, k,
+                          std::numeric_limits<double>::lowest(), std::numeric_limits<double>::max());
+}
+
+void MappedIndex::knn_recursive(size_t lo, size_t hi, int depth, size_t node,
+                                float lat, float lon, size_t k, double t_start, double t_end,
+                                std::vector<KNNCandidate>& candidates) const {
+    if (lo >= hi || outside_window(node, t_start, t_end)) return;
+    // Max-heap of the k best so far
+    auto offer = [&](const Record& r) {
+        if (!r.active_during(t_start, t_end)) return;
+        double dist = haversine_distance(lat, lon, r.lat, r.lon);
+        if (candidates.size() < k) {
+            candidates.push_back({r.id, dist});
+            std::push_heap(candidates.begin(), candidates.end());
+        } else if (dist < candidates.front().distance) {
+            std::pop_heap(candidates.begin(), candidates.end());
+            candidates.back() = {r.id, dist};
+            std::push_heap(candidates.begin(), candidates.end());
+        }
+    };
+    if (hi - lo <= LEAF_SIZE) {
+        for (size_t i = lo; i < hi; i++) offer(records_[i]);
+        return;
+    }
+
+    size_t mid = lo + (hi - lo) / 2;
+    const Record& r = records_[mid];
+    offer(r);
+
+    bool by_lat = depth % 2 == 0;
+    float split = by_lat ? r.lat : r.lon;
+    bool left_first = (by_lat ? lat : lon) < split;
+    if (left_first) {
+        knn_recursive(lo, mid, depth + 1, 2 * node + 1, lat, lon, k, t_start, t_end, candidates);
+    } else {
+        knn_recursive(mid + 1, hi, depth + 1, 2 * node + 2, lat, lon, k, t_start, t_end, candidates);
+    }
+
+    double plane_dist = split_distance_bound(lat, lon, by_lat, split);
+    if (candidates.size() < k || plane_dist < candidates.front().distance) {
+        if (left_first) {
+            knn_recursive(mid + 1, hi, depth + 1, 2 * node + 2, lat, lon, k, t_start, t_end, candidates);
+        } else {
+            knn_recursive(lo, mid, depth + 1, 2 * node + 1, lat, lon, k, t_start, t_end, candidates);
+        }
+    }
+}
+
+size_t MappedIndex::count_time_range(double t_start, double t_end) const {
+    const size_t n = size();
+    if (n == 0 || t_end < t_start) return 0;
+    // A record ending before t_start also starts before it
+    size_t started = 0;
+    for (uint64_t c = 0; c < header().class_count; c++) {
+        const double* begin = starts_ + classes_[c].begin;
+        started += std::upper_bound(begin, begin + classes_[c].count, t_end) - begin;
+    }
+    size_t ended = std::lower_bound(ends_, ends_ + n, t_start) - ends_;
+    return started - ended;
+}
+
+// ==================== DATA ACCESS ====================
+
+const Record* MappedIndex::get_record_ptr(uint64_t id) const {
+    if (!base_ || id >= header().id_count) return nullptr;
+    uint32_t pos = id_positions_[id];
+    return pos == NO_POSITION ? nullptr : &records_[pos];
+}
+
+size_t MappedIndex::prefault() const {
+    return base_ ? spatio::prefault({base_, length_}) : 0;
+}
+
+WarmupStats MappedIndex::warmup(int tree_levels) const {
+    auto start = std::chrono::steady_clock::now();
+    WarmupStats stats;
+    if (!base_) return stats;
+#ifndef _WIN32
+    if (copy_length_ == 0) {
+        // Read-ahead of the rest proceeds while queries start
+        uintptr_t page = static_cast<uintptr_t>(::sysconf(_SC_PAGESIZE));
+        uintptr_t begin = reinterpret_cast<uintptr_t>(base_) & ~(page - 1);
+        ::madvise(reinterpret_cast<void*>(begin),
+                  reinterpret_cast<uintptr_t>(base_) + length_ - begin, MADV_WILLNEED);
+    }
+#endif
+
+    // Tree medians and the time-column binary-search probes sit at about
+    // the same positions: the midpoints of the recursive halving of [0, n)
+    const size_t n = size();
+    volatile double sink = 0.0;
+    struct Range {
+        size_t lo, hi;
+        int depth;
+        size_t node;
+    };
+    std::vector<Range> stack{{0, n, 0, 0}};
+    while (!stack.empty()) {
+        Range range = stack.back();
+        stack.pop_back();
+        if (range.lo >= range.hi) continue;
+        size_t mid = range.lo + (range.hi - range.lo) / 2;
+        sink = sink + records_[mid].t + starts_[mid] + ends_[mid];
+        if (range.node < header().node_count) sink = sink + node_times_[range.node].min_start;
+        stats.touched_nodes++;
+        if (range.depth + 1 >= tree_levels || range.hi - range.lo <= LEAF_SIZE) continue;
+        stack.push_back({mid + 1, range.hi, range.depth + 1, 2 * range.node + 2});
+        stack.push_back({range.lo, mid, range.depth + 1, 2 * range.node + 1});
+    }
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return stats;
+}
+
+size_t MappedIndex::size() const {
+    return base_ ? static_cast<size_t>(header().record_count) : 0;
+}
+
+double MappedIndex::min_time() const {
+    return base_ ? header().min_time : std::numeric_limits<double>::max();
+}
+
+double MappedIndex::max_time() const {
+    return base_ ? header().max_time : std::numeric_limits<double>::lowest();
+}
+
+} // namespace spatio
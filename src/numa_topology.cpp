@@ -0,0 +1,126 @@
+#include "numa_topology.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <linux/mempolicy.h>
+
+namespace spatio {
+namespace numa {
+
+namespace {
+
+const char* NODE_DIR = "/sys/devices/system/node";
+
+// "0-3,8-11" -> {0, 1, 2, 3, 8, 9, 10, 11}
+std::vector<int> parse_cpulist(const std::string& list) {
+    std::vector<int> cpus;
+    std::stringstream in(list);
+    std::string range;
+    while (std::getline(in, range, ',')) {
+        if (range.empty() || range == "\n") continue;
+        int first = 0, last = 0;
+        int fields = std::sscanf(range.c_str(), "%d-%d", &first, &last);
+        if (fields < 1) continue;
+        if (fields == 1) last = first;
+        for (int cpu = first; cpu <= last; cpu++) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+std::string read_file(const std::string& path) {
+    std::ifstream in(path);
+    std::stringstream content;
+    content << in.rdbuf();
+    return content.str();
+}
+
+} // namespace
+
+std::vector<Node> nodes() {
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) CPU_SET(cpu, &allowed);
+    }
+
+    std::vector<Node> result;
+    if (DIR* dir = ::opendir(NODE_DIR)) {
+        while (dirent* entry = ::readdir(dir)) {
+            int id;
+            char trailing;
+            if (std::sscanf(entry->d_name, "node%d%c", &id, &trailing) != 1) continue;
+            Node node;
+            node.id = id;
+            std::string path = std::string(NODE_DIR) + "/" + entry->d_name + "/cpulist";
+            for (int cpu : parse_cpulist(read_file(path))) {
+                if (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed)) node.cpus.push_back(cpu);
+            }
+            if (!node.cpus.empty()) result.push_back(std::move(node));
+        }
+        ::closedir(dir);
+    }
+    std::sort(result.begin(), result.end(),
+              [](const Node& a, const Node& b) { return a.id < b.id; });
+
+    if (result.empty()) {
+        Node node;
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+            if (CPU_ISSET(cpu, &allowed)) node.cpus.push_back(cpu);
+        }
+        result.push_back(std::move(node));
+    }
+    return result;
+}
+
+size_t current_node(const std::vector<Node>& nodes) {
+    int cpu = sched_getcpu();
+    for (size_t i = 0; i < nodes.size(); i++) {
+        const std::vector<int>& cpus = nodes[i].cpus;
+        if (std::find(cpus.begin(), cpus.end(), cpu) != cpus.end()) return i;
+    }
+    return 0;
+}
+
+bool pin_thread(const Node& node) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : node.cpus) {
+        if (cpu < CPU_SETSIZE) CPU_SET(cpu, &set);
+    }
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+bool prefer_memory(const Node& node) {
+    const size_t BITS = 8 * sizeof(unsigned long);
+    std::vector<unsigned long> mask(static_cast<size_t>(node.id) / BITS + 1, 0);
+    mask[static_cast<size_t>(node.id) / BITS] |= 1ul << (static_cast<size_t>(node.id) % BITS);
+    return ::syscall(SYS_set_mempolicy, MPOL_PREFERRED, mask.data(),
+                     mask.size() * BITS + 1) == 0;
+}
+
+PageCounts page_counts(int node) {
+    PageCounts counts;
+    std::stringstream in(read_file(std::string(NODE_DIR) + "/node" + std::to_string(node) +
+                                   "/numastat"));
+    std::string name;
+    uint64_t value;
+    while (in >> name >> value) {
+        if (name == "local_node") counts.local = value;
+        else if (name == "other_node") counts.remote = value;
+    }
+    return counts;
+}
+
+} // namespace numa
+} // namespace spatio
@@ -0,0 +1,272 @@
+#include "polygon_index.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace spatio {
+
+PolygonIndex::PolygonIndex(size_t max_grid_resolution)
+    : max_grid_resolution_(std::max<size_t>(max_grid_resolution, 1)) {}
+
+void PolygonIndex::add_polygon(uint64_t polygon_id,
+                               const std::vector<std::pair<double, double>>& vertices) {
+    if (vertices.size() < 3) {
+        throw std::invalid_argument("PolygonIndex: a polygon needs at least 3 vertices");
+    }
+
+    std::vector<std::pair<double, double>> ring(vertices);
+    // Drop an explicit closing vertex; rings are closed implicitly
+    if (ring.size() > 3 && ring.front() == ring.back()) {
+        ring.pop_back();
+    }
+
+    Polygon poly;
+    poly.id = polygon_id;
+    poly.min_lat = poly.max_lat = ring[0].first;
+    poly.min_lon = poly.max_lon = ring[0].second;
+    for (const auto& [lat, lon] : ring) {
+        poly.min_lat = std::min(poly.min_lat, lat);
+        poly.max_lat = std::max(poly.max_lat, lat);
+        poly.min_lon = std::min(poly.min_lon, lon);
+        poly.max_lon = std::max(poly.max_lon, lon);
+    }
+
+    polygons_.push_back(poly);
+    vertices_.push_back(std::move(ring));
+    built_ = false;
+}
+
+void PolygonIndex::build() {
+    cells_.clear();
+    row_offsets_.clear();
+    edges_.clear();
+
+    std::vector<RTreeBox<2>> boxes;
+    boxes.reserve(polygons_.size());
+    for (size_t i = 0; i < polygons_.size(); i++) {
+        build_grid(i);
+        const Polygon& poly = polygons_[i];
+        boxes.push_back({{poly.min_lat, poly.min_lon}, {poly.max_lat, poly.max_lon}});
+    }
+    rtree_.build(boxes);
+    built_ = true;
+}
+
+// ==================== QUERIES ====================
+
+std::vector<uint64_t> PolygonIndex::containing_polygons(double lat, double lon) const {
+    std::vector<uint64_t> out;
+    containing_polygons(lat, lon, out);
+    return out;
+}
+
+void PolygonIndex::containing_polygons(double lat, double lon, std::vector<uint64_t>& out) const {
+    if (!built_) return;
+
+    RTreeBox<2> point{{lat, lon}, {lat, lon}};
+    rtree_.query(point, [&](uint32_t idx) {
+        const Polygon& poly = polygons_[idx];
+        if (contains(poly, lat, lon)) {
+            out.push_back(poly.id);
+        }
+    });
+}
+
+namespace {
+
+// Spread the low 16 bits of x to the even bit positions
+inline uint32_t part1by1(uint32_t x) {
+    x &= 0x0000ffff;
+    x = (x | (x << 8)) & 0x00ff00ff;
+    x = (x | (x << 4)) & 0x0f0f0f0f;
+    x = (x | (x << 2)) & 0x33333333;
+    x = (x | (x << 1)) & 0x55555555;
+    return x;
+}
+
+} // namespace
+
+void PolygonIndex::containing_polygons_batch(const double* lats, const double* lons, size_t n,
+                                             std::vector<uint64_t>& offsets,
+                                             std::vector<uint64_t>& ids) const {
+    offsets.assign(1, 0);
+    ids.clear();
+    offsets.reserve(n + 1);
+
+    if (n < BATCH_SORT_THRESHOLD) {
+        for (size_t i = 0; i < n; i++) {
+            containing_polygons(lats[i], lons[i], ids);
+            offsets.push_back(ids.size());
+        }
+        return;
+    }
+
+    // Visit points in Morton order so consecutive lookups hit the same
+    // R-tree nodes and polygon grids while they are still in cache
+    double lat_min = lats[0], lat_max = lats[0], lon_min = lons[0], lon_max = lons[0];
+    for (size_t i = 1; i < n; i++) {
+        lat_min = std::min(lat_min, lats[i]);
+        lat_max = std::max(lat_max, lats[i]);
+        lon_min = std::min(lon_min, lons[i]);
+        lon_max = std::max(lon_max, lons[i]);
+    }
+    double lat_scale = 65535.0 / std::max(lat_max - lat_min, 1e-12);
+    double lon_scale = 65535.0 / std::max(lon_max - lon_min, 1e-12);
+
+    std::vector<uint64_t> order(n);
+    for (size_t i = 0; i < n; i++) {
+        uint32_t qa = static_cast<uint32_t>((lats[i] - lat_min) * lat_scale);
+        uint32_t qo = static_cast<uint32_t>((lons[i] - lon_min) * lon_scale);
+        uint64_t code = (part1by1(qa) << 1) | part1by1(qo);
+        order[i] = (code << 32) | i;
+    }
+    std::sort(order.begin(), order.end());
+
+    // Evaluate in sorted order, then lay results out by input position
+    std::vector<uint64_t> sorted_ids;
+    std::vector<uint32_t> begin(n), count(n);
+    for (uint64_t key : order) {
+        uint32_t i = static_cast<uint32_t>(key);
+        begin[i] = static_cast<uint32_t>(sorted_ids.size());
+        containing_polygons(lats[i], lons[i], sorted_ids);
+        count[i] = static_cast<uint32_t>(sorted_ids.size() - begin[i]);
+    }
+
+    ids.resize(sorted_ids.size());
+    for (size_t i = 0; i < n; i++) {
+        std::copy_n(sorted_ids.begin() + begin[i], count[i], ids.begin() + offsets.back());
+        offsets.push_back(offsets.back() + count[i]);
+    }
+}
+
+void PolygonIndex::clear() {
+    polygons_.clear();
+    vertices_.clear();
+    cells_.clear();
+    row_offsets_.clear();
+    edges_.clear();
+    rtree_.clear();
+    built_ = false;
+}
+
+// ==================== EDGE GRID ====================
+
+void PolygonIndex::build_grid(size_t poly_idx) {
+    Polygon& poly = polygons_[poly_idx];
+    const auto& ring = vertices_[poly_idx];
+    size_t n = ring.size();
+    size_t res = static_cast<size_t>(std::ceil(2.0 * std::sqrt(static_cast<double>(n))));
+    res = std::min(std::max<size_t>(res, 4), max_grid_resolution_);
+
+    poly.rows = static_cast<uint32_t>(res);
+    poly.cols = static_cast<uint32_t>(res);
+    poly.cell_lat = std::max(poly.max_lat - poly.min_lat, 1e-12) / poly.rows;
+    poly.cell_lon = std::max(poly.max_lon - poly.min_lon, 1e-12) / poly.cols;
+    poly.cells_begin = static_cast<uint32_t>(cells_.size());
+    poly.row_offsets_begin = static_cast<uint32_t>(row_offsets_.size());
+
+    auto row_of = [&](double lat) {
+        double r = std::floor((lat - poly.min_lat) / poly.cell_lat);
+        return static_cast<uint32_t>(std::min(std::max(r, 0.0), poly.rows - 1.0));
+    };
+    auto col_of = [&](double lon) {
+        double c = std::floor((lon - poly.min_lon) / poly.cell_lon);
+        return static_cast<uint32_t>(std::min(std::max(c, 0.0), poly.cols - 1.0));
+    };
+
+    // Row -> edges overlapping the row's latitude band (CSR, two passes)
+    std::vector<uint32_t> row_count(poly.rows, 0);
+    for (size_t e = 0; e < n; e++) {
+        size_t f = (e + 1) % n;
+        uint32_t r0 = row_of(std::min(ring[e].first, ring[f].first));
+        uint32_t r1 = row_of(std::max(ring[e].first, ring[f].first));
+        for (uint32_t r = r0; r <= r1; r++) row_count[r]++;
+    }
+    std::vector<uint32_t> fill(poly.rows);
+    uint32_t offset = static_cast<uint32_t>(edges_.size());
+    for (uint32_t r = 0; r < poly.rows; r++) {
+        row_offsets_.push_back(offset);
+        fill[r] = offset;
+        offset += row_count[r];
+    }
+    row_offsets_.push_back(offset);
+    edges_.resize(offset);
+
+    // Mark every cell an edge passes through as boundary
+    cells_.resize(cells_.size() + static_cast<size_t>(poly.rows) * poly.cols, OUTSIDE);
+    uint8_t* cells = cells_.data() + poly.cells_begin;
+    for (size_t e = 0; e < n; e++) {
+        size_t f = (e + 1) % n;
+        double la = ring[e].first, lb = ring[f].first;
+        double oa = ring[e].second, ob = ring[f].second;
+        uint32_t r0 = row_of(std::min(la, lb));
+        uint32_t r1 = row_of(std::max(la, lb));
+
+        for (uint32_t r = r0; r <= r1; r++) {
+            edges_[fill[r]++] = {la, oa, lb, ob};
+
+            // Longitude extent of the edge clipped to this row's band
+            double lon_lo, lon_hi;
+            if (la == lb) {
+                lon_lo = std::min(oa, ob);
+                lon_hi = std::max(oa, ob);
+            } else {
+                double band_lo = std::max(poly.min_lat + r * poly.cell_lat, std::min(la, lb));
+                double band_hi = std::min(poly.min_lat + (r + 1) * poly.cell_lat, std::max(la, lb));
+                double x0 = oa + (band_lo - la) * (ob - oa) / (lb - la);
+                double x1 = oa + (band_hi - la) * (ob - oa) / (lb - la);
+                lon_lo = std::min(x0, x1);
+                lon_hi = std::max(x0, x1);
+            }
+            for (uint32_t c = col_of(lon_lo); c <= col_of(lon_hi); c++) {
+                cells[static_cast<size_t>(r) * poly.cols + c] = BOUNDARY;
+            }
+        }
+    }
+
+    // No edge touches the remaining cells: one ray cast from the center
+    // decides the whole cell
+    for (uint32_t r = 0; r < poly.rows; r++) {
+        double center_lat = poly.min_lat + (r + 0.5) * poly.cell_lat;
+        for (uint32_t c = 0; c < poly.cols; c++) {
+            uint8_t& cell = cells[static_cast<size_t>(r) * poly.cols + c];
+            if (cell == BOUNDARY) continue;
+            double center_lon = poly.min_lon + (c + 0.5) * poly.cell_lon;
+            cell = ray_cast(poly, r, center_lat, center_lon) ? INSIDE : OUTSIDE;
+        }
+    }
+}
+
+bool PolygonIndex::contains(const Polygon& poly, double lat, double lon) const {
+    if (lat < poly.min_lat || lat > poly.max_lat || lon < poly.min_lon || lon > poly.max_lon) {
+        return false;
+    }
+
+    double rf = std::floor((lat - poly.min_lat) / poly.cell_lat);
+    double cf = std::floor((lon - poly.min_lon) / poly.cell_lon);
+    uint32_t r = static_cast<uint32_t>(std::min(std::max(rf, 0.0), poly.rows - 1.0));
+    uint32_t c = static_cast<uint32_t>(std::min(std::max(cf, 0.0), poly.cols - 1.0));
+
+    uint8_t state = cells_[poly.cells_begin + static_cast<size_t>(r) * poly.cols + c];
+    if (state != BOUNDARY) {
+        return state == INSIDE;
+    }
+    return ray_cast(poly, r, lat, lon);
+}
+
+bool PolygonIndex::ray_cast(const Polygon& poly, uint32_t row, double lat, double lon) const {
+    // Even-odd rule with a ray towards +lon; only edges crossing this
+    // latitude can flip the parity, and all of them are listed in the row
+    const uint32_t* offsets = row_offsets_.data() + poly.row_offsets_begin;
+    bool inside = false;
+    for (uint32_t k = offsets[row]; k < offsets[row + 1]; k++) {
+        const Edge& edge = edges_[k];
+        if ((edge.lat0 > lat) != (edge.lat1 > lat)) {
+            double x = edge.lon0 + (lat - edge.lat0) * (edge.lon1 - edge.lon0) / (edge.lat1 - edge.lat0);
+            if (lon < x) inside = !inside;
+        }
+    }
+    return inside;
+}
+
+} // namespace spatio
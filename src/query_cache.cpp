@@ -0,0 +1,227 @@
+#include "query_cache.hpp"
+#include "utils.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace spatio {
+
+namespace {
+
+// Quantize a parameter to an integer key, returning the snapped value.
+// Exact mode (quantum 0) keys on the bit pattern instead.
+int64_t quantize(double value, double quantum, double& snapped) {
+    if (quantum > 0.0) {
+        double steps = std::round(value / quantum);
+        if (std::isfinite(steps) && std::fabs(steps) < 9.0e18) {
+            snapped = steps * quantum;
+            return static_cast<int64_t>(steps);
+        }
+    }
+    snapped = value;
+    int64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+} // namespace
+
+bool QueryCache::Query::operator==(const Query& other) const {
+    return kind == other.kind && std::equal(key, key + 6, other.key);
+}
+
+size_t QueryCache::QueryHash::operator()(const Query& q) const {
+    uint64_t h = 1469598103934665603ULL ^ q.kind;
+    for (int64_t k : q.key) {
+        h ^= static_cast<uint64_t>(k) + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+    }
+    return static_cast<size_t>(h);
+}
+
+QueryCache::QueryCache(const Config& config)
+    : config_(config), partition_epochs_(NUM_PARTITIONS, 0) {
+    if (config_.partition_deg <= 0.0) {
+        config_.partition_deg = 1.0;
+    }
+    stats_.max_bytes = config_.max_bytes;
+}
+
+// ==================== NORMALIZATION ====================
+
+QueryCache::Query QueryCache::normalize_radius_time(float center_lat, float center_lon,
+                                                    double radius_km,
+                                                    double t_start, double t_end) const {
+    Query q;
+    q.kind = Query::RadiusTime;
+    double lat, lon;
+    q.key[0] = quantize(center_lat, config_.coord_quantum, lat);
+    q.key[1] = quantize(center_lon, config_.coord_quantum, lon);
+    q.key[2] = quantize(radius_km, config_.radius_quantum_km, q.radius_km);
+    q.key[3] = 0;
+    q.key[4] = quantize(t_start, config_.time_quantum, q.t_start);
+    q.key[5] = quantize(t_end, config_.time_quantum, q.t_end);
+    q.lat_a = static_cast<float>(lat);
+    q.lon_a = static_cast<float>(lon);
+
+    radius_bbox(lat, lon, q.radius_km, q.region_lat_min, q.region_lat_max,
+                q.region_lon_min, q.region_lon_max);
+    return q;
+}
+
+QueryCache::Query QueryCache::normalize_box_time(float lat_min, float lon_min,
+                                                 float lat_max, float lon_max,
+                                                 double t_start, double t_end) const {
+    Query q;
+    q.kind = Query::BoxTime;
+    double a_lat, a_lon, b_lat, b_lon;
+    q.key[0] = quantize(lat_min, config_.coord_quantum, a_lat);
+    q.key[1] = quantize(lon_min, config_.coord_quantum, a_lon);
+    q.key[2] = quantize(lat_max, config_.coord_quantum, b_lat);
+    q.key[3] = quantize(lon_max, config_.coord_quantum, b_lon);
+    q.key[4] = quantize(t_start, config_.time_quantum, q.t_start);
+    q.key[5] = quantize(t_end, config_.time_quantum, q.t_end);
+    q.lat_a = static_cast<float>(a_lat);
+    q.lon_a = static_cast<float>(a_lon);
+    q.lat_b = static_cast<float>(b_lat);
+    q.lon_b = static_cast<float>(b_lon);
+    q.region_lat_min = a_lat;
+    q.region_lat_max = b_lat;
+    q.region_lon_min = a_lon;
+    q.region_lon_max = b_lon;
+    return q;
+}
+
+// ==================== LOOKUP / STORE ====================
+
+bool QueryCache::lookup(const Query& query, std::vector<uint64_t>& out, uint64_t& fill_epoch) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    fill_epoch = global_epoch_;
+
+    auto it = map_.find(query);
+    if (it == map_.end()) {
+        stats_.misses++;
+        return false;
+    }
+    if (!is_valid(*it->second)) {
+        stats_.stale++;
+        stats_.misses++;
+        erase(it->second);
+        return false;
+    }
+
+    lru_.splice(lru_.begin(), lru_, it->second);
+    out = it->second->ids;
+    stats_.hits++;
+    return true;
+}
+
+void QueryCache::store(const Query& query, const std::vector<uint64_t>& ids, uint64_t fill_epoch) {
+    std::vector<uint32_t> partitions;
+    collect_partitions(query, partitions);
+
+    size_t bytes = sizeof(Entry) + ids.size() * sizeof(uint64_t) +
+                   partitions.size() * sizeof(std::pair<uint32_t, uint64_t>);
+    // Results that would take over most of the budget are not worth caching
+    if (bytes > config_.max_bytes / 8) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (fill_epoch != global_epoch_) {
+        return;  // A write landed while the query ran
+    }
+
+    auto existing = map_.find(query);
+    if (existing != map_.end()) {
+        erase(existing->second);
+    }
+
+    Entry entry{query, ids, global_epoch_, {}, bytes};
+    entry.partitions.reserve(partitions.size());
+    for (uint32_t p : partitions) {
+        entry.partitions.emplace_back(p, partition_epochs_[p]);
+    }
+
+    lru_.push_front(std::move(entry));
+    map_[query] = lru_.begin();
+    stats_.bytes += bytes;
+    stats_.entries++;
+
+    while (stats_.bytes > config_.max_bytes && !lru_.empty()) {
+        erase(std::prev(lru_.end()));
+        stats_.evictions++;
+    }
+}
+
+// ==================== INVALIDATION ====================
+
+void QueryCache::on_write(float lat, float lon) {
+    long cell_lat = static_cast<long>(std::floor(lat / config_.partition_deg));
+    long cell_lon = static_cast<long>(std::floor(lon / config_.partition_deg));
+    size_t p = partition_of(cell_lat, cell_lon);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    partition_epochs_[p]++;
+    global_epoch_++;
+}
+
+void QueryCache::invalidate_all() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    lru_.clear();
+    map_.clear();
+    stats_.bytes = 0;
+    stats_.entries = 0;
+    global_epoch_++;
+}
+
+QueryCacheStats QueryCache::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+// ==================== HELPERS ====================
+
+size_t QueryCache::partition_of(long cell_lat, long cell_lon) const {
+    uint64_t h = static_cast<uint64_t>(cell_lat) * 73856093ULL ^
+                 static_cast<uint64_t>(cell_lon) * 19349663ULL;
+    return static_cast<size_t>(h % NUM_PARTITIONS);
+}
+
+void QueryCache::collect_partitions(const Query& query, std::vector<uint32_t>& out) const {
+    out.clear();
+    double pd = config_.partition_deg;
+    double lat_cells = std::floor(query.region_lat_max / pd) - std::floor(query.region_lat_min / pd) + 1;
+    double lon_cells = std::floor(query.region_lon_max / pd) - std::floor(query.region_lon_min / pd) + 1;
+    if (!(lat_cells * lon_cells <= static_cast<double>(MAX_TRACKED_PARTITIONS))) {
+        return;  // Large (or degenerate) region: track the global epoch
+    }
+
+    long lat0 = static_cast<long>(std::floor(query.region_lat_min / pd));
+    long lat1 = static_cast<long>(std::floor(query.region_lat_max / pd));
+    long lon0 = static_cast<long>(std::floor(query.region_lon_min / pd));
+    long lon1 = static_cast<long>(std::floor(query.region_lon_max / pd));
+    for (long a = lat0; a <= lat1; a++) {
+        for (long b = lon0; b <= lon1; b++) {
+            out.push_back(static_cast<uint32_t>(partition_of(a, b)));
+        }
+    }
+}
+
+bool QueryCache::is_valid(const Entry& entry) const {
+    if (entry.partitions.empty()) {
+        return entry.global_epoch == global_epoch_;
+    }
+    for (const auto& [p, epoch] : entry.partitions) {
+        if (partition_epochs_[p] != epoch) return false;
+    }
+    return true;
+}
+
+void QueryCache::erase(std::list<Entry>::iterator it) {
+    stats_.bytes -= it->bytes;
+    stats_.entries--;
+    map_.erase(it->query);
+    lru_.erase(it);
+}
+
+} // namespace spatio
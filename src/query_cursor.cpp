@@ -0,0 +1,130 @@
+#include "query_cursor.hpp"
+#include "utils.hpp"
+#include <stdexcept>
+
+namespace spatio {
+
+QueryCursor::QueryCursor(const SpatialIndex& spatial, const RecordStore& records, Shape shape,
+                         double t_start, double t_end, size_t chunk_size,
+                         std::shared_mutex* mutex)
+    : spatial_(&spatial), records_(&records), mutex_(mutex),
+      structure_version_(spatial.structure_version()), shape_(shape),
+      t_start_(t_start), t_end_(t_end),
+      time_filtered_(t_start != std::numeric_limits<double>::lowest() ||
+                     t_end != std::numeric_limits<double>::max()),
+      chunk_size_(chunk_size == 0 ? DEFAULT_CHUNK_SIZE : chunk_size) {
+    if (spatial.root()) {
+        stack_.push_back(spatial.root());
+    }
+}
+
+QueryCursor QueryCursor::radius(const SpatialIndex& spatial, const RecordStore& records,
+                                float center_lat, float center_lon, double radius_km,
+                                double t_start, double t_end, size_t chunk_size,
+                                std::shared_mutex* mutex) {
+    QueryCursor cursor(spatial, records, Shape::Radius, t_start, t_end, chunk_size, mutex);
+    cursor.center_lat_ = center_lat;
+    cursor.center_lon_ = center_lon;
+    cursor.radius_m_ = radius_km * 1000.0;
+    return cursor;
+}
+
+QueryCursor QueryCursor::box(const SpatialIndex& spatial, const RecordStore& records,
+                             float lat_min, float lon_min, float lat_max, float lon_max,
+                             double t_start, double t_end, size_t chunk_size,
+                             std::shared_mutex* mutex) {
+    QueryCursor cursor(spatial, records, Shape::Box, t_start, t_end, chunk_size, mutex);
+    cursor.lat_min_ = lat_min;
+    cursor.lon_min_ = lon_min;
+    cursor.lat_max_ = lat_max;
+    cursor.lon_max_ = lon_max;
+    return cursor;
+}
+
+size_t QueryCursor::next_batch(uint64_t* out, size_t max_count) {
+    std::shared_lock<std::shared_mutex> lock;
+    if (mutex_) lock = std::shared_lock<std::shared_mutex>(*mutex_);
+    if (spatial_->structure_version() != structure_version_) {
+        stack_.clear();
+        throw std::runtime_error("QueryCursor invalidated: index was cleared or restructured");
+    }
+
+    size_t written = 0;
+    while (written < max_count && !stack_.empty()) {
+        const KDNode* node = stack_.back();
+        stack_.pop_back();
+
+        if (matches(node)) {
+            out[written++] = node->id;
+        }
+        push_children(node);
+    }
+
+    produced_ += written;
+    return written;
+}
+
+std::vector<uint64_t> QueryCursor::next_batch() {
+    std::vector<uint64_t> batch(chunk_size_);
+    batch.resize(next_batch(batch.data(), batch.size()));
+    return batch;
+}
+
+bool QueryCursor::matches(const KDNode* node) const {
+    if (shape_ == Shape::Radius) {
+        float dist = haversine_distance(center_lat_, center_lon_, node->point[0], node->point[1]);
+        if (dist > radius_m_) return false;
+    } else {
+        if (node->point[0] < lat_min_ || node->point[0] > lat_max_ ||
+            node->point[1] < lon_min_ || node->point[1] > lon_max_) {
+            return false;
+        }
+    }
+
+    if (time_filtered_) {
+        const Record* record = records_->get_record_ptr(node->id);
+        return record && record->active_during(t_start_, t_end_);
+    }
+    return true;
+}
+
+void QueryCursor::push_children(const KDNode* node) {
+    // Same pruning rules as the recursive queries in SpatialIndex.
+    // Right is pushed first so the left subtree is visited first,
+    // matching the order of the materializing queries.
+    int axis = node->axis;
+    float node_value = node->split;
+    bool explore_left = true;
+    bool explore_right = true;
+
+    if (shape_ == Shape::Radius) {
+        double plane_dist_m;
+        if (axis == 0) {
+            plane_dist_m = haversine_distance(center_lat_, center_lon_, node_value, center_lon_);
+        } else {
+            plane_dist_m = haversine_distance(center_lat_, center_lon_, center_lat_, node_value);
+        }
+        if (plane_dist_m > radius_m_) {
+            float center_value = (axis == 0) ? center_lat_ : center_lon_;
+            if (center_value < node_value) {
+                explore_right = false;
+            } else {
+                explore_left = false;
+            }
+        }
+    } else {
+        float query_min = (axis == 0) ? lat_min_ : lon_min_;
+        float query_max = (axis == 0) ? lat_max_ : lon_max_;
+        explore_left = query_min <= node_value;
+        explore_right = query_max >= node_value;
+    }
+
+    if (explore_right && node->right) {
+        stack_.push_back(node->right.get());
+    }
+    if (explore_left && node->left) {
+        stack_.push_back(node->left.get());
+    }
+}
+
+} // namespace spatio
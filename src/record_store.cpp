@@ -3,8 +3,12 @@
 namespace spatio {
 
 uint64_t RecordStore::add_record(float lat, float lon, double t) {
+    return add_record(lat, lon, t, t);
+}
+
+uint64_t RecordStore::add_record(float lat, float lon, double t, double t_end) {
     uint64_t id = next_id_++;
-    Record rec(lat, lon, t, id);
+    Record rec(lat, lon, t, t_end, id);
     
     size_t index = records_.size();
     records_.push_back(rec);
@@ -21,10 +25,46 @@ std::optional<Record> RecordStore::get_record(uint64_t id) const {
     return records_[it->second];
 }
 
+const Record* RecordStore::get_record_ptr(uint64_t id) const {
+    auto it = id_to_index_.find(id);
+    if (it == id_to_index_.end()) {
+        return nullptr;
+    }
+    return &records_[it->second];
+}
+
+bool RecordStore::update_record(uint64_t id, float lat, float lon, double t) {
+    auto it = id_to_index_.find(id);
+    if (it == id_to_index_.end()) {
+        return false;
+    }
+    Record& rec = records_[it->second];
+    rec.lat = lat;
+    rec.lon = lon;
+    rec.t = t;
+    rec.t_end = t;
+    return true;
+}
+
 void RecordStore::clear() {
     records_.clear();
     id_to_index_.clear();
     next_id_ = 1;
 }
 
+void RecordStore::serialize(ByteWriter& out) const {
+    out.put<uint64_t>(next_id_);
+    out.put_vector(records_);
+}
+
+void RecordStore::deserialize(ByteReader& in) {
+    clear();
+    next_id_ = in.get<uint64_t>();
+    in.get_vector(records_);
+    id_to_index_.reserve(records_.size());
+    for (size_t i = 0; i < records_.size(); i++) {
+        id_to_index_[records_[i].id] = i;
+    }
+}
+
 } // namespace spatio
@@ -0,0 +1,688 @@
+#include "segmented_index.hpp"
+#include "utils.hpp"
+#include <chrono>
+#include <numeric>
+#include <stdexcept>
+
+namespace spatio {
+
+namespace {
+
+double wall_clock() {
+    return std::chrono::duration<double>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+constexpr double CLOCK_RESOLUTION = 0.01;  // Seconds between clock checkpoints
+
+} // namespace
+
+// ==================== SEGMENT ====================
+
+IndexSegment::IndexSegment(std::vector<SegmentRecord> records) : records_(std::move(records)) {
+    lat_min_ = lon_min_ = std::numeric_limits<float>::max();
+    lat_max_ = lon_max_ = std::numeric_limits<float>::lowest();
+    t_min_ = std::numeric_limits<double>::max();
+    t_max_ = std::numeric_limits<double>::lowest();
+    ids_.reserve(records_.size());
+    for (const SegmentRecord& r : records_) {
+        lat_min_ = std::min(lat_min_, r.lat);
+        lat_max_ = std::max(lat_max_, r.lat);
+        lon_min_ = std::min(lon_min_, r.lon);
+        lon_max_ = std::max(lon_max_, r.lon);
+        t_min_ = std::min(t_min_, r.t);
+        t_max_ = std::max(t_max_, r.t);
+        ids_.push_back(r.id);
+    }
+    std::sort(ids_.begin(), ids_.end());
+
+    build_tree(0, records_.size(), 0);
+
+    time_positions_.resize(records_.size());
+    std::iota(time_positions_.begin(), time_positions_.end(), 0u);
+    std::sort(time_positions_.begin(), time_positions_.end(), [this](uint32_t a, uint32_t b) {
+        return records_[a].t < records_[b].t;
+    });
+    times_.reserve(records_.size());
+    for (uint32_t pos : time_positions_) {
+        times_.push_back(records_[pos].t);
+    }
+}
+
+void IndexSegment::build_tree(size_t lo, size_t hi, int depth) {
+    if (hi - lo <= LEAF_SIZE) return;
+    size_t mid = lo + (hi - lo) / 2;
+    bool by_lat = depth % 2 == 0;
+    std::nth_element(records_.begin() + lo, records_.begin() + mid, records_.begin() + hi,
+                     [by_lat](const SegmentRecord& a, const SegmentRecord& b) {
+                         return by_lat ? a.lat < b.lat : a.lon < b.lon;
+                     });
+    build_tree(lo, mid, depth + 1);
+    build_tree(mid + 1, hi, depth + 1);
+}
+
+bool IndexSegment::contains(uint64_t id) const {
+    return std::binary_search(ids_.begin(), ids_.end(), id);
+}
+
+// ==================== INGEST ====================
+
+SegmentedIndex::SegmentedIndex() : SegmentedIndex(Config()) {}
+
+SegmentedIndex::SegmentedIndex(const Config& config) : config_(config) {
+    if (config_.head_capacity == 0 || config_.merge_factor < 2) {
+        throw std::invalid_argument(
+            "SegmentedIndex: head_capacity must be positive and merge_factor at least 2");
+    }
+    head_ = std::make_shared<std::vector<SegmentRecord>>();
+    head_->reserve(config_.head_capacity);
+    tombstones_ = std::make_shared<std::unordered_map<uint64_t, uint64_t>>();
+    if (config_.background) {
+        worker_ = std::thread(&SegmentedIndex::worker_loop, this);
+    }
+}
+
+SegmentedIndex::~SegmentedIndex() {
+    if (worker_.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(work_mutex_);
+            stop_ = true;
+        }
+        work_cv_.notify_one();
+        worker_.join();
+    }
+}
+
+uint64_t SegmentedIndex::insert(float lat, float lon, double t) {
+    uint64_t id;
+    bool sealed;
+    {
+        auto lock = write_lock();
+        stamp_clock_locked();
+        id = append_locked(lat, lon, t);
+        sealed = head_->empty();
+    }
+    if (sealed) notify_worker();
+    return id;
+}
+
+std::vector<uint64_t> SegmentedIndex::bulk_insert(const std::vector<SegmentRecord>& records) {
+    std::vector<uint64_t> ids;
+    ids.reserve(records.size());
+    size_t sealed_before;
+    size_t sealed_after;
+    {
+        auto lock = write_lock();
+        stamp_clock_locked();
+        sealed_before = sealed_.size();
+        for (const SegmentRecord& r : records) {
+            ids.push_back(append_locked(r.lat, r.lon, r.t));
+        }
+        sealed_after = sealed_.size();
+    }
+    if (sealed_after != sealed_before) notify_worker();
+    return ids;
+}
+
+uint64_t SegmentedIndex::append_locked(float lat, float lon, double t) {
+    uint64_t id = next_version_++;
+    head_->push_back({lat, lon, t, id});
+    live_++;
+    if (head_->size() >= config_.head_capacity) {
+        seal_locked();
+    }
+    return id;
+}
+
+void SegmentedIndex::seal_locked() {
+    if (head_->empty()) return;
+    // Snapshots may share the old head; it is immutable from here on
+    sealed_.push_back(std::move(head_));
+    head_ = std::make_shared<std::vector<SegmentRecord>>();
+    head_->reserve(config_.head_capacity);
+}
+
+std::unordered_map<uint64_t, uint64_t>& SegmentedIndex::mutable_tombstones() {
+    // Sharing is recorded under mutex_ rather than read from use_count(),
+    // whose relaxed load does not order the sharer's reads before our writes
+    if (tombstones_shared_.load(std::memory_order_relaxed) ||
+        tombstones_.get() == compacting_tombstones_) {
+        tombstones_ = std::make_shared<std::unordered_map<uint64_t, uint64_t>>(*tombstones_);
+        tombstones_shared_.store(false, std::memory_order_relaxed);
+    }
+    return *tombstones_;
+}
+
+void SegmentedIndex::stamp_clock_locked() {
+    double now = wall_clock();
+    if (clock_.empty() || now - clock_.back().first >= CLOCK_RESOLUTION) {
+        clock_.emplace_back(now, next_version_);
+    }
+}
+
+bool SegmentedIndex::remove(uint64_t id) {
+    auto lock = write_lock();
+    if (id >= next_version_ || tombstones_->count(id)) return false;
+
+    // Head and sealed batches hold ascending IDs
+    auto in_batch = [id](const std::vector<SegmentRecord>& batch) {
+        auto it = std::lower_bound(batch.begin(), batch.end(), id,
+                                   [](const SegmentRecord& r, uint64_t v) { return r.id < v; });
+        return it != batch.end() && it->id == id;
+    };
+    bool found = in_batch(*head_);
+    for (size_t i = 0; !found && i < sealed_.size(); i++) {
+        found = in_batch(*sealed_[i]);
+    }
+    for (size_t i = 0; !found && i < segments_.size(); i++) {
+        found = segments_[i]->contains(id);
+    }
+    if (!found) return false;  // Already compacted away
+
+    stamp_clock_locked();
+    mutable_tombstones().emplace(id, next_version_++);
+    live_--;
+    return true;
+}
+
+// ==================== QUERIES ====================
+
+namespace {
+
+// Visit records of head, sealed batches and segments in the box that pass
+// visible(record)
+template <typename Visible, typename Visit>
+void visit_parts(const SegmentRecord* head, size_t head_size,
+                 const std::vector<std::shared_ptr<const std::vector<SegmentRecord>>>& sealed,
+                 const std::vector<std::shared_ptr<const IndexSegment>>& segments,
+                 float lat_min, float lon_min, float lat_max, float lon_max,
+                 double t_start, double t_end, Visible&& visible, Visit&& visit) {
+    auto live = [&](const SegmentRecord& r) {
+        if (visible(r)) visit(r);
+    };
+    auto scan = [&](const SegmentRecord* records, size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            const SegmentRecord& r = records[i];
+            if (r.lat >= lat_min && r.lat <= lat_max && r.lon >= lon_min && r.lon <= lon_max &&
+                r.t >= t_start && r.t <= t_end) {
+                live(r);
+            }
+        }
+    };
+
+    scan(head, head_size);
+    for (const auto& batch : sealed) {
+        scan(batch->data(), batch->size());
+    }
+    for (const auto& segment : segments) {
+        segment->visit_box_time(lat_min, lon_min, lat_max, lon_max, t_start, t_end, live);
+    }
+}
+
+// Current contents: everything not tombstoned
+auto not_removed(const std::unordered_map<uint64_t, uint64_t>& tombstones) {
+    return [&tombstones](const SegmentRecord& r) {
+        return tombstones.empty() || !tombstones.count(r.id);
+    };
+}
+
+// Radius query as a box visit plus a distance check; visit_box(lat_min,
+// lon_min, lat_max, lon_max, visit) runs the box visit
+template <typename VisitBox>
+std::vector<uint64_t> radius_time_query(float center_lat, float center_lon, double radius_km,
+                                        VisitBox&& visit_box) {
+    std::vector<uint64_t> results;
+    double lat_min, lat_max, lon_min, lon_max;
+    radius_bbox(center_lat, center_lon, radius_km, lat_min, lat_max, lon_min, lon_max);
+    double radius_m = radius_km * 1000.0;
+    visit_box(static_cast<float>(lat_min), static_cast<float>(lon_min),
+              static_cast<float>(lat_max), static_cast<float>(lon_max),
+              [&](const SegmentRecord& r) {
+                  if (haversine_distance(center_lat, center_lon, r.lat, r.lon) <= radius_m) {
+                      results.push_back(r.id);
+                  }
+              });
+    return results;
+}
+
+} // namespace
+
+SPATIO_TARGET_CLONES
+std::vector<uint64_t> SegmentedIndex::query_box_time(float lat_min, float lon_min,
+                                                     float lat_max, float lon_max,
+                                                     double t_start, double t_end) const {
+    std::vector<uint64_t> results;
+    auto lock = read_lock();
+    visit_parts(head_->data(), head_->size(), sealed_, segments_,
+                lat_min, lon_min, lat_max, lon_max, t_start, t_end, not_removed(*tombstones_),
+                [&](const SegmentRecord& r) { results.push_back(r.id); });
+    return results;
+}
+
+SPATIO_TARGET_CLONES
+std::vector<uint64_t> SegmentedIndex::query_radius_time(float center_lat, float center_lon,
+                                                        double radius_km,
+                                                        double t_start, double t_end) const {
+    auto lock = read_lock();
+    return radius_time_query(center_lat, center_lon, radius_km,
+                             [&](float lat_min, float lon_min, float lat_max, float lon_max,
+                                 auto&& visit) {
+                                 visit_parts(head_->data(), head_->size(), sealed_, segments_,
+                                             lat_min, lon_min, lat_max, lon_max, t_start, t_end,
+                                             not_removed(*tombstones_), visit);
+                             });
+}
+
+// ==================== TIME TRAVEL ====================
+
+template <typename Visit>
+void SegmentedIndex::visit_as_of_locked(uint64_t version, float lat_min, float lon_min,
+                                        float lat_max, float lon_max,
+                                        double t_start, double t_end, Visit&& visit) const {
+    // Inserted before `version`, and not removed before it
+    const std::unordered_map<uint64_t, uint64_t>& tombstones = *tombstones_;
+    auto visible = [&](const SegmentRecord& r) {
+        if (r.id >= version) return false;
+        auto it = tombstones.find(r.id);
+        return it == tombstones.end() || it->second >= version;
+    };
+    visit_parts(head_->data(), head_->size(), sealed_, segments_,
+                lat_min, lon_min, lat_max, lon_max, t_start, t_end, visible, visit);
+
+    for (const HistorySegment& history : history_) {
+        if (history.max_removed < version) continue;  // All removed by then
+        history.segment->visit_box_time(lat_min, lon_min, lat_max, lon_max, t_start, t_end,
+                                        [&](const SegmentRecord& r) {
+                                            if (r.id < version && removed_at_.at(r.id) >= version) {
+                                                visit(r);
+                                            }
+                                        });
+    }
+}
+
+void SegmentedIndex::check_as_of_locked(uint64_t version) const {
+    if (version > next_version_) {
+        throw std::out_of_range("As-of version " + std::to_string(version) +
+                                " is in the future (current version " +
+                                std::to_string(next_version_) + ")");
+    }
+    if (version < horizon_) {
+        throw std::out_of_range("As-of version " + std::to_string(version) +
+                                " has been garbage collected (oldest version " +
+                                std::to_string(horizon_) + ")");
+    }
+}
+
+std::vector<uint64_t> SegmentedIndex::query_box_time_as_of(uint64_t version,
+                                                           float lat_min, float lon_min,
+                                                           float lat_max, float lon_max,
+                                                           double t_start, double t_end) const {
+    std::vector<uint64_t> results;
+    auto lock = read_lock();
+    check_as_of_locked(version);
+    visit_as_of_locked(version, lat_min, lon_min, lat_max, lon_max, t_start, t_end,
+                       [&](const SegmentRecord& r) { results.push_back(r.id); });
+    return results;
+}
+
+std::vector<uint64_t> SegmentedIndex::query_radius_time_as_of(uint64_t version,
+                                                              float center_lat, float center_lon,
+                                                              double radius_km,
+                                                              double t_start, double t_end) const {
+    auto lock = read_lock();
+    check_as_of_locked(version);
+    return radius_time_query(center_lat, center_lon, radius_km,
+                             [&](float lat_min, float lon_min, float lat_max, float lon_max,
+                                 auto&& visit) {
+                                 visit_as_of_locked(version, lat_min, lon_min, lat_max, lon_max,
+                                                    t_start, t_end, visit);
+                             });
+}
+
+uint64_t SegmentedIndex::version() const {
+    auto lock = read_lock();
+    return next_version_;
+}
+
+uint64_t SegmentedIndex::oldest_version() const {
+    auto lock = read_lock();
+    return horizon_;
+}
+
+uint64_t SegmentedIndex::version_at(double wallclock) const {
+    auto lock = read_lock();
+    if (!clock_.empty() && wallclock < clock_.front().first) {
+        throw std::out_of_range("Wall-clock time is older than the retained history");
+    }
+    return version_at_locked(wallclock);
+}
+
+uint64_t SegmentedIndex::version_at_locked(double wallclock) const {
+    // Every mutation in [checkpoint i, checkpoint i+1) came within
+    // CLOCK_RESOLUTION of checkpoint i's time
+    auto next = std::upper_bound(clock_.begin(), clock_.end(), wallclock,
+                                 [](double t, const std::pair<double, uint64_t>& checkpoint) {
+                                     return t < checkpoint.first;
+                                 });
+    return next == clock_.end() ? next_version_ : next->second;
+}
+
+uint64_t SegmentedIndex::retention_cutoff_locked() const {
+    if (config_.history_retention <= 0.0) return next_version_;
+    return version_at_locked(wall_clock() - config_.history_retention);
+}
+
+void SegmentedIndex::collect_history() {
+    std::lock_guard<std::mutex> compacting(compact_mutex_);
+
+    // history_ and removed_at_ only change under compact_mutex_, so they
+    // can be read without mutex_ below
+    uint64_t cutoff;
+    {
+        auto lock = read_lock();
+        cutoff = retention_cutoff_locked();
+    }
+    bool expired = false;
+    for (const HistorySegment& history : history_) {
+        expired = expired || history.min_removed < cutoff;
+    }
+
+    HistorySegment merged{nullptr, std::numeric_limits<uint64_t>::max(), 0};
+    std::vector<uint64_t> dropped;
+    uint64_t max_dropped = 0;
+    bool rebuild = expired || history_.size() > config_.merge_factor;
+    if (rebuild) {
+        std::vector<SegmentRecord> kept;
+        for (const HistorySegment& history : history_) {
+            for (const SegmentRecord& r : history.segment->records()) {
+                uint64_t removed = removed_at_.at(r.id);
+                if (removed >= cutoff) {
+                    kept.push_back(r);
+                    merged.min_removed = std::min(merged.min_removed, removed);
+                    merged.max_removed = std::max(merged.max_removed, removed);
+                } else {
+                    dropped.push_back(r.id);
+                    max_dropped = std::max(max_dropped, removed + 1);
+                }
+            }
+        }
+        if (!kept.empty()) {
+            merged.segment = std::make_shared<const IndexSegment>(std::move(kept));
+        }
+    }
+
+    auto lock = write_lock();
+    if (rebuild) {
+        history_.clear();
+        if (merged.segment) history_.push_back(std::move(merged));
+        for (uint64_t id : dropped) {
+            removed_at_.erase(id);
+        }
+        horizon_ = std::max(horizon_, max_dropped);
+    }
+
+    // Keep clock checkpoints for the retention period, plus the last one
+    // before it so lookups at its start still resolve
+    double oldest = wall_clock() - config_.history_retention;
+    auto first_kept = std::upper_bound(clock_.begin(), clock_.end(), oldest,
+                                       [](double t, const std::pair<double, uint64_t>& checkpoint) {
+                                           return t < checkpoint.first;
+                                       });
+    if (first_kept - clock_.begin() > 1) {
+        clock_.erase(clock_.begin(), first_kept - 1);
+    }
+}
+
+// ==================== SNAPSHOTS ====================
+
+SegmentedSnapshot SegmentedIndex::snapshot() const {
+    SegmentedSnapshot snapshot;
+    auto lock = read_lock();
+    snapshot.head_ = head_;
+    snapshot.head_data_ = head_->data();
+    snapshot.head_size_ = head_->size();
+    snapshot.sealed_ = sealed_;
+    snapshot.segments_ = segments_;
+    snapshot.tombstones_ = tombstones_;
+    tombstones_shared_.store(true, std::memory_order_relaxed);  // Ordered by mutex_
+    snapshot.live_ = live_;
+    return snapshot;
+}
+
+SPATIO_TARGET_CLONES
+std::vector<uint64_t> SegmentedSnapshot::query_box_time(float lat_min, float lon_min,
+                                                        float lat_max, float lon_max,
+                                                        double t_start, double t_end) const {
+    std::vector<uint64_t> results;
+    if (!tombstones_) return results;  // Default-constructed
+    visit_parts(head_data_, head_size_, sealed_, segments_,
+                lat_min, lon_min, lat_max, lon_max, t_start, t_end, not_removed(*tombstones_),
+                [&](const SegmentRecord& r) { results.push_back(r.id); });
+    return results;
+}
+
+SPATIO_TARGET_CLONES
+std::vector<uint64_t> SegmentedSnapshot::query_radius_time(float center_lat, float center_lon,
+                                                           double radius_km,
+                                                           double t_start, double t_end) const {
+    if (!tombstones_) return {};
+    return radius_time_query(center_lat, center_lon, radius_km,
+                             [&](float lat_min, float lon_min, float lat_max, float lon_max,
+                                 auto&& visit) {
+                                 visit_parts(head_data_, head_size_, sealed_, segments_,
+                                             lat_min, lon_min, lat_max, lon_max, t_start, t_end,
+                                             not_removed(*tombstones_), visit);
+                             });
+}
+
+// ==================== COMPACTION ====================
+
+void SegmentedIndex::flush() {
+    {
+        auto lock = write_lock();
+        if (head_->empty()) return;
+        seal_locked();
+    }
+    notify_worker();
+}
+
+void SegmentedIndex::compact_all() {
+    flush();
+    while (compact_step(false)) {}
+    compact_step(true);
+    collect_history();
+}
+
+void SegmentedIndex::wait_for_compaction() {
+    if (!config_.background) return;  // Inline compaction is already done
+    std::unique_lock<std::mutex> lock(work_mutex_);
+    idle_cv_.wait(lock, [this]() { return !busy_ && !work_pending_; });
+}
+
+bool SegmentedIndex::compact_step(bool major) {
+    std::lock_guard<std::mutex> compacting(compact_mutex_);
+
+    // Pick the work and snapshot the tombstones under the shared lock
+    Batch batch;
+    std::vector<SegmentPtr> inputs;
+    std::shared_ptr<const std::unordered_map<uint64_t, uint64_t>> dead;
+    uint64_t cutoff;
+    {
+        auto lock = read_lock();
+        if (major) {
+            if (segments_.size() > 1 || (!segments_.empty() && !tombstones_->empty())) {
+                inputs = segments_;
+            }
+        } else if (!sealed_.empty()) {
+            batch = sealed_.front();
+        } else {
+            // Lowest tier holding merge_factor segments; oldest first
+            std::vector<std::vector<SegmentPtr>> tiers;
+            for (const SegmentPtr& segment : segments_) {
+                size_t tier = tier_of(segment->size());
+                if (tier >= tiers.size()) tiers.resize(tier + 1);
+                tiers[tier].push_back(segment);
+            }
+            for (auto& tier : tiers) {
+                if (tier.size() >= config_.merge_factor) {
+                    inputs.assign(tier.begin(), tier.begin() + config_.merge_factor);
+                    break;
+                }
+            }
+        }
+        if (!batch && inputs.empty()) return false;
+        dead = tombstones_;  // Shared; removals meanwhile copy it
+        compacting_tombstones_ = dead.get();
+        cutoff = retention_cutoff_locked();
+    }
+
+    // Build without holding the lock; readers keep using the inputs
+    // Removed records go to history if removed within the retention period
+    Compacted result;
+    std::vector<SegmentRecord> records;
+    std::vector<SegmentRecord> retained;
+    auto take = [&](const std::vector<SegmentRecord>& source) {
+        for (const SegmentRecord& r : source) {
+            auto it = dead->empty() ? dead->end() : dead->find(r.id);
+            if (it == dead->end()) {
+                records.push_back(r);
+            } else if (it->second >= cutoff) {
+                retained.push_back(r);
+                result.retained.emplace_back(r.id, it->second);
+            } else {
+                result.dropped.push_back(r.id);
+                result.max_dropped = std::max(result.max_dropped, it->second + 1);
+            }
+        }
+    };
+    if (batch) {
+        records.reserve(batch->size());
+        take(*batch);
+    } else {
+        size_t total = 0;
+        for (const SegmentPtr& segment : inputs) total += segment->size();
+        records.reserve(total);
+        for (const SegmentPtr& segment : inputs) take(segment->records());
+    }
+    if (!records.empty()) {
+        result.output = std::make_shared<const IndexSegment>(std::move(records));
+    }
+    if (!retained.empty()) {
+        result.history.min_removed = std::numeric_limits<uint64_t>::max();
+        for (const auto& entry : result.retained) {
+            result.history.min_removed = std::min(result.history.min_removed, entry.second);
+            result.history.max_removed = std::max(result.history.max_removed, entry.second);
+        }
+        result.history.segment = std::make_shared<const IndexSegment>(std::move(retained));
+    }
+    install(inputs, batch, std::move(result));
+    return true;
+}
+
+void SegmentedIndex::install(const std::vector<SegmentPtr>& inputs, const Batch& batch,
+                             Compacted result) {
+    SegmentPtr& output = result.output;
+    auto lock = write_lock();
+    if (batch) {
+        // Only compaction removes batches, and it is serialized: still in front
+        sealed_.erase(sealed_.begin());
+        if (output) segments_.push_back(std::move(output));
+    } else {
+        // Output takes the place of the oldest input, keeping segments by age
+        auto first = std::find(segments_.begin(), segments_.end(), inputs.front());
+        size_t position = static_cast<size_t>(first - segments_.begin());
+        std::vector<SegmentPtr> remaining;
+        remaining.reserve(segments_.size());
+        for (size_t i = 0; i < segments_.size(); i++) {
+            if (i == position && output) remaining.push_back(output);
+            if (std::find(inputs.begin(), inputs.end(), segments_[i]) == inputs.end()) {
+                remaining.push_back(segments_[i]);
+            }
+        }
+        segments_.swap(remaining);
+    }
+    // The step's reads of the tombstones are done, so install() only copies
+    // them if a snapshot holds them
+    compacting_tombstones_ = nullptr;
+    if (!result.dropped.empty() || !result.retained.empty()) {
+        std::unordered_map<uint64_t, uint64_t>& tombstones = mutable_tombstones();
+        for (uint64_t id : result.dropped) {
+            tombstones.erase(id);
+        }
+        for (const auto& entry : result.retained) {
+            tombstones.erase(entry.first);
+            removed_at_.insert(entry);
+        }
+    }
+    if (result.history.segment) {
+        history_.push_back(std::move(result.history));
+    }
+    horizon_ = std::max(horizon_, result.max_dropped);
+    compactions_++;
+}
+
+size_t SegmentedIndex::tier_of(size_t records) const {
+    size_t tier = 0;
+    size_t bound = config_.head_capacity * config_.merge_factor;
+    while (records >= bound) {
+        tier++;
+        bound *= config_.merge_factor;
+    }
+    return tier;
+}
+
+void SegmentedIndex::notify_worker() {
+    if (!config_.background) {
+        while (compact_step(false)) {}
+        collect_history();
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(work_mutex_);
+        work_pending_ = true;
+    }
+    work_cv_.notify_one();
+}
+
+void SegmentedIndex::worker_loop() {
+    std::unique_lock<std::mutex> lock(work_mutex_);
+    while (true) {
+        work_cv_.wait(lock, [this]() { return stop_ || work_pending_; });
+        if (stop_) return;
+        work_pending_ = false;
+        busy_ = true;
+        lock.unlock();
+        while (compact_step(false)) {}
+        collect_history();
+        lock.lock();
+        busy_ = false;
+        if (!work_pending_) idle_cv_.notify_all();
+    }
+}
+
+// ==================== STATISTICS ====================
+
+size_t SegmentedIndex::size() const {
+    auto lock = read_lock();
+    return live_;
+}
+
+SegmentedIndex::Stats SegmentedIndex::stats() const {
+    auto lock = read_lock();
+    Stats stats;
+    stats.head_records = head_->size();
+    stats.sealed_batches = sealed_.size();
+    stats.segments = segments_.size();
+    for (const SegmentPtr& segment : segments_) {
+        stats.segment_records += segment->size();
+    }
+    stats.tombstones = tombstones_->size();
+    stats.history_segments = history_.size();
+    for (const HistorySegment& history : history_) {
+        stats.history_records += history.segment->size();
+    }
+    stats.compactions = compactions_;
+    return stats;
+}
+
+} // namespace spatio
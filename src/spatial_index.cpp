@@ -2,30 +2,40 @@
 #include "utils.hpp"
 #include <algorithm>
 #include <queue>
+#include <random>
+#include <unordered_set>
 
 namespace spatio {
 
-void SpatialIndex::insert(float lat, float lon, uint64_t id) {
-    insert_recursive(root_, lat, lon, id, 0);
+void SpatialIndex::insert(float lat, float lon, double t, uint64_t id) {
+    insert_recursive(root_, lat, lon, t, t, id, 0);
+    size_++;
+}
+
+void SpatialIndex::insert_interval(float lat, float lon, double t_begin, double t_end,
+                                   uint64_t id) {
+    insert_recursive(root_, lat, lon, t_begin, t_end, id, 0);
     size_++;
 }
 
 void SpatialIndex::insert_recursive(std::unique_ptr<KDNode>& node, float lat, float lon, 
-                                   uint64_t id, int depth) {
+                                   double t, double t_end, uint64_t id, int depth) {
     if (!node) {
         int axis = depth % 2;  // 0 for lat, 1 for lon
-        node = std::make_unique<KDNode>(lat, lon, id, axis);
+        node = std::make_unique<KDNode>(lat, lon, t, t_end, id, axis);
         return;
     }
     
     int axis = node->axis;
     float value = (axis == 0) ? lat : lon;
-    float node_value = node->point[axis];
+    float node_value = node->split;
     
     if (value < node_value) {
-        insert_recursive(node->left, lat, lon, id, depth + 1);
+        insert_recursive(node->left, lat, lon, t, t_end, id, depth + 1);
+        node->left->parent = node.get();
     } else {
-        insert_recursive(node->right, lat, lon, id, depth + 1);
+        insert_recursive(node->right, lat, lon, t, t_end, id, depth + 1);
+        node->right->parent = node.get();
     }
     
     // Update bounding box after insertion
@@ -50,6 +60,7 @@ std::vector<uint64_t> SpatialIndex::radius_query_instrumented(float center_lat,
     return results;
 }
 
+SPATIO_TARGET_CLONES
 void SpatialIndex::radius_query_recursive(const KDNode* node, float center_lat, 
                                           float center_lon, double radius_m,
                                           std::vector<uint64_t>& results) const {
@@ -64,7 +75,7 @@ void SpatialIndex::radius_query_recursive(const KDNode* node, float center_lat,
     // Determine which subtrees to explore using correct Haversine distance
     int axis = node->axis;
     float center_value = (axis == 0) ? center_lat : center_lon;
-    float node_value = node->point[axis];
+    float node_value = node->split;
     
     // Calculate actual distance from query center to the splitting plane
     double plane_dist_m;
@@ -113,7 +124,7 @@ void SpatialIndex::radius_query_instrumented_recursive(const KDNode* node, float
     // Determine which subtrees to explore
     int axis = node->axis;
     float center_value = (axis == 0) ? center_lat : center_lon;
-    float node_value = node->point[axis];
+    float node_value = node->split;
     
     // Calculate distance to splitting plane  
     stats.distance_checks++;
@@ -163,7 +174,7 @@ void SpatialIndex::box_query_recursive(const KDNode* node, float lat_min, float
     
     // Determine which subtrees to explore
     int axis = node->axis;
-    float node_value = node->point[axis];
+    float node_value = node->split;
     
     if (axis == 0) {  // Latitude axis
         if (lat_min <= node_value) {
@@ -182,11 +193,129 @@ void SpatialIndex::box_query_recursive(const KDNode* node, float lat_min, float
     }
 }
 
+// ==================== TIME-PRUNED QUERIES ====================
+
+std::vector<uint64_t> SpatialIndex::radius_query_time(float center_lat, float center_lon,
+                                                      double radius_km,
+                                                      double t_start, double t_end) const {
+    std::vector<uint64_t> results;
+    radius_time_recursive(root_.get(), center_lat, center_lon, radius_km * 1000.0,
+                          t_start, t_end, results);
+    return results;
+}
+
+SPATIO_TARGET_CLONES
+void SpatialIndex::radius_time_recursive(const KDNode* node, float center_lat, float center_lon,
+                                         double radius_m, double t_start, double t_end,
+                                         std::vector<uint64_t>& results) const {
+    // Nothing in this subtree is active during the window
+    if (!node || node->max_t < t_start || node->min_t > t_end) return;
+    
+    if (node->t <= t_end && node->t_end >= t_start &&
+        haversine_distance(center_lat, center_lon, node->point[0], node->point[1]) <= radius_m) {
+        results.push_back(node->id);
+    }
+    
+    int axis = node->axis;
+    float center_value = (axis == 0) ? center_lat : center_lon;
+    float node_value = node->split;
+    double plane_dist_m = (axis == 0)
+        ? haversine_distance(center_lat, center_lon, node_value, center_lon)
+        : haversine_distance(center_lat, center_lon, center_lat, node_value);
+    
+    bool explore_left = plane_dist_m <= radius_m || center_value < node_value;
+    bool explore_right = plane_dist_m <= radius_m || center_value >= node_value;
+    if (explore_left) {
+        radius_time_recursive(node->left.get(), center_lat, center_lon, radius_m,
+                              t_start, t_end, results);
+    }
+    if (explore_right) {
+        radius_time_recursive(node->right.get(), center_lat, center_lon, radius_m,
+                              t_start, t_end, results);
+    }
+}
+
+std::vector<uint64_t> SpatialIndex::box_query_time(float lat_min, float lon_min,
+                                                   float lat_max, float lon_max,
+                                                   double t_start, double t_end) const {
+    std::vector<uint64_t> results;
+    box_time_recursive(root_.get(), lat_min, lon_min, lat_max, lon_max, t_start, t_end, results);
+    return results;
+}
+
+SPATIO_TARGET_CLONES
+void SpatialIndex::box_time_recursive(const KDNode* node, float lat_min, float lon_min,
+                                      float lat_max, float lon_max, double t_start, double t_end,
+                                      std::vector<uint64_t>& results) const {
+    if (!node || node->max_t < t_start || node->min_t > t_end) return;
+    
+    if (node->t <= t_end && node->t_end >= t_start &&
+        in_box(node->point[0], node->point[1], lat_min, lon_min, lat_max, lon_max)) {
+        results.push_back(node->id);
+    }
+    
+    float lo = (node->axis == 0) ? lat_min : lon_min;
+    float hi = (node->axis == 0) ? lat_max : lon_max;
+    if (lo <= node->split) {
+        box_time_recursive(node->left.get(), lat_min, lon_min, lat_max, lon_max,
+                           t_start, t_end, results);
+    }
+    if (hi >= node->split) {
+        box_time_recursive(node->right.get(), lat_min, lon_min, lat_max, lon_max,
+                           t_start, t_end, results);
+    }
+}
+
+size_t SpatialIndex::count_box_time(float lat_min, float lon_min, float lat_max, float lon_max,
+                                   double t_start, double t_end, const CellRange* skip) const {
+    if (skip && skip->empty()) skip = nullptr;
+    return count_box_time_recursive(root_.get(), lat_min, lon_min, lat_max, lon_max,
+                                    t_start, t_end, skip);
+}
+
+SPATIO_TARGET_CLONES
+size_t SpatialIndex::count_box_time_recursive(const KDNode* node, float lat_min, float lon_min,
+                                              float lat_max, float lon_max,
+                                              double t_start, double t_end,
+                                              const CellRange* skip) const {
+    if (!node || node->max_t < t_start || node->min_t > t_end) return 0;
+    if (node->max_lat < lat_min || node->min_lat > lat_max ||
+        node->max_lon < lon_min || node->min_lon > lon_max) {
+        return 0;
+    }
+    
+    bool skip_all = false, skip_none = true;
+    if (skip) {
+        long a0 = skip->lat_cell(node->min_lat), a1 = skip->lat_cell(node->max_lat);
+        long b0 = skip->lon_cell(node->min_lon), b1 = skip->lon_cell(node->max_lon);
+        skip_all = a0 >= skip->lat_lo && a1 <= skip->lat_hi && b0 >= skip->lon_lo && b1 <= skip->lon_hi;
+        skip_none = a1 < skip->lat_lo || a0 > skip->lat_hi || b1 < skip->lon_lo || b0 > skip->lon_hi;
+    }
+    if (skip_all) return 0;
+    
+    // Whole subtree matches
+    if (skip_none && node->min_t >= t_start && node->max_t <= t_end &&
+        node->min_lat >= lat_min && node->max_lat <= lat_max &&
+        node->min_lon >= lon_min && node->max_lon <= lon_max) {
+        return node->subtree_size;
+    }
+    
+    size_t count = node->t <= t_end && node->t_end >= t_start &&
+                   in_box(node->point[0], node->point[1], lat_min, lon_min, lat_max, lon_max) &&
+                   !(skip && skip->contains(node->point[0], node->point[1]));
+    return count +
+           count_box_time_recursive(node->left.get(), lat_min, lon_min, lat_max, lon_max,
+                                    t_start, t_end, skip) +
+           count_box_time_recursive(node->right.get(), lat_min, lon_min, lat_max, lon_max,
+                                    t_start, t_end, skip);
+}
+
 std::vector<uint64_t> SpatialIndex::knn_query(float lat, float lon, size_t k) const {
     if (k == 0 || !root_) return {};
     
     std::vector<KNNCandidate> candidates;
     knn_recursive(root_.get(), lat, lon, k, candidates);
+    std::sort_heap(candidates.begin(), candidates.end());  // Nearest first
     
     // Extract IDs from candidates
     std::vector<uint64_t> results;
@@ -198,8 +327,39 @@ std::vector<uint64_t> SpatialIndex::knn_query(float lat, float lon, size_t k) co
     return results;
 }
 
+ApproxKNNResult SpatialIndex::knn_query_approx(float lat, float lon, size_t k,
+                                              double epsilon) const {
+    ApproxKNNResult result;
+    result.epsilon = std::max(0.0, epsilon);
+    if (k == 0 || !root_) return result;
+    
+    std::vector<KNNCandidate> candidates;
+    double min_approx_prune = std::numeric_limits<double>::max();
+    knn_recursive(root_.get(), lat, lon, k, candidates, 1.0 + result.epsilon, &min_approx_prune);
+    
+    // The heap top is the k-th (farthest kept) candidate
+    double kth_distance = candidates.empty() ? 0.0 : candidates.front().distance;
+    std::sort_heap(candidates.begin(), candidates.end());
+    result.ids.reserve(candidates.size());
+    for (const auto& cand : candidates) {
+        result.ids.push_back(cand.id);
+    }
+    
+    // Anything in a skipped subtree is at least min_approx_prune away, so the
+    // final k-th distance exceeds the true one by at most this ratio
+    if (min_approx_prune < std::numeric_limits<double>::max() && min_approx_prune > 0.0 &&
+        !candidates.empty()) {
+        double ratio = kth_distance / min_approx_prune - 1.0;
+        result.achieved_epsilon = std::min(result.epsilon, std::max(0.0, ratio));
+    }
+    
+    return result;
+}
+
+SPATIO_TARGET_CLONES
 void SpatialIndex::knn_recursive(const KDNode* node, float query_lat, float query_lon,
-                                 size_t k, std::vector<KNNCandidate>& candidates) const {
+                                 size_t k, std::vector<KNNCandidate>& candidates,
+                                 double prune_factor, double* min_approx_prune) const {
     if (!node) return;
     
     //  Calculate distance to current node
@@ -218,25 +378,593 @@ void SpatialIndex::knn_recursive(const KDNode* node, float query_lat, float quer
     // Determine which subtree to explore first
     int axis = node->axis;
     float query_value = (axis == 0) ? query_lat : query_lon;
-    float node_value = node->point[axis];
+    float node_value = node->split;
     
     const KDNode* first = (query_value < node_value) ? node->left.get() : node->right.get();
     const KDNode* second = (query_value < node_value) ? node->right.get() : node->left.get();
     
     // Search the closer subtree
-    knn_recursive(first, query_lat, query_lon, k, candidates);
+    knn_recursive(first, query_lat, query_lon, k, candidates, prune_factor, min_approx_prune);
     
     // Check if we need to search the other subtree
-    double plane_dist;
-    if (axis == 0) {
-        plane_dist = haversine_distance(query_lat, query_lon, node_value, query_lon);
-    } else {
-        plane_dist = haversine_distance(query_lat, query_lon, query_lat, node_value);
+    double plane_dist = split_distance_bound(query_lat, query_lon, axis == 0, node_value);
+    
+    if (candidates.size() < k || plane_dist * prune_factor < candidates[0].distance) {
+        knn_recursive(second, query_lat, query_lon, k, candidates, prune_factor, min_approx_prune);
+    } else if (min_approx_prune && second && plane_dist < candidates[0].distance) {
+        // Exact search would have descended here
+        *min_approx_prune = std::min(*min_approx_prune, plane_dist);
     }
+}
+
+// ==================== APPROXIMATE COUNTING ====================
+
+ApproxCount SpatialIndex::count_radius_time_approx(float center_lat, float center_lon,
+                                                   double radius_km,
+                                                   double t_start, double t_end,
+                                                   double epsilon) const {
+    ApproxCount result;
+    result.epsilon = std::max(0.0, epsilon);
+    double radius_m = radius_km * 1000.0;
+    
+    // Subtrees that may hold both matches and non-matches, largest first.
+    // Each counts toward upper_bound only, so the largest one is the
+    // biggest share of the remaining uncertainty
+    auto smaller = [](const KDNode* a, const KDNode* b) {
+        return a->subtree_size < b->subtree_size;
+    };
+    std::priority_queue<const KDNode*, std::vector<const KDNode*>, decltype(smaller)>
+        partial(smaller);
     
-    if (candidates.size() < k || plane_dist < candidates[0].distance) {
-        knn_recursive(second, query_lat, query_lon, k, candidates);
+    auto classify = [&](const KDNode* node) {
+        if (!node) return;
+        result.nodes_visited++;
+        if (node->max_t < t_start || node->min_t > t_end) return;
+        if (min_distance_to_bbox(center_lat, center_lon, node->min_lat, node->max_lat,
+                                 node->min_lon, node->max_lon) > radius_m) return;
+        result.upper_bound += node->subtree_size;
+        if (node->min_t >= t_start && node->max_t <= t_end &&
+            max_distance_to_bbox(center_lat, center_lon, node->min_lat, node->max_lat,
+                                 node->min_lon, node->max_lon) <= radius_m) {
+            result.lower_bound += node->subtree_size;  // Every record matches
+        } else {
+            partial.push(node);
+        }
+    };
+    
+    // The midpoint of the bounds is the count with the smallest certified
+    // error; stop as soon as that is within epsilon
+    auto settled = [&] {
+        result.count = result.lower_bound + (result.upper_bound - result.lower_bound) / 2;
+        return result.error_bound() <= result.epsilon;
+    };
+    
+    classify(root_.get());
+    while (!settled() && !partial.empty()) {
+        const KDNode* node = partial.top();
+        partial.pop();
+        // Split into the node's own record, which is tested exactly, and
+        // its two children
+        result.upper_bound -= node->subtree_size;
+        if (node->t <= t_end && node->t_end >= t_start &&
+            haversine_distance(center_lat, center_lon, node->point[0], node->point[1]) <= radius_m) {
+            result.lower_bound++;
+            result.upper_bound++;
+        }
+        classify(node->left.get());
+        classify(node->right.get());
     }
+    return result;
+}
+
+double SpatialIndex::min_distance_to_bbox(float query_lat, float query_lon,
+                                          float min_lat, float max_lat,
+                                          float min_lon, float max_lon) const {
+    // Lower bound from two independent constraints: the latitude gap (any
+    // great circle path covers at least that much latitude) and the
+    // perpendicular distance to the nearest bounding meridian
+    const double R = 6371000.0;
+    const double deg = M_PI / 180.0;
+    
+    double lat_gap = 0.0;
+    if (query_lat < min_lat) lat_gap = min_lat - query_lat;
+    else if (query_lat > max_lat) lat_gap = query_lat - max_lat;
+    
+    double lon_gap = 0.0;
+    if (query_lon < min_lon) lon_gap = min_lon - query_lon;
+    else if (query_lon > max_lon) lon_gap = query_lon - max_lon;
+    
+    double meridian_dist = 0.0;
+    if (lon_gap > 0.0) {
+        double s = std::cos(query_lat * deg) * std::sin(std::min(lon_gap, 90.0) * deg);
+        meridian_dist = R * std::asin(std::min(1.0, std::max(0.0, s)));
+    }
+    
+    return std::max(R * lat_gap * deg, meridian_dist);
+}
+
+double SpatialIndex::max_distance_to_bbox(float query_lat, float query_lon,
+                                          float min_lat, float max_lat,
+                                          float min_lon, float max_lon) const {
+    // Distance grows with |dlon| along a parallel and is unimodal along a
+    // meridian, so the farthest point of the box is one of its corners
+    return std::max(std::max(haversine_distance(query_lat, query_lon, min_lat, min_lon),
+                             haversine_distance(query_lat, query_lon, min_lat, max_lon)),
+                    std::max(haversine_distance(query_lat, query_lon, max_lat, min_lon),
+                             haversine_distance(query_lat, query_lon, max_lat, max_lon)));
+}
+
+// ==================== SAMPLING ====================
+
+std::vector<uint64_t> SpatialIndex::sample_radius(float center_lat, float center_lon,
+                                                  double radius_km, size_t n, uint64_t seed,
+                                                  const std::function<bool(uint64_t)>& filter) const {
+    double radius_m = radius_km * 1000.0;
+    std::vector<CoverItem> cover;
+    radius_cover_recursive(root_.get(), center_lat, center_lon, radius_m, cover);
+    
+    auto contains = [&](const KDNode* node) {
+        return haversine_distance(center_lat, center_lon, node->point[0], node->point[1]) <= radius_m;
+    };
+    return sample_from_cover(cover, n, seed, contains, filter);
+}
+
+std::vector<uint64_t> SpatialIndex::sample_box(float lat_min, float lon_min,
+                                               float lat_max, float lon_max,
+                                               size_t n, uint64_t seed,
+                                               const std::function<bool(uint64_t)>& filter) const {
+    std::vector<CoverItem> cover;
+    box_cover_recursive(root_.get(), lat_min, lon_min, lat_max, lon_max, cover);
+    
+    auto contains = [&](const KDNode* node) {
+        return in_box(node->point[0], node->point[1], lat_min, lon_min, lat_max, lon_max);
+    };
+    return sample_from_cover(cover, n, seed, contains, filter);
+}
+
+void SpatialIndex::radius_cover_recursive(const KDNode* node, float center_lat, float center_lon,
+                                          double radius_m, std::vector<CoverItem>& cover) const {
+    if (!node) return;
+    
+    // Whole subtree inside the circle if its farthest bbox corner is. Sampled
+    // points are re-checked exactly regardless.
+    if (max_distance_to_bbox(center_lat, center_lon, node->min_lat, node->max_lat,
+                             node->min_lon, node->max_lon) <= radius_m) {
+        cover.push_back({node, true});
+        return;
+    }
+    
+    if (haversine_distance(center_lat, center_lon, node->point[0], node->point[1]) <= radius_m) {
+        cover.push_back({node, false});
+    }
+    
+    // Same plane pruning as radius_query_recursive
+    int axis = node->axis;
+    float center_value = (axis == 0) ? center_lat : center_lon;
+    float node_value = node->split;
+    double plane_dist_m = (axis == 0)
+        ? haversine_distance(center_lat, center_lon, node_value, center_lon)
+        : haversine_distance(center_lat, center_lon, center_lat, node_value);
+    
+    bool explore_left = true;
+    bool explore_right = true;
+    if (plane_dist_m > radius_m) {
+        if (center_value < node_value) {
+            explore_right = false;
+        } else {
+            explore_left = false;
+        }
+    }
+    
+    if (explore_left) {
+        radius_cover_recursive(node->left.get(), center_lat, center_lon, radius_m, cover);
+    }
+    if (explore_right) {
+        radius_cover_recursive(node->right.get(), center_lat, center_lon, radius_m, cover);
+    }
+}
+
+void SpatialIndex::box_cover_recursive(const KDNode* node, float lat_min, float lon_min,
+                                       float lat_max, float lon_max,
+                                       std::vector<CoverItem>& cover) const {
+    if (!node) return;
+    
+    // Prune subtrees whose bbox misses the query box entirely
+    if (node->max_lat < lat_min || node->min_lat > lat_max ||
+        node->max_lon < lon_min || node->min_lon > lon_max) {
+        return;
+    }
+    
+    if (node->min_lat >= lat_min && node->max_lat <= lat_max &&
+        node->min_lon >= lon_min && node->max_lon <= lon_max) {
+        cover.push_back({node, true});
+        return;
+    }
+    
+    if (in_box(node->point[0], node->point[1], lat_min, lon_min, lat_max, lon_max)) {
+        cover.push_back({node, false});
+    }
+    
+    box_cover_recursive(node->left.get(), lat_min, lon_min, lat_max, lon_max, cover);
+    box_cover_recursive(node->right.get(), lat_min, lon_min, lat_max, lon_max, cover);
+}
+
+std::vector<uint64_t> SpatialIndex::sample_from_cover(
+    const std::vector<CoverItem>& cover, size_t n, uint64_t seed,
+    const std::function<bool(const KDNode*)>& contains,
+    const std::function<bool(uint64_t)>& filter) const {
+    
+    std::vector<uint64_t> results;
+    if (n == 0 || cover.empty()) return results;
+    
+    auto accept = [&](const KDNode* node) {
+        return contains(node) && (!filter || filter(node->id));
+    };
+    
+    // Prefix sums of piece weights: a uniform draw over [0, total) picks a
+    // piece proportionally to its size and a rank inside it at the same time
+    std::vector<size_t> prefix;
+    prefix.reserve(cover.size());
+    size_t total = 0;
+    for (const auto& item : cover) {
+        total += item.whole_subtree ? item.node->subtree_size : 1;
+        prefix.push_back(total);
+    }
+    
+    std::mt19937_64 rng(seed);
+    
+    // Exact path: enumerate every match in the cover, then partial shuffle
+    auto enumerate_and_pick = [&]() {
+        std::vector<uint64_t> matches;
+        std::vector<const KDNode*> stack;
+        for (const auto& item : cover) {
+            if (!item.whole_subtree) {
+                if (accept(item.node)) matches.push_back(item.node->id);
+                continue;
+            }
+            stack.push_back(item.node);
+            while (!stack.empty()) {
+                const KDNode* node = stack.back();
+                stack.pop_back();
+                if (accept(node)) matches.push_back(node->id);
+                if (node->left) stack.push_back(node->left.get());
+                if (node->right) stack.push_back(node->right.get());
+            }
+        }
+        size_t take = std::min(n, matches.size());
+        for (size_t i = 0; i < take; i++) {
+            std::uniform_int_distribution<size_t> pick(i, matches.size() - 1);
+            std::swap(matches[i], matches[pick(rng)]);
+        }
+        matches.resize(take);
+        return matches;
+    };
+    
+    // Few candidates relative to n: rejection would mostly draw duplicates
+    if (total <= 2 * n) {
+        return enumerate_and_pick();
+    }
+    
+    std::unordered_set<uint64_t> chosen;
+    chosen.reserve(n * 2);
+    results.reserve(n);
+    std::uniform_int_distribution<size_t> pick(0, total - 1);
+    size_t max_attempts = 32 * n + 1024;
+    
+    for (size_t attempt = 0; attempt < max_attempts && results.size() < n; attempt++) {
+        size_t r = pick(rng);
+        size_t idx = std::upper_bound(prefix.begin(), prefix.end(), r) - prefix.begin();
+        const KDNode* node = cover[idx].node;
+        
+        if (cover[idx].whole_subtree) {
+            // Descend by subtree counts to the node of in-order rank `offset`
+            size_t offset = r - (idx > 0 ? prefix[idx - 1] : 0);
+            while (true) {
+                size_t left_size = node->left ? node->left->subtree_size : 0;
+                if (offset < left_size) {
+                    node = node->left.get();
+                } else if (offset == left_size) {
+                    break;
+                } else {
+                    offset -= left_size + 1;
+                    node = node->right.get();
+                }
+            }
+        }
+        
+        // Rejection handles partially covered pieces and the filter
+        if (accept(node) && chosen.insert(node->id).second) {
+            results.push_back(node->id);
+        }
+    }
+    
+    // Rejection rate too high (very selective filter or n close to the
+    // match count): fall back to the exact path so the sample stays uniform
+    if (results.size() < n) {
+        return enumerate_and_pick();
+    }
+    
+    return results;
+}
+
+// ==================== MOVING OBJECTS ====================
+
+bool SpatialIndex::find_path(uint64_t id, float lat, float lon,
+                             std::vector<KDNode*>& path) const {
+    // Every point lies inside the cells of all its ancestors, so descending
+    // by its current coordinates reaches it without backtracking
+    path.clear();
+    KDNode* node = root_.get();
+    while (node) {
+        path.push_back(node);
+        if (node->id == id) return true;
+        float value = (node->axis == 0) ? lat : lon;
+        node = (value < node->split) ? node->left.get() : node->right.get();
+    }
+    return false;
+}
+
+void SpatialIndex::narrow_cell(const KDNode* parent, bool left, Cell& cell) {
+    float* bound = left ? &cell.hi[parent->axis] : &cell.lo[parent->axis];
+    *bound = left ? std::min(*bound, parent->split) : std::max(*bound, parent->split);
+}
+
+void SpatialIndex::propagate_move(KDNode* node) {
+    // Spatial bounds stay exact up to the first unchanged ancestor. Above
+    // it only the new timestamp can still raise max_t, until the first
+    // ancestor that already covers it. Bounds the point moved away from are
+    // left loose (still conservative) until rebuild().
+    for (; node; node = node->parent) {
+        float lat_lo = node->min_lat, lat_hi = node->max_lat;
+        float lon_lo = node->min_lon, lon_hi = node->max_lon;
+        node->recompute_bounds();
+        if (lat_lo == node->min_lat && lat_hi == node->max_lat &&
+            lon_lo == node->min_lon && lon_hi == node->max_lon) {
+            break;
+        }
+    }
+    if (!node) return;
+    
+    // node's bounds are exact (they include the moved point); the rest of
+    // the path only has to cover its time range
+    double t = node->max_t;
+    for (node = node->parent; node && node->max_t < t; node = node->parent) {
+        node->max_t = t;
+    }
+}
+
+KDNode* SpatialIndex::relocation_root(const KDNode* target, const Cell& cell,
+                                      float lat, float lon, Cell& root_cell) {
+    // Walk up to the highest ancestor whose split the new point violates;
+    // nullptr if there is none.
+    // Constraints on the same side of the same axis only loosen towards the
+    // root, so a side is settled by its first satisfied constraint, which is
+    // also a valid (possibly tighter than necessary) bound for the new cell.
+    float point[2] = {lat, lon};
+    bool open[2][2];  // [axis][0 = lo, 1 = hi] sides of target's cell the point left
+    int unsettled = 0;
+    root_cell = cell;
+    for (int a = 0; a < 2; a++) {
+        open[a][0] = point[a] < cell.lo[a];
+        open[a][1] = point[a] >= cell.hi[a];
+        if (open[a][0]) root_cell.lo[a] = -std::numeric_limits<float>::infinity();
+        if (open[a][1]) root_cell.hi[a] = std::numeric_limits<float>::infinity();
+        unsettled += open[a][0] + open[a][1];
+    }
+    
+    KDNode* lca = nullptr;
+    const KDNode* child = target;
+    for (KDNode* node = target->parent; node && unsettled > 0; child = node, node = node->parent) {
+        int a = node->axis;
+        bool left = node->left.get() == child;
+        if (left ? point[a] >= node->split : point[a] < node->split) {
+            lca = node;
+        } else if (open[a][left]) {
+            (left ? root_cell.hi[a] : root_cell.lo[a]) = node->split;
+            open[a][left] = false;
+            unsettled--;
+        }
+    }
+    return lca;
+}
+
+bool SpatialIndex::move(uint64_t id, float old_lat, float old_lon,
+                        float new_lat, float new_lon, double t) {
+    // First move of a point: locate it once, then keep a handle
+    auto handle = tracked_.find(id);
+    if (handle == tracked_.end()) {
+        std::vector<KDNode*> path;
+        if (!find_path(id, old_lat, old_lon, path)) return false;
+        Tracked tracked{path.back(), Cell::unbounded()};
+        for (size_t i = 0; i + 1 < path.size(); i++) {
+            narrow_cell(path[i], path[i]->left.get() == path[i + 1], tracked.cell);
+        }
+        handle = tracked_.emplace(id, tracked).first;
+    }
+    KDNode* target = handle->second.node;
+    const Cell cell = handle->second.cell;
+    
+    // Find the lowest ancestor whose cell contains the new point. Cached
+    // cells may be tighter than the true ones, so none may be needed.
+    Cell new_cell;
+    KDNode* lca = nullptr;
+    if (new_lat < cell.lo[0] || new_lat >= cell.hi[0] ||
+        new_lon < cell.lo[1] || new_lon >= cell.hi[1]) {
+        lca = relocation_root(target, cell, new_lat, new_lon, new_cell);
+        if (!lca) handle->second.cell = new_cell;
+    }
+    
+    // In place while every ancestor would still route the point to target
+    if (!lca) {
+        target->point[0] = new_lat;
+        target->point[1] = new_lon;
+        target->t = t;
+        target->t_end = t;
+        propagate_move(target);
+        return true;
+    }
+    
+    // Relocate below lca, so only that subtree's paths are touched
+    // Target's split must stay, so a leaf below it hands over its point
+    // (which already lies inside target's cell) and is unlinked instead
+    KDNode* leaf = target;
+    while (leaf->left || leaf->right) {
+        leaf = leaf->left ? leaf->left.get() : leaf->right.get();
+    }
+    if (leaf != target) {
+        target->point[0] = leaf->point[0];
+        target->point[1] = leaf->point[1];
+        target->t = leaf->t;
+        target->t_end = leaf->t_end;
+        target->id = leaf->id;
+        auto moved = tracked_.find(leaf->id);
+        if (moved != tracked_.end()) {
+            moved->second = {target, cell};
+        }
+    }
+    
+    KDNode* parent = leaf->parent;
+    std::unique_ptr<KDNode> node = std::move(parent->left.get() == leaf ? parent->left : parent->right);
+    for (; parent != lca; parent = parent->parent) {
+        parent->recompute_bounds();
+    }
+    
+    // Reuse the unlinked node for the moved point
+    node->point[0] = new_lat;
+    node->point[1] = new_lon;
+    node->t = t;
+    node->t_end = t;
+    node->id = id;
+    node->recompute_bounds();
+    
+    std::unique_ptr<KDNode>* slot;
+    parent = lca;
+    while (true) {
+        float value = (parent->axis == 0) ? new_lat : new_lon;
+        bool left = value < parent->split;
+        narrow_cell(parent, left, new_cell);
+        slot = left ? &parent->left : &parent->right;
+        if (!*slot) break;
+        parent = slot->get();
+    }
+    node->axis = 1 - parent->axis;
+    node->split = node->point[node->axis];
+    node->parent = parent;
+    handle->second = {node.get(), new_cell};
+    *slot = std::move(node);
+    
+    // Nodes between the new leaf and lca gained a point; lca and above only
+    // saw it move
+    for (; parent != lca; parent = parent->parent) {
+        parent->subtree_size++;
+        parent->min_lat = std::min(parent->min_lat, new_lat);
+        parent->max_lat = std::max(parent->max_lat, new_lat);
+        parent->min_lon = std::min(parent->min_lon, new_lon);
+        parent->max_lon = std::max(parent->max_lon, new_lon);
+        parent->min_t = std::min(parent->min_t, t);
+        parent->max_t = std::max(parent->max_t, t);
+    }
+    propagate_move(lca);
+    structure_version_++;
+    
+    // Reinsertion only ever appends leaves; rebalance once as many points
+    // have been relocated as the tree holds (amortized O(log n) per move)
+    if (++relocations_since_rebuild_ > std::max<size_t>(size_, 1024)) {
+        rebuild();
+    }
+    return true;
+}
+
+size_t SpatialIndex::touch_levels(int levels) const {
+    if (!root_ || levels <= 0) return 0;
+    size_t touched = 0;
+    volatile uint64_t sink = 0;
+    std::vector<std::pair<const KDNode*, int>> stack{{root_.get(), 0}};
+    while (!stack.empty()) {
+        auto [node, depth] = stack.back();
+        stack.pop_back();
+        sink = sink + node->id;
+        touched++;
+        if (depth + 1 >= levels) continue;
+        if (node->right) stack.emplace_back(node->right.get(), depth + 1);
+        if (node->left) stack.emplace_back(node->left.get(), depth + 1);
+    }
+    return touched;
+}
+
+void SpatialIndex::rebuild() {
+    std::vector<std::unique_ptr<KDNode>> nodes;
+    nodes.reserve(size_);
+    
+    // Unlink every node (explicit stack: degenerate trees can be deep)
+    std::vector<std::unique_ptr<KDNode>> stack;
+    if (root_) stack.push_back(std::move(root_));
+    while (!stack.empty()) {
+        std::unique_ptr<KDNode> node = std::move(stack.back());
+        stack.pop_back();
+        if (node->left) stack.push_back(std::move(node->left));
+        if (node->right) stack.push_back(std::move(node->right));
+        nodes.push_back(std::move(node));
+    }
+    
+    root_ = build_balanced(nodes, 0, nodes.size(), 0);
+    if (root_) root_->parent = nullptr;
+    relocations_since_rebuild_ = 0;
+    
+    // Nodes were reused in place, but every cell changed
+    if (!tracked_.empty() && root_) {
+        std::vector<std::pair<KDNode*, Cell>> cells;
+        cells.emplace_back(root_.get(), Cell::unbounded());
+        while (!cells.empty()) {
+            auto [node, cell] = cells.back();
+            cells.pop_back();
+            auto handle = tracked_.find(node->id);
+            if (handle != tracked_.end()) {
+                handle->second = {node, cell};
+            }
+            if (node->left) {
+                cells.emplace_back(node->left.get(), cell);
+                narrow_cell(node, true, cells.back().second);
+            }
+            if (node->right) {
+                cells.emplace_back(node->right.get(), cell);
+                narrow_cell(node, false, cells.back().second);
+            }
+        }
+    }
+    structure_version_++;
+}
+
+std::unique_ptr<KDNode> SpatialIndex::build_balanced(std::vector<std::unique_ptr<KDNode>>& nodes,
+                                                     size_t begin, size_t end, int depth) {
+    if (begin >= end) return nullptr;
+    
+    int axis = depth % 2;
+    auto less = [axis](const std::unique_ptr<KDNode>& a, const std::unique_ptr<KDNode>& b) {
+        return a->point[axis] < b->point[axis];
+    };
+    size_t mid = begin + (end - begin) / 2;
+    std::nth_element(nodes.begin() + begin, nodes.begin() + mid, nodes.begin() + end, less);
+    
+    // Keep the insert invariant (left < split <= right): duplicates of the
+    // median move to the right
+    float median = nodes[mid]->point[axis];
+    auto first_equal = std::partition(nodes.begin() + begin, nodes.begin() + mid,
+                                      [axis, median](const std::unique_ptr<KDNode>& n) {
+                                          return n->point[axis] < median;
+                                      });
+    size_t pivot = static_cast<size_t>(first_equal - nodes.begin());
+    std::swap(nodes[pivot], nodes[mid]);
+    
+    std::unique_ptr<KDNode> node = std::move(nodes[pivot]);
+    node->axis = axis;
+    node->split = median;
+    node->left = build_balanced(nodes, begin, pivot, depth + 1);
+    node->right = build_balanced(nodes, pivot + 1, end, depth + 1);
+    if (node->left) node->left->parent = node.get();
+    if (node->right) node->right->parent = node.get();
+    node->recompute_bounds();
+    return node;
 }
 
 bool SpatialIndex::in_box(float lat, float lon, float lat_min, float lon_min,
@@ -247,6 +975,86 @@ bool SpatialIndex::in_box(float lat, float lon, float lat_min, float lon_min,
 void SpatialIndex::clear() {
     root_.reset();
     size_ = 0;
+    tracked_.clear();
+    relocations_since_rebuild_ = 0;
+    structure_version_++;
+}
+
+// ==================== SERIALIZATION ====================
+
+namespace {
+
+struct PackedNode {
+    double t, t_end;
+    uint64_t id;
+    float lat, lon;
+    float split;
+    uint8_t axis;
+    uint8_t children;  // 1 = left, 2 = right
+    uint8_t reserved[2];
+};
+
+} // namespace
+
+void SpatialIndex::serialize(ByteWriter& out) const {
+    out.put<uint64_t>(size_);
+    out.put<uint64_t>(relocations_since_rebuild_);
+    
+    std::vector<PackedNode> packed;
+    packed.reserve(size_);
+    std::vector<const KDNode*> stack;
+    if (root_) stack.push_back(root_.get());
+    while (!stack.empty()) {
+        const KDNode* node = stack.back();
+        stack.pop_back();
+        uint8_t children = (node->left ? 1 : 0) | (node->right ? 2 : 0);
+        packed.push_back({node->t, node->t_end, node->id,
+                          node->point[0], node->point[1], node->split,
+                          static_cast<uint8_t>(node->axis), children, {0, 0}});
+        if (node->right) stack.push_back(node->right.get());
+        if (node->left) stack.push_back(node->left.get());
+    }
+    out.put_vector(packed);
+}
+
+void SpatialIndex::deserialize(ByteReader& in) {
+    clear();
+    uint64_t size = in.get<uint64_t>();
+    uint64_t relocations = in.get<uint64_t>();
+    size_t n = in.get_count<PackedNode>();
+    
+    // Preorder: each node fills the slot on top of the stack, then pushes
+    // its right and left child slots
+    std::vector<KDNode*> order;
+    order.reserve(n);
+    std::vector<std::pair<std::unique_ptr<KDNode>*, KDNode*>> slots;
+    if (n > 0) slots.emplace_back(&root_, nullptr);
+    for (size_t i = 0; i < n; i++) {
+        if (slots.empty()) {
+            throw std::invalid_argument("Serialized index is truncated or corrupt");
+        }
+        auto [slot, parent] = slots.back();
+        slots.pop_back();
+        PackedNode p = in.get<PackedNode>();
+        *slot = std::make_unique<KDNode>(p.lat, p.lon, p.t, p.t_end, p.id, p.axis);
+        KDNode* node = slot->get();
+        node->split = p.split;
+        node->parent = parent;
+        order.push_back(node);
+        if (p.children & 2) slots.emplace_back(&node->right, node);
+        if (p.children & 1) slots.emplace_back(&node->left, node);
+    }
+    if (!slots.empty() || size != n) {
+        clear();
+        throw std::invalid_argument("Serialized index is truncated or corrupt");
+    }
+    
+    // Children follow their parent in preorder
+    for (size_t i = order.size(); i-- > 0;) {
+        order[i]->recompute_bounds();
+    }
+    size_ = n;
+    relocations_since_rebuild_ = static_cast<size_t>(relocations);
 }
 
 } // namespace spatio
@@ -1,37 +1,164 @@
 #include "spatio_index_core.hpp"
+#include "mapped_index.hpp"
 #include <algorithm>
+#include <chrono>
+#include <exception>
+#include <stdexcept>
+#include <cstring>
+#include <string>
 
 namespace spatio {
 
 // ==================== INSERTION ====================
 
 uint64_t SpatioIndexCore::insert(float lat, float lon, double t) {
-    uint64_t id = record_store_.add_record(lat, lon, t);
-    spatial_index_.insert(lat, lon, id);
-    temporal_index_.insert(t, id);
-    build_completed_ = false;
-    return id;
+    return write_and_deliver([&] { return add_indexed(lat, lon, t, t); });
+}
+
+uint64_t SpatioIndexCore::insert_interval(float lat, float lon, double t_begin, double t_end) {
+    if (t_end < t_begin) {
+        throw std::invalid_argument("insert_interval: t_end must not precede t_begin");
+    }
+    return write_and_deliver([&] { return add_indexed(lat, lon, t_begin, t_end); });
+}
+
+uint64_t SpatioIndexCore::insert_value(float lat, float lon, double t, double value) {
+    return write_and_deliver([&] { return add_indexed(lat, lon, t, t, value); });
 }
 
 std::vector<uint64_t> SpatioIndexCore::bulk_insert(const std::vector<RecordInput>& records) {
-    std::vector<uint64_t> ids;
-    ids.reserve(records.size());
-    
+    // Validate up front so a bad interval leaves the index untouched
     for (const auto& rec : records) {
-        uint64_t id = record_store_.add_record(rec.lat, rec.lon, rec.t);
-        ids.push_back(id);
-        spatial_index_.insert(rec.lat, rec.lon, id);
-        temporal_index_.insert(rec.t, id);
+        if (rec.t_end < rec.t) {
+            throw std::invalid_argument("bulk_insert: t_end must not precede t");
+        }
     }
     
+    // Callbacks run once the whole batch is indexed
+    return write_and_deliver([&] {
+        std::vector<uint64_t> ids;
+        ids.reserve(records.size());
+        for (const auto& rec : records) {
+            ids.push_back(add_indexed(rec.lat, rec.lon, rec.t, rec.t_end));
+        }
+        return ids;
+    });
+}
+
+uint64_t SpatioIndexCore::add_indexed(float lat, float lon, double t, double t_end,
+                                      double value) {
+    if (t_end != t) {
+        log_change(ChangeKind::INSERT_INTERVAL, IntervalPayload{lat, lon, t, t_end});
+    } else if (value != 0.0) {
+        log_change(ChangeKind::INSERT_VALUE, ValuePayload{lat, lon, t, value});
+    } else {
+        log_change(ChangeKind::INSERT, InsertPayload{lat, lon, t});
+    }
+    
+    uint64_t id;
+    if (t_end == t) {
+        id = record_store_.add_record(lat, lon, t);
+        spatial_index_.insert(lat, lon, t, id);
+        temporal_index_.insert(t, id);
+    } else {
+        id = record_store_.add_record(lat, lon, t, t_end);
+        spatial_index_.insert_interval(lat, lon, t, t_end, id);
+        temporal_index_.insert_interval(t, t_end, id);
+    }
+    note_write(lat, lon);
     build_completed_ = false;
-    return ids;
+    if (window_aggregator_) {
+        window_aggregator_->add(lat, lon, t, value);
+    }
+    
+    if (standing_queries_.size() > 0) {
+        match_standing(lat, lon, t, t_end, id);
+    }
+    return id;
 }
 
 void SpatioIndexCore::build() {
-    // Phase A: No-op placeholder
-    // Future: balanced tree construction, metadata computation
+    auto lock = write_lock();
+    build_locked();
+}
+
+void SpatioIndexCore::build_locked() {
+    log_change(ChangeKind::BUILD);
+    temporal_index_.build();
+    if (count_grid_) {
+        count_grid_->build(record_store_.records());
+    }
     build_completed_ = true;
+    if (huge_pages_) {
+        advise_huge_pages();
+    }
+}
+
+// ==================== MOVING OBJECTS ====================
+
+uint64_t SpatioIndexCore::upsert(uint64_t object_id, float lat, float lon, double t) {
+    return write_and_deliver([&] { return apply_upsert(ObjectUpdate(object_id, lat, lon, t)); });
+}
+
+std::vector<uint64_t> SpatioIndexCore::bulk_upsert(const std::vector<ObjectUpdate>& updates) {
+    return write_and_deliver([&] {
+        std::vector<uint64_t> ids;
+        ids.reserve(updates.size());
+        for (const auto& update : updates) {
+            ids.push_back(apply_upsert(update));
+        }
+        return ids;
+    });
+}
+
+uint64_t SpatioIndexCore::apply_upsert(const ObjectUpdate& update) {
+    auto [it, is_new] = object_records_.try_emplace(update.object_id, 0);
+    if (is_new) {
+        uint64_t id = record_store_.add_record(update.lat, update.lon, update.t);
+        spatial_index_.insert(update.lat, update.lon, update.t, id);
+        temporal_index_.insert(update.t, id);
+        it->second = id;
+        record_objects_.emplace(id, update.object_id);
+    } else {
+        uint64_t id = it->second;
+        const Record* rec = record_store_.get_record_ptr(id);
+        if (update.t < rec->t) {
+            return id;  // Out-of-order ping: the stored position is newer
+        }
+        float old_lat = rec->lat;
+        float old_lon = rec->lon;
+        double old_t = rec->t;
+        
+        spatial_index_.move(id, old_lat, old_lon, update.lat, update.lon, update.t);
+        temporal_index_.update(old_t, update.t, id);
+        record_store_.update_record(id, update.lat, update.lon, update.t);
+        note_write(old_lat, old_lon);
+    }
+    
+    log_change(ChangeKind::UPSERT, UpsertPayload{update.object_id, update.lat, update.lon, update.t});
+    note_write(update.lat, update.lon);
+    build_completed_ = false;
+    if (window_aggregator_) {
+        window_aggregator_->add(update.lat, update.lon, update.t);
+    }
+    if (standing_queries_.size() > 0) {
+        match_standing(update.lat, update.lon, update.t, update.t, it->second);
+    }
+    return it->second;
+}
+
+std::optional<uint64_t> SpatioIndexCore::record_for_object(uint64_t object_id) const {
+    auto lock = read_lock();
+    auto it = object_records_.find(object_id);
+    if (it == object_records_.end()) return std::nullopt;
+    return it->second;
+}
+
+std::optional<uint64_t> SpatioIndexCore::object_for_record(uint64_t record_id) const {
+    auto lock = read_lock();
+    auto it = record_objects_.find(record_id);
+    if (it == record_objects_.end()) return std::nullopt;
+    return it->second;
 }
 
 // ==================== SPATIAL-ONLY QUERIES ====================
@@ -39,15 +166,18 @@ void SpatioIndexCore::build() {
 std::vector<uint64_t> SpatioIndexCore::query_radius(float center_lat, float center_lon,
                                                     double radius_km) const {
     // No time filter - return all spatial matches
+    auto lock = read_lock();
     return spatial_index_.radius_query(center_lat, center_lon, radius_km);
 }
 
 std::vector<uint64_t> SpatioIndexCore::query_box(float lat_min, float lon_min,
                                                  float lat_max, float lon_max) const {
+    auto lock = read_lock();
     return spatial_index_.box_query(lat_min, lon_min, lat_max, lon_max);
 }
 
 std::vector<uint64_t> SpatioIndexCore::query_knn(float lat, float lon, size_t k) const {
+    auto lock = read_lock();
     return spatial_index_.knn_query(lat, lon, k);
 }
 
@@ -56,32 +186,71 @@ std::vector<uint64_t> SpatioIndexCore::query_knn(float lat, float lon, size_t k)
 std::vector<uint64_t> SpatioIndexCore::query_radius_time(float center_lat, float center_lon,
                                                          double radius_km,
                                                          double t_start, double t_end) const {
+    auto lock = read_lock();
+    if (!query_cache_) {
+        return radius_time_impl(center_lat, center_lon, radius_km, t_start, t_end);
+    }
+    
+    QueryCache::Query q = query_cache_->normalize_radius_time(center_lat, center_lon, radius_km,
+                                                              t_start, t_end);
+    std::vector<uint64_t> results;
+    uint64_t fill_epoch;
+    if (query_cache_->lookup(q, results, fill_epoch)) {
+        return results;
+    }
+    results = radius_time_impl(q.lat_a, q.lon_a, q.radius_km, q.t_start, q.t_end);
+    query_cache_->store(q, results, fill_epoch);
+    return results;
+}
+
+std::vector<uint64_t> SpatioIndexCore::radius_time_impl(float center_lat, float center_lon,
+                                                        double radius_km,
+                                                        double t_start, double t_end) const {
     // Optimization 3: Early rejection using temporal bounds
     if (t_end < temporal_index_.min_time() || t_start > temporal_index_.max_time()) {
         return {};
     }
     
-    // Spatial-first strategy
-    std::vector<uint64_t> spatial_ids = spatial_index_.radius_query(center_lat, center_lon, radius_km);
-    return filter_by_time(spatial_ids, t_start, t_end);
+    // Spatial-first strategy; subtree time bounds prune during the descent
+    return spatial_index_.radius_query_time(center_lat, center_lon, radius_km, t_start, t_end);
 }
 
 std::vector<uint64_t> SpatioIndexCore::query_box_time(float lat_min, float lon_min,
                                                       float lat_max, float lon_max,
                                                       double t_start, double t_end) const {
+    auto lock = read_lock();
+    if (!query_cache_) {
+        return box_time_impl(lat_min, lon_min, lat_max, lon_max, t_start, t_end);
+    }
+    
+    QueryCache::Query q = query_cache_->normalize_box_time(lat_min, lon_min, lat_max, lon_max,
+                                                           t_start, t_end);
+    std::vector<uint64_t> results;
+    uint64_t fill_epoch;
+    if (query_cache_->lookup(q, results, fill_epoch)) {
+        return results;
+    }
+    results = box_time_impl(q.lat_a, q.lon_a, q.lat_b, q.lon_b, q.t_start, q.t_end);
+    query_cache_->store(q, results, fill_epoch);
+    return results;
+}
+
+std::vector<uint64_t> SpatioIndexCore::box_time_impl(float lat_min, float lon_min,
+                                                     float lat_max, float lon_max,
+                                                     double t_start, double t_end) const {
     // Early rejection
     if (t_end < temporal_index_.min_time() || t_start > temporal_index_.max_time()) {
         return {};
     }
     
-    std::vector<uint64_t> spatial_ids = spatial_index_.box_query(lat_min, lon_min, lat_max, lon_max);
-    return filter_by_time(spatial_ids, t_start, t_end);
+    return spatial_index_.box_query_time(lat_min, lon_min, lat_max, lon_max, t_start, t_end);
 }
 
 std::vector<uint64_t> SpatioIndexCore::query_knn_time(float lat, float lon, size_t k,
                                                       double t_start, double t_end) const {
     // For KNN with time filter, we need to be careful:
     // We may need to retrieve more than k spatial neighbors to get k valid temporal neighbors
+    auto lock = read_lock();
     
     // Early rejection
     if (t_end < temporal_index_.min_time() || t_start > temporal_index_.max_time()) {
@@ -90,7 +259,7 @@ std::vector<uint64_t> SpatioIndexCore::query_knn_time(float lat, float lon, size
     
     // Strategy: fetch more spatial neighbors, then filter by time
     // Heuristic: fetch up to 3k neighbors (configurable)
-    size_t fetch_k = std::min(k * 3, size());
+    size_t fetch_k = std::min(k * 3, record_store_.size());
     if (fetch_k == 0) return {};
     
     std::vector<uint64_t> spatial_ids = spatial_index_.knn_query(lat, lon, fetch_k);
@@ -104,6 +273,217 @@ std::vector<uint64_t> SpatioIndexCore::query_knn_time(float lat, float lon, size
     return time_filtered;
 }
 
+// ==================== STANDING QUERIES ====================
+
+uint64_t SpatioIndexCore::register_standing_query(const StandingQuery& query,
+                                                  double t_start, double t_end) {
+    auto lock = write_lock();
+    return standing_queries_.add(query, t_start, t_end);
+}
+
+bool SpatioIndexCore::unregister_standing_query(uint64_t handle) {
+    auto lock = write_lock();
+    return standing_queries_.remove(handle);
+}
+
+void SpatioIndexCore::set_standing_callback(StandingCallback callback) {
+    // The previous callback is released after the lock
+    std::shared_ptr<const StandingCallback> previous;
+    std::vector<StandingMatch> matches;
+    {
+        auto lock = write_lock();
+        previous = std::move(standing_callback_);
+        if (callback) {
+            standing_callback_ = std::make_shared<const StandingCallback>(std::move(callback));
+        }
+        matches = take_standing(0);
+    }
+    deliver_standing(std::move(matches));
+}
+
+std::vector<StandingMatch> SpatioIndexCore::drain_standing_matches() {
+    auto lock = write_lock();
+    std::vector<StandingMatch> matches;
+    matches.swap(standing_matches_);
+    return matches;
+}
+
+void SpatioIndexCore::match_standing(float lat, float lon, double t, double t_end,
+                                     uint64_t id) {
+    standing_scratch_.clear();
+    standing_queries_.match(lat, lon, t, t_end, standing_scratch_);
+    for (uint64_t handle : standing_scratch_) {
+        standing_matches_.emplace_back(handle, id);
+    }
+}
+
+std::vector<StandingMatch> SpatioIndexCore::take_standing(size_t first) {
+    if (!standing_callback_ || first >= standing_matches_.size()) return {};
+    std::vector<StandingMatch> batch(standing_matches_.begin() + first, standing_matches_.end());
+    standing_matches_.resize(first);
+    return batch;
+}
+
+void SpatioIndexCore::deliver_standing(std::vector<StandingMatch> matches) {
+    // Detached and unlocked, so a callback may safely insert, query or drain
+    std::exception_ptr error;
+    for (size_t i = 0; i < matches.size(); i++) {
+        std::shared_ptr<const StandingCallback> callback;
+        {
+            auto lock = write_lock();
+            callback = standing_callback_;
+            if (!callback) {
+                // Unset by a callback: queue the rest
+                standing_matches_.insert(standing_matches_.end(), matches.begin() + i,
+                                         matches.end());
+                break;
+            }
+        }
+        try {
+            (*callback)(matches[i].first, matches[i].second);
+        } catch (...) {
+            if (!error) error = std::current_exception();
+        }
+    }
+    if (error) std::rethrow_exception(error);
+}
+
+// ==================== RESULT CACHE ====================
+
+void SpatioIndexCore::enable_query_cache(const QueryCache::Config& config) {
+    auto lock = write_lock();
+    query_cache_ = std::make_unique<QueryCache>(config);
+}
+
+void SpatioIndexCore::disable_query_cache() {
+    auto lock = write_lock();
+    query_cache_.reset();
+}
+
+QueryCacheStats SpatioIndexCore::query_cache_stats() const {
+    auto lock = read_lock();
+    return query_cache_ ? query_cache_->stats() : QueryCacheStats{};
+}
+
+void SpatioIndexCore::note_write(float lat, float lon) {
+    if (query_cache_) {
+        query_cache_->on_write(lat, lon);
+    }
+}
+
+// ==================== COUNTING ====================
+
+size_t SpatioIndexCore::count_time_range(double t_start, double t_end) const {
+    auto lock = read_lock();
+    return temporal_index_.count_range(t_start, t_end);
+}
+
+size_t SpatioIndexCore::count_box_time(float lat_min, float lon_min, float lat_max, float lon_max,
+                                       double t_start, double t_end) const {
+    auto lock = read_lock();
+    if (t_end < temporal_index_.min_time() || t_start > temporal_index_.max_time()) {
+        return 0;
+    }
+    
+    // The grid is a snapshot, valid only until the next write
+    if (count_grid_ && build_completed_) {
+        CellRange covered;
+        size_t interior = count_grid_->count_interior(lat_min, lon_min, lat_max, lon_max,
+                                                      t_start, t_end, covered);
+        return interior + spatial_index_.count_box_time(lat_min, lon_min, lat_max, lon_max,
+                                                        t_start, t_end, &covered);
+    }
+    return spatial_index_.count_box_time(lat_min, lon_min, lat_max, lon_max, t_start, t_end);
+}
+
+void SpatioIndexCore::enable_count_grid(double cell_deg) {
+    auto lock = write_lock();
+    count_grid_ = std::make_unique<CellTimeCounts>(cell_deg);
+    if (build_completed_) {
+        count_grid_->build(record_store_.records());
+    }
+}
+
+// ==================== WINDOWED AGGREGATION ====================
+
+void SpatioIndexCore::enable_window_aggregation(const WindowedAggregator::Config& config) {
+    // Starts empty: only writes from now on are aggregated
+    auto lock = write_lock();
+    window_aggregator_ = std::make_unique<WindowedAggregator>(config);
+}
+
+std::vector<CellAggregate> SpatioIndexCore::window_sliding(float lat_min, float lon_min,
+                                                           float lat_max, float lon_max,
+                                                           double now) const {
+    auto lock = read_lock();
+    if (!window_aggregator_) return {};
+    return window_aggregator_->sliding(lat_min, lon_min, lat_max, lon_max, now);
+}
+
+std::vector<CellAggregate> SpatioIndexCore::window_tumbling(float lat_min, float lon_min,
+                                                            float lat_max, float lon_max,
+                                                            double t) const {
+    auto lock = read_lock();
+    if (!window_aggregator_) return {};
+    return window_aggregator_->tumbling(lat_min, lon_min, lat_max, lon_max, t);
+}
+
+// ==================== APPROXIMATE QUERIES ====================
+
+ApproxCount SpatioIndexCore::count_radius_time_approx(float center_lat, float center_lon,
+                                                      double radius_km,
+                                                      double t_start, double t_end,
+                                                      double epsilon) const {
+    auto lock = read_lock();
+    if (t_end < temporal_index_.min_time() || t_start > temporal_index_.max_time()) {
+        ApproxCount empty;
+        empty.epsilon = epsilon;
+        return empty;
+    }
+    return spatial_index_.count_radius_time_approx(center_lat, center_lon, radius_km,
+                                                   t_start, t_end, epsilon);
+}
+
+ApproxKNNResult SpatioIndexCore::query_knn_approx(float lat, float lon, size_t k,
+                                                  double epsilon) const {
+    auto lock = read_lock();
+    return spatial_index_.knn_query_approx(lat, lon, k, epsilon);
+}
+
+// ==================== SAMPLING ====================
+
+std::vector<uint64_t> SpatioIndexCore::sample_radius_time(float center_lat, float center_lon,
+                                                          double radius_km,
+                                                          double t_start, double t_end,
+                                                          size_t n, uint64_t seed) const {
+    auto lock = read_lock();
+    if (t_end < temporal_index_.min_time() || t_start > temporal_index_.max_time()) {
+        return {};
+    }
+    
+    auto in_time = [&](uint64_t id) {
+        const Record* record = record_store_.get_record_ptr(id);
+        return record && record->active_during(t_start, t_end);
+    };
+    return spatial_index_.sample_radius(center_lat, center_lon, radius_km, n, seed, in_time);
+}
+
+std::vector<uint64_t> SpatioIndexCore::sample_box_time(float lat_min, float lon_min,
+                                                       float lat_max, float lon_max,
+                                                       double t_start, double t_end,
+                                                       size_t n, uint64_t seed) const {
+    auto lock = read_lock();
+    if (t_end < temporal_index_.min_time() || t_start > temporal_index_.max_time()) {
+        return {};
+    }
+    
+    auto in_time = [&](uint64_t id) {
+        const Record* record = record_store_.get_record_ptr(id);
+        return record && record->active_during(t_start, t_end);
+    };
+    return spatial_index_.sample_box(lat_min, lon_min, lat_max, lon_max, n, seed, in_time);
+}
+
 // ==================== INSTRUMENTED QUERIES ====================
 
 std::vector<uint64_t> SpatioIndexCore::query_radius_time_instrumented(
@@ -111,6 +491,7 @@ std::vector<uint64_t> SpatioIndexCore::query_radius_time_instrumented(
     double t_start, double t_end, QueryStats& stats) const {
     
     stats.reset();
+    auto lock = read_lock();
     
     // Early rejection
     if (t_end < temporal_index_.min_time() || t_start > temporal_index_.max_time()) {
@@ -136,13 +517,265 @@ std::vector<uint64_t> SpatioIndexCore::query_radius_time_instrumented(
     return results;
 }
 
+// ==================== STREAMING QUERIES ====================
+
+QueryCursor SpatioIndexCore::open_radius_cursor(float center_lat, float center_lon,
+                                                double radius_km,
+                                                double t_start, double t_end,
+                                                size_t chunk_size) const {
+    auto lock = read_lock();
+    return QueryCursor::radius(spatial_index_, record_store_, center_lat, center_lon,
+                               radius_km, t_start, t_end, chunk_size, &mutex_);
+}
+
+QueryCursor SpatioIndexCore::open_box_cursor(float lat_min, float lon_min,
+                                             float lat_max, float lon_max,
+                                             double t_start, double t_end,
+                                             size_t chunk_size) const {
+    auto lock = read_lock();
+    return QueryCursor::box(spatial_index_, record_store_, lat_min, lon_min, lat_max, lon_max,
+                            t_start, t_end, chunk_size, &mutex_);
+}
+
 // ==================== DATA ACCESS ====================
 
 const Record* SpatioIndexCore::get_record_ptr(uint64_t id) const {
     // TRUE zero-copy: direct pointer into RecordStore's vector
+    auto lock = read_lock();
     return record_store_.get_record_ptr(id);
 }
 
+void SpatioIndexCore::save_mapped(const std::string& path) const {
+    auto lock = read_lock();
+    MappedIndex::write(record_store_.records(), path);
+}
+
+// ==================== CHANGE FEED ====================
+
+void SpatioIndexCore::enable_change_feed(size_t max_pending_bytes) {
+    // Starts empty: the first batch begins with the next mutation
+    auto lock = write_lock();
+    change_feed_ = std::make_unique<ChangeFeed>(max_pending_bytes);
+}
+
+std::string SpatioIndexCore::take_changes() {
+    auto lock = read_lock();  // The feed has its own lock against writers
+    return change_feed_ ? change_feed_->take() : std::string();
+}
+
+ChangeFeed::Stats SpatioIndexCore::change_feed_stats() const {
+    auto lock = read_lock();
+    return change_feed_ ? change_feed_->stats() : ChangeFeed::Stats();
+}
+
+size_t SpatioIndexCore::apply_changes(const char* data, size_t size) {
+    if (size == 0) return 0;  // take_changes() had nothing pending
+    std::vector<Change> changes = ChangeFeed::decode(data, size);
+    if (changes.empty()) return 0;
+    
+    // The whole batch is applied under one exclusive lock; callbacks run
+    // after it is released
+    size_t applied = 0;
+    std::vector<StandingMatch> matches;
+    {
+        auto lock = write_lock();
+        if (changes.front().seq > change_seq_ + 1) {
+            throw std::runtime_error("apply_changes: batch starts at change " +
+                                     std::to_string(changes.front().seq) +
+                                     " but the index is at " + std::to_string(change_seq_) +
+                                     "; resync from a snapshot");
+        }
+        
+        // Each replayed mutation logs itself again, so replicas can be chained
+        size_t first_match = standing_matches_.size();
+        for (const Change& change : changes) {
+            if (change.seq <= change_seq_) continue;  // Already applied
+            switch (change.kind) {
+                case ChangeKind::INSERT:
+                case ChangeKind::INSERT_INTERVAL:
+                case ChangeKind::INSERT_VALUE:
+                    add_indexed(change.lat, change.lon, change.t, change.t_end, change.value);
+                    break;
+                case ChangeKind::UPSERT:
+                    apply_upsert(ObjectUpdate(change.object_id, change.lat, change.lon,
+                                              change.t));
+                    break;
+                case ChangeKind::BUILD:
+                    build_locked();
+                    break;
+                case ChangeKind::CLEAR: {
+                    // Matches of the cleared records are still delivered
+                    std::vector<StandingMatch> cleared = take_standing(first_match);
+                    matches.insert(matches.end(), cleared.begin(), cleared.end());
+                    log_change(ChangeKind::CLEAR);
+                    reset_contents();
+                    first_match = 0;
+                    break;
+                }
+            }
+            applied++;
+        }
+        std::vector<StandingMatch> rest = take_standing(first_match);
+        matches.insert(matches.end(), rest.begin(), rest.end());
+    }
+    deliver_standing(std::move(matches));
+    return applied;
+}
+
+// ==================== SERIALIZATION ====================
+
+namespace {
+
+constexpr char STATE_MAGIC[8] = {'S', 'P', 'X', 'C', 'O', 'R', 'E', '\0'};
+constexpr uint32_t STATE_VERSION = 3;
+constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+struct StateHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+};
+
+struct ObjectLink {
+    uint64_t object_id;
+    uint64_t record_id;
+};
+
+} // namespace
+
+std::string SpatioIndexCore::serialize() const {
+    auto lock = read_lock();
+    std::string state;
+    ByteWriter out(state);
+    out.reserve(64 + record_store_.size() * (sizeof(Record) + 64));
+    StateHeader header;
+    std::memcpy(header.magic, STATE_MAGIC, sizeof(header.magic));
+    header.version = STATE_VERSION;
+    header.byte_order = BYTE_ORDER_MARK;
+    out.put(header);
+    out.put<uint8_t>(build_completed_);
+    out.put<uint64_t>(change_seq_);
+    
+    record_store_.serialize(out);
+    spatial_index_.serialize(out);
+    temporal_index_.serialize(out);
+    
+    std::vector<ObjectLink> links;
+    links.reserve(object_records_.size());
+    for (const auto& [object_id, record_id] : object_records_) {
+        links.push_back({object_id, record_id});
+    }
+    std::sort(links.begin(), links.end(), [](const ObjectLink& a, const ObjectLink& b) {
+        return a.object_id < b.object_id;
+    });
+    out.put_vector(links);
+    
+    out.put<uint8_t>(window_aggregator_ != nullptr);
+    if (window_aggregator_) {
+        out.put(window_aggregator_->config());
+        window_aggregator_->serialize(out);
+    }
+    return state;
+}
+
+void SpatioIndexCore::deserialize(const char* data, size_t size) {
+    auto lock = write_lock();
+    ByteReader in(data, size);
+    try {
+        StateHeader header = in.get<StateHeader>();
+        if (std::memcmp(header.magic, STATE_MAGIC, sizeof(header.magic)) != 0) {
+            throw std::invalid_argument("Not a serialized SpatioIndexCore");
+        }
+        if (header.version != STATE_VERSION) {
+            throw std::invalid_argument("Unsupported serialized index version");
+        }
+        if (header.byte_order != BYTE_ORDER_MARK) {
+            throw std::invalid_argument("Serialized index has a different byte order");
+        }
+        bool built = in.get<uint8_t>() != 0;
+        uint64_t seq = in.get<uint64_t>();
+        
+        reset_contents();
+        if (change_feed_) {
+            change_feed_->reset();
+        }
+        record_store_.deserialize(in);
+        spatial_index_.deserialize(in);
+        temporal_index_.deserialize(in);
+        
+        std::vector<ObjectLink> links;
+        in.get_vector(links);
+        object_records_.reserve(links.size());
+        record_objects_.reserve(links.size());
+        for (const ObjectLink& link : links) {
+            object_records_[link.object_id] = link.record_id;
+            record_objects_[link.record_id] = link.object_id;
+        }
+        
+        // Installed only once the whole snapshot has been read
+        std::unique_ptr<WindowedAggregator> aggregator;
+        if (in.get<uint8_t>() != 0) {
+            aggregator = std::make_unique<WindowedAggregator>(
+                in.get<WindowedAggregator::Config>());
+            aggregator->deserialize(in);
+        }
+        if (in.remaining() != 0) {
+            throw std::invalid_argument("Serialized index is truncated or corrupt");
+        }
+        build_completed_ = built;
+        change_seq_ = seq;
+        if (aggregator) {
+            window_aggregator_ = std::move(aggregator);
+        }
+    } catch (...) {
+        reset_contents();
+        throw;
+    }
+    
+    if (count_grid_ && build_completed_) {
+        count_grid_->build(record_store_.records());
+    }
+    if (huge_pages_) {
+        advise_huge_pages();
+    }
+}
+
+// ==================== MEMORY ====================
+
+void SpatioIndexCore::set_huge_pages(bool enabled) {
+    auto lock = write_lock();
+    huge_pages_ = enabled;
+    if (enabled) {
+        advise_huge_pages();
+    }
+}
+
+std::vector<MemoryRegion> SpatioIndexCore::memory_regions() const {
+    std::vector<MemoryRegion> regions;
+    record_store_.memory_regions(regions);
+    temporal_index_.memory_regions(regions);
+    return regions;
+}
+
+void SpatioIndexCore::advise_huge_pages() const {
+    for (const MemoryRegion& region : memory_regions()) {
+        spatio::advise_huge_pages(region);
+    }
+}
+
+WarmupStats SpatioIndexCore::warmup(int tree_levels) const {
+    // Shared: writers would reallocate the arrays or free nodes under it
+    auto lock = read_lock();
+    auto start = std::chrono::steady_clock::now();
+    WarmupStats stats;
+    for (const MemoryRegion& region : memory_regions()) {
+        stats.prefaulted_bytes += prefault(region);
+    }
+    stats.touched_nodes = spatial_index_.touch_levels(tree_levels);
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return stats;
+}
+
 // ==================== FILTERING HELPERS ====================
 
 std::vector<uint64_t> SpatioIndexCore::filter_by_time(const std::vector<uint64_t>& spatial_ids,
@@ -153,7 +786,7 @@ std::vector<uint64_t> SpatioIndexCore::filter_by_time(const std::vector<uint64_t
     for (uint64_t id : spatial_ids) {
         // Use zero-copy pointer access
         const Record* record = record_store_.get_record_ptr(id);
-        if (record && record->t >= t_start && record->t <= t_end) {
+        if (record && record->active_during(t_start, t_end)) {
             results.push_back(id);
         }
     }
@@ -172,7 +805,7 @@ std::vector<uint64_t> SpatioIndexCore::filter_by_time_instrumented(
     for (uint64_t id : spatial_ids) {
         const Record* record = record_store_.get_record_ptr(id);
         if (record) {
-            if (record->t >= t_start && record->t <= t_end) {
+            if (record->active_during(t_start, t_end)) {
                 results.push_back(id);
                 stats.records_passed_time_filter++;
             } else {
@@ -187,20 +820,40 @@ std::vector<uint64_t> SpatioIndexCore::filter_by_time_instrumented(
 // ==================== STATISTICS ====================
 
 SpatioIndexCore::IndexStats SpatioIndexCore::get_index_stats() const {
+    auto lock = read_lock();
     IndexStats stats;
     stats.total_records = record_store_.size();
     stats.spatial_nodes = spatial_index_.size();
     stats.temporal_entries = temporal_index_.size();
     stats.min_time = temporal_index_.min_time();
     stats.max_time = temporal_index_.max_time();
+    stats.temporal_model_segments = temporal_index_.model_segments();
     stats.is_built = build_completed_;
     return stats;
 }
 
 void SpatioIndexCore::clear() {
+    auto lock = write_lock();
+    log_change(ChangeKind::CLEAR);
+    reset_contents();
+}
+
+void SpatioIndexCore::reset_contents() {
     record_store_.clear();
     spatial_index_.clear();
     temporal_index_.clear();
+    if (count_grid_) {
+        count_grid_->clear();
+    }
+    if (window_aggregator_) {
+        window_aggregator_->clear();
+    }
+    object_records_.clear();
+    record_objects_.clear();
+    if (query_cache_) {
+        query_cache_->invalidate_all();
+    }
+    standing_matches_.clear();  // Registered standing queries survive clear()
     build_completed_ = false;
 }
 
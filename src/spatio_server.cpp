@@ -0,0 +1,736 @@
+#include "spatio_server.hpp"
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <stdexcept>
+#include <cerrno>
+#include <cstring>
+#include <cstddef>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+namespace spatio {
+
+namespace {
+
+// epoll keys: kind in the top byte, connection ID or fd below
+constexpr uint64_t KEY_CONNECTION = 0;
+constexpr uint64_t KEY_LISTENER = 1ull << 56;
+constexpr uint64_t KEY_STOP = 2ull << 56;
+constexpr uint64_t KEY_DONE = 3ull << 56;
+constexpr uint64_t KEY_KIND_MASK = 0xffull << 56;
+
+constexpr size_t READ_SIZE = 64 * 1024;
+constexpr size_t MAX_READ_PER_EVENT = 256 * 1024;  // Fairness between connections
+
+std::runtime_error socket_error(const std::string& what) {
+    return std::runtime_error("spatio_server: " + what + ": " + std::strerror(errno));
+}
+
+void append_ids(std::string& out, const std::vector<uint64_t>& ids) {
+    uint32_t count = static_cast<uint32_t>(ids.size());
+    out.append(reinterpret_cast<const char*>(&count), sizeof(count));
+    out.append(reinterpret_cast<const char*>(ids.data()), ids.size() * sizeof(uint64_t));
+}
+
+void append_u64(std::string& out, uint64_t value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template <typename Body>
+Body read_body(const char* data) {
+    Body body;
+    std::memcpy(&body, data, sizeof(Body));
+    return body;
+}
+
+} // namespace
+
+struct SpatioServer::Connection {
+    int fd = -1;
+    uint64_t id = 0;
+    std::string in;
+    size_t in_pos = 0;       // Start of the first unparsed frame
+    std::string out;
+    size_t out_pos = 0;      // Start of the unsent output
+    bool paused = false;     // Waiting for room in the next batch
+    uint32_t events = 0;     // Current epoll interest
+
+    size_t backlog() const { return out.size() - out_pos; }
+};
+
+// ==================== LIFECYCLE ====================
+
+SpatioServer::SpatioServer(SpatioIndexCore& index, const Config& config)
+    : index_(index), config_(config) {
+    if (config_.unix_path.empty() && config_.tcp_port == 0) {
+        throw std::invalid_argument("spatio_server: configure a Unix socket path or a TCP port");
+    }
+    if (config_.max_batch == 0) {
+        throw std::invalid_argument("spatio_server: max_batch must be positive");
+    }
+    if (config_.threads == 0) {
+        config_.threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    place_nodes();
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    stop_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    done_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epoll_fd_ < 0 || stop_fd_ < 0 || done_fd_ < 0) {
+        int saved = errno;
+        if (epoll_fd_ >= 0) ::close(epoll_fd_);
+        if (stop_fd_ >= 0) ::close(stop_fd_);
+        if (done_fd_ >= 0) ::close(done_fd_);
+        errno = saved;
+        throw socket_error("epoll/eventfd");
+    }
+    add_watch(stop_fd_, KEY_STOP, EPOLLIN);
+    add_watch(done_fd_, KEY_DONE, EPOLLIN);
+}
+
+SpatioServer::~SpatioServer() {
+    for (auto& entry : connections_) {
+        ::close(entry.second->fd);
+    }
+    for (int fd : listeners_) {
+        ::close(fd);
+    }
+    if (!config_.unix_path.empty() && listening_) {
+        ::unlink(config_.unix_path.c_str());
+    }
+    ::close(done_fd_);
+    ::close(stop_fd_);
+    ::close(epoll_fd_);
+}
+
+void SpatioServer::listen() {
+    if (listening_) return;
+
+    if (!config_.unix_path.empty()) {
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        if (config_.unix_path.size() >= sizeof(addr.sun_path)) {
+            throw std::invalid_argument("spatio_server: Unix socket path too long");
+        }
+        std::memcpy(addr.sun_path, config_.unix_path.c_str(), config_.unix_path.size() + 1);
+        int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd < 0) throw socket_error("socket");
+        ::unlink(config_.unix_path.c_str());  // Stale socket from an earlier run
+        if (::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 ||
+            ::listen(fd, SOMAXCONN) < 0) {
+            int saved = errno;
+            ::close(fd);
+            errno = saved;
+            throw socket_error("bind " + config_.unix_path);
+        }
+        listeners_.push_back(fd);
+        add_watch(fd, KEY_LISTENER | static_cast<uint64_t>(fd), EPOLLIN);
+    }
+
+    if (config_.tcp_port != 0) {
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(static_cast<uint16_t>(config_.tcp_port));
+        if (::inet_pton(AF_INET, config_.tcp_host.c_str(), &addr.sin_addr) != 1) {
+            throw std::invalid_argument("spatio_server: bad TCP host " + config_.tcp_host);
+        }
+        int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd < 0) throw socket_error("socket");
+        int one = 1;
+        ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        if (::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 ||
+            ::listen(fd, SOMAXCONN) < 0) {
+            int saved = errno;
+            ::close(fd);
+            errno = saved;
+            throw socket_error("bind port " + std::to_string(config_.tcp_port));
+        }
+        listeners_.push_back(fd);
+        add_watch(fd, KEY_LISTENER | static_cast<uint64_t>(fd), EPOLLIN);
+    }
+    listening_ = true;
+}
+
+void SpatioServer::stop() {
+    uint64_t one = 1;
+    ssize_t ignored = ::write(stop_fd_, &one, sizeof(one));
+    (void)ignored;
+}
+
+SpatioServer::Stats SpatioServer::stats() const {
+    Stats stats;
+    stats.requests = requests_.load(std::memory_order_relaxed);
+    stats.batches = batches_done_.load(std::memory_order_relaxed);
+    stats.connections = accepted_.load(std::memory_order_relaxed);
+    stats.bad_requests = bad_requests_.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < nodes_.size(); i++) {
+        const ServingNode& node = *nodes_[i];
+        NodeStats node_stats;
+        node_stats.node = node.placement.id;
+        node_stats.workers = node.workers;
+        node_stats.replica = i > 0;
+        node_stats.requests = node.requests.load(std::memory_order_relaxed);
+        node_stats.response_bytes = node.response_bytes.load(std::memory_order_relaxed);
+        node_stats.busy_seconds = static_cast<double>(node.busy_ns.load(std::memory_order_relaxed)) / 1e9;
+        if (node.pinned) {
+            numa::PageCounts pages = numa::page_counts(node.placement.id);
+            node_stats.local_pages = pages.local - node.pages_start.local;
+            node_stats.remote_pages = pages.remote - node.pages_start.remote;
+        }
+        stats.nodes.push_back(node_stats);
+    }
+    return stats;
+}
+
+// ==================== EVENT LOOP ====================
+
+void SpatioServer::run() {
+    listen();
+    build_replicas();
+    {
+        std::lock_guard<std::mutex> lock(work_mutex_);
+        stopping_ = false;
+    }
+    for (size_t i = 0; i < config_.threads; i++) {
+        ServingNode* node = nodes_[i % nodes_.size()].get();
+        workers_.emplace_back([this, node]() { worker_loop(*node); });
+    }
+
+    std::vector<epoll_event> events(256);
+    bool running = true;
+    while (running) {
+        int n = ::epoll_wait(epoll_fd_, events.data(), static_cast<int>(events.size()), -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        for (int i = 0; i < n; i++) {
+            uint64_t key = events[i].data.u64;
+            uint64_t kind = key & KEY_KIND_MASK;
+            if (kind == KEY_STOP) {
+                running = false;
+            } else if (kind == KEY_DONE) {
+                finish_batch();
+            } else if (kind == KEY_LISTENER) {
+                accept_all(static_cast<int>(key & ~KEY_KIND_MASK));
+            } else {
+                auto it = connections_.find(key);
+                if (it == connections_.end()) continue;  // Closed earlier in this round
+                Connection& conn = *it->second;
+                if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                    close_connection(conn.id);
+                    continue;
+                }
+                if (events[i].events & EPOLLOUT) {
+                    on_writable(conn);
+                    if (connections_.find(key) == connections_.end()) continue;
+                }
+                if (events[i].events & EPOLLIN) {
+                    on_readable(conn);
+                }
+            }
+        }
+        if (!executing_ && !filling_->requests.empty()) {
+            submit_batch();
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(work_mutex_);
+        stopping_ = true;
+    }
+    work_cv_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+    workers_.clear();
+
+    // Drop requests that never ran and consume the stop signal, so run()
+    // can be called again
+    executing_ = nullptr;
+    filling_->requests.clear();
+    filling_->has_writes = false;
+    uint64_t value;
+    while (::read(stop_fd_, &value, sizeof(value)) > 0) {}
+    while (::read(done_fd_, &value, sizeof(value)) > 0) {}
+}
+
+void SpatioServer::add_watch(int fd, uint64_t key, uint32_t events) {
+    epoll_event event{};
+    event.events = events;
+    event.data.u64 = key;
+    if (::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) < 0) {
+        throw socket_error("epoll_ctl");
+    }
+}
+
+void SpatioServer::accept_all(int listener) {
+    while (true) {
+        int fd = ::accept4(listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            return;  // EAGAIN, or out of descriptors: try again on the next event
+        }
+        int one = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));  // Fails harmlessly on Unix sockets
+
+        auto conn = std::make_unique<Connection>();
+        conn->fd = fd;
+        conn->id = next_connection_++;
+        conn->events = EPOLLIN;
+        try {
+            add_watch(fd, KEY_CONNECTION | conn->id, EPOLLIN);
+        } catch (const std::runtime_error&) {
+            ::close(fd);
+            continue;
+        }
+        connections_.emplace(conn->id, std::move(conn));
+        accepted_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void SpatioServer::on_readable(Connection& conn) {
+    size_t total = 0;
+    while (total < MAX_READ_PER_EVENT) {
+        size_t old_size = conn.in.size();
+        conn.in.resize(old_size + READ_SIZE);
+        ssize_t got = ::recv(conn.fd, &conn.in[old_size], READ_SIZE, 0);
+        conn.in.resize(old_size + (got > 0 ? static_cast<size_t>(got) : 0));
+        if (got > 0) {
+            total += static_cast<size_t>(got);
+            if (static_cast<size_t>(got) < READ_SIZE) break;
+            continue;
+        }
+        if (got < 0 && errno == EINTR) continue;
+        if (got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        close_connection(conn.id);  // EOF or error
+        return;
+    }
+    parse_frames(conn);
+}
+
+void SpatioServer::on_writable(Connection& conn) {
+    if (flush(conn)) {
+        update_interest(conn);
+    }
+}
+
+void SpatioServer::parse_frames(Connection& conn) {
+    using namespace protocol;
+    Batch& batch = *filling_;
+    uint64_t id = conn.id;
+
+    while (conn.in.size() - conn.in_pos >= sizeof(uint32_t)) {
+        const char* frame = conn.in.data() + conn.in_pos;
+        uint32_t length;
+        std::memcpy(&length, frame, sizeof(length));
+        if (length < HEADER_SIZE - sizeof(uint32_t) || length > MAX_FRAME_SIZE) {
+            bad_requests_.fetch_add(1, std::memory_order_relaxed);
+            close_connection(id);  // Framing is lost; nothing sensible to reply
+            return;
+        }
+        if (conn.in.size() - conn.in_pos < sizeof(uint32_t) + length) break;
+        if (batch.requests.size() >= config_.max_batch) {
+            conn.paused = true;
+            paused_.push_back(id);
+            break;
+        }
+
+        RequestHeader header;
+        std::memcpy(&header, frame, sizeof(header));
+        size_t size = length + sizeof(uint32_t) - HEADER_SIZE;
+
+        batch.requests.emplace_back();
+        Request& request = batch.requests.back();
+        request.connection = id;
+        request.tag = header.tag;
+        request.op = header.op;
+        request.body_size = 0;
+        if (header.op >= OP_COUNT || size != body_size(header.op)) {
+            request.op = OP_COUNT;  // Answered with STATUS_BAD_REQUEST
+            bad_requests_.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            request.body_size = static_cast<uint8_t>(size);
+            std::memcpy(request.body, frame + HEADER_SIZE, size);
+            batch.has_writes = batch.has_writes || is_write(header.op);
+        }
+        conn.in_pos += sizeof(uint32_t) + length;
+    }
+
+    // Compact once the consumed prefix dominates
+    if (conn.in_pos == conn.in.size()) {
+        conn.in.clear();
+        conn.in_pos = 0;
+    } else if (conn.in_pos > READ_SIZE && conn.in_pos * 2 > conn.in.size()) {
+        conn.in.erase(0, conn.in_pos);
+        conn.in_pos = 0;
+    }
+    update_interest(conn);
+}
+
+bool SpatioServer::flush(Connection& conn) {
+    while (conn.backlog() > 0) {
+        ssize_t sent = ::send(conn.fd, conn.out.data() + conn.out_pos, conn.backlog(), MSG_NOSIGNAL);
+        if (sent > 0) {
+            conn.out_pos += static_cast<size_t>(sent);
+            continue;
+        }
+        if (sent < 0 && errno == EINTR) continue;
+        if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        close_connection(conn.id);
+        return false;
+    }
+    if (conn.out_pos == conn.out.size()) {
+        conn.out.clear();
+        conn.out_pos = 0;
+    } else if (conn.out_pos * 2 > conn.out.size()) {
+        conn.out.erase(0, conn.out_pos);
+        conn.out_pos = 0;
+    }
+    return true;
+}
+
+void SpatioServer::update_interest(Connection& conn) {
+    uint32_t events = 0;
+    if (!conn.paused && conn.backlog() < config_.max_output) events |= EPOLLIN;
+    if (conn.backlog() > 0) events |= EPOLLOUT;
+    if (events == conn.events) return;
+
+    epoll_event event{};
+    event.events = events;
+    event.data.u64 = KEY_CONNECTION | conn.id;
+    ::epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, conn.fd, &event);
+    conn.events = events;
+}
+
+void SpatioServer::close_connection(uint64_t id) {
+    auto it = connections_.find(id);
+    if (it == connections_.end()) return;
+    ::epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, it->second->fd, nullptr);
+    ::close(it->second->fd);
+    connections_.erase(it);  // Responses still in flight for it are dropped
+}
+
+// ==================== BATCHES ====================
+
+void SpatioServer::submit_batch() {
+    Batch* batch = filling_;
+    filling_ = (batch == &batches_[0]) ? &batches_[1] : &batches_[0];
+    filling_->requests.clear();
+    filling_->has_writes = false;
+
+    size_t n = batch->requests.size();
+    size_t chunks = (n + CHUNK - 1) / CHUNK;
+    batch->response_end.resize(n);
+    if (batch->outputs.size() < chunks) batch->outputs.resize(chunks);
+    for (size_t c = 0; c < chunks; c++) {
+        batch->outputs[c].clear();
+    }
+
+    // Writes: one worker per node, in order
+    size_t units = batch->has_writes ? nodes_.size() : chunks;
+    {
+        std::lock_guard<std::mutex> lock(work_mutex_);
+        executing_ = batch;
+        units_ = batch->has_writes ? 0 : chunks;
+        next_unit_ = 0;
+        units_left_ = units;
+        if (batch->has_writes) {
+            for (auto& node : nodes_) node->write_pending = true;
+        }
+    }
+    if (units == 1) {
+        work_cv_.notify_one();
+    } else {
+        work_cv_.notify_all();
+    }
+
+    // The filling batch is empty again: read from paused connections
+    resume_paused();
+}
+
+void SpatioServer::finish_batch() {
+    uint64_t value;
+    if (::read(done_fd_, &value, sizeof(value)) <= 0 || !executing_) return;
+
+    Batch& batch = *executing_;
+    std::vector<uint64_t> touched;
+    Connection* last = nullptr;
+    for (size_t i = 0; i < batch.requests.size(); i++) {
+        const Request& request = batch.requests[i];
+        if (!last || last->id != request.connection) {
+            auto it = connections_.find(request.connection);
+            last = it == connections_.end() ? nullptr : it->second.get();
+            if (!last) continue;
+            touched.push_back(last->id);
+        }
+        size_t begin = i % CHUNK == 0 ? 0 : batch.response_end[i - 1];
+        const std::string& output = batch.outputs[i / CHUNK];
+        last->out.append(output, begin, batch.response_end[i] - begin);
+    }
+    requests_.fetch_add(batch.requests.size(), std::memory_order_relaxed);
+    batches_done_.fetch_add(1, std::memory_order_relaxed);
+
+    {
+        std::lock_guard<std::mutex> lock(work_mutex_);
+        executing_ = nullptr;
+    }
+
+    std::sort(touched.begin(), touched.end());
+    touched.erase(std::unique(touched.begin(), touched.end()), touched.end());
+    for (uint64_t id : touched) {
+        auto it = connections_.find(id);
+        if (it == connections_.end()) continue;
+        Connection& conn = *it->second;
+        if (flush(conn)) {
+            update_interest(conn);
+        }
+    }
+
+    if (!filling_->requests.empty()) {
+        submit_batch();
+    }
+}
+
+void SpatioServer::resume_paused() {
+    std::vector<uint64_t> paused;
+    paused.swap(paused_);
+    for (uint64_t id : paused) {
+        auto it = connections_.find(id);
+        if (it == connections_.end()) continue;
+        Connection& conn = *it->second;
+        conn.paused = false;
+        parse_frames(conn);  // May pause it again
+    }
+}
+
+// ==================== NUMA PLACEMENT ====================
+
+void SpatioServer::place_nodes() {
+    std::vector<numa::Node> topology;
+    if (config_.numa && config_.threads > 1) {
+        topology = numa::nodes();
+    }
+
+    if (topology.size() > 1) {
+        // The index was most likely built on the node we are on: that
+        // node serves it, the others get replicas
+        size_t home = numa::current_node(topology);
+        std::rotate(topology.begin(), topology.begin() + static_cast<std::ptrdiff_t>(home),
+                    topology.begin() + static_cast<std::ptrdiff_t>(home) + 1);
+        if (topology.size() > config_.threads) topology.resize(config_.threads);
+        for (numa::Node& placement : topology) {
+            auto node = std::make_unique<ServingNode>();
+            node->placement = std::move(placement);
+            node->pinned = true;
+            node->pages_start = numa::page_counts(node->placement.id);
+            nodes_.push_back(std::move(node));
+        }
+    } else {
+        nodes_.push_back(std::make_unique<ServingNode>());  // Anywhere, unpinned
+    }
+
+    nodes_[0]->index = &index_;
+    for (size_t i = 0; i < config_.threads; i++) {
+        nodes_[i % nodes_.size()]->workers++;
+    }
+}
+
+void SpatioServer::build_replicas() {
+    if (nodes_.size() < 2) return;
+
+    // Rebuilt on every run(): the index may have changed in between
+    std::string state = index_.serialize();
+    std::vector<std::exception_ptr> errors(nodes_.size());
+    std::vector<std::thread> builders;
+    for (size_t i = 1; i < nodes_.size(); i++) {
+        builders.emplace_back([this, &state, &errors, i]() {
+            ServingNode& node = *nodes_[i];
+            try {
+                // First touch from the node itself places the pages there
+                numa::pin_thread(node.placement);
+                numa::prefer_memory(node.placement);
+                node.replica.reset();
+                node.replica = std::make_unique<SpatioIndexCore>();
+                node.replica->deserialize(state.data(), state.size());
+                node.index = node.replica.get();
+            } catch (...) {
+                errors[i] = std::current_exception();
+            }
+        });
+    }
+    for (auto& builder : builders) {
+        builder.join();
+    }
+    for (const std::exception_ptr& error : errors) {
+        if (error) std::rethrow_exception(error);
+    }
+}
+
+// ==================== WORKERS ====================
+
+void SpatioServer::worker_loop(ServingNode& node) {
+    if (node.pinned) {
+        numa::pin_thread(node.placement);
+        numa::prefer_memory(node.placement);
+    }
+
+    std::unique_lock<std::mutex> lock(work_mutex_);
+    while (true) {
+        work_cv_.wait(lock, [this, &node]() {
+            return stopping_ || next_unit_ < units_ || node.write_pending;
+        });
+        if (stopping_) return;
+        size_t unit = 0;
+        if (node.write_pending) {
+            node.write_pending = false;
+        } else {
+            unit = next_unit_++;
+        }
+        lock.unlock();
+
+        execute_unit(unit, node);
+
+        lock.lock();
+        if (--units_left_ == 0) {
+            units_ = 0;
+            next_unit_ = 0;
+            uint64_t one = 1;
+            ssize_t ignored = ::write(done_fd_, &one, sizeof(one));
+            (void)ignored;
+        }
+    }
+}
+
+void SpatioServer::execute_unit(size_t unit, ServingNode& node) {
+    auto begin = std::chrono::steady_clock::now();
+    Batch& batch = *executing_;
+    size_t chunks = (batch.requests.size() + CHUNK - 1) / CHUNK;
+    uint64_t executed = 0;
+    uint64_t bytes = 0;
+    if (batch.has_writes && node.index != &index_) {
+        // Replica: apply the writes, drop the responses
+        std::string scratch;
+        for (const Request& request : batch.requests) {
+            if (request.op < protocol::OP_COUNT && protocol::is_write(request.op)) {
+                scratch.clear();
+                execute(request, scratch, *node.index);
+                executed++;
+            }
+        }
+    } else {
+        size_t first = batch.has_writes ? 0 : unit;
+        size_t last = batch.has_writes ? chunks : unit + 1;
+        for (size_t c = first; c < last; c++) {
+            execute_chunk(batch, c, *node.index);
+            bytes += batch.outputs[c].size();
+        }
+        executed = std::min(batch.requests.size(), last * CHUNK) - first * CHUNK;
+    }
+    auto elapsed = std::chrono::steady_clock::now() - begin;
+    node.requests.fetch_add(executed, std::memory_order_relaxed);
+    node.response_bytes.fetch_add(bytes, std::memory_order_relaxed);
+    node.busy_ns.fetch_add(static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()),
+        std::memory_order_relaxed);
+}
+
+void SpatioServer::execute_chunk(Batch& batch, size_t chunk, SpatioIndexCore& index) {
+    std::string& out = batch.outputs[chunk];
+    size_t end = std::min(batch.requests.size(), (chunk + 1) * CHUNK);
+    for (size_t i = chunk * CHUNK; i < end; i++) {
+        execute(batch.requests[i], out, index);
+        batch.response_end[i] = static_cast<uint32_t>(out.size());
+    }
+}
+
+void SpatioServer::execute(const Request& request, std::string& out, SpatioIndexCore& index) {
+    using namespace protocol;
+    if (request.op >= OP_COUNT) {
+        finish_response(out, begin_response(out, request.tag, STATUS_BAD_REQUEST));
+        return;
+    }
+
+    size_t start = begin_response(out, request.tag, STATUS_OK);
+    try {
+        switch (request.op) {
+            case OP_PING:
+                break;
+            case OP_SIZE:
+                append_u64(out, index.size());
+                break;
+            case OP_INSERT: {
+                auto body = read_body<InsertBody>(request.body);
+                uint64_t id = body.t_end == body.t
+                    ? index.insert(body.lat, body.lon, body.t)
+                    : index.insert_interval(body.lat, body.lon, body.t, body.t_end);
+                append_u64(out, id);
+                break;
+            }
+            case OP_BUILD:
+                index.build();
+                break;
+            case OP_RADIUS_TIME: {
+                auto body = read_body<RadiusTimeBody>(request.body);
+                append_ids(out, index.query_radius_time(body.lat, body.lon, body.radius_km,
+                                                         body.t_start, body.t_end));
+                break;
+            }
+            case OP_BOX_TIME: {
+                auto body = read_body<BoxTimeBody>(request.body);
+                append_ids(out, index.query_box_time(body.lat_min, body.lon_min,
+                                                      body.lat_max, body.lon_max,
+                                                      body.t_start, body.t_end));
+                break;
+            }
+            case OP_KNN: {
+                auto body = read_body<KnnBody>(request.body);
+                size_t k = static_cast<size_t>(std::min<uint64_t>(body.k, index.size()));
+                append_ids(out, index.query_knn(body.lat, body.lon, k));
+                break;
+            }
+            case OP_KNN_TIME: {
+                auto body = read_body<KnnBody>(request.body);
+                size_t k = static_cast<size_t>(std::min<uint64_t>(body.k, index.size()));
+                append_ids(out, index.query_knn_time(body.lat, body.lon, k,
+                                                      body.t_start, body.t_end));
+                break;
+            }
+            case OP_COUNT_TIME: {
+                auto body = read_body<TimeRangeBody>(request.body);
+                append_u64(out, index.count_time_range(body.t_start, body.t_end));
+                break;
+            }
+            case OP_COUNT_BOX_TIME: {
+                auto body = read_body<BoxTimeBody>(request.body);
+                append_u64(out, index.count_box_time(body.lat_min, body.lon_min,
+                                                      body.lat_max, body.lon_max,
+                                                      body.t_start, body.t_end));
+                break;
+            }
+            case OP_GET_RECORD: {
+                auto body = read_body<GetRecordBody>(request.body);
+                const Record* record = index.get_record_ptr(body.id);
+                if (!record) {
+                    out[start + offsetof(ResponseHeader, status)] = static_cast<char>(STATUS_NOT_FOUND);
+                } else {
+                    out.append(reinterpret_cast<const char*>(record), sizeof(Record));
+                }
+                break;
+            }
+        }
+    } catch (const std::exception& e) {
+        out.resize(start);
+        start = begin_response(out, request.tag, STATUS_ERROR);
+        out.append(e.what());
+    }
+    finish_response(out, start);
+}
+
+} // namespace spatio
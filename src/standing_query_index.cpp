@@ -0,0 +1,168 @@
+#include "standing_query_index.hpp"
+#include "utils.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace spatio {
+
+// ==================== REGIONS ====================
+
+StandingQuery StandingQuery::circle(float center_lat, float center_lon, double radius_km) {
+    StandingQuery q;
+    q.shape = Shape::Circle;
+    q.lat_a = center_lat;
+    q.lon_a = center_lon;
+    q.radius_km = radius_km;
+    return q;
+}
+
+StandingQuery StandingQuery::box(float lat_min, float lon_min, float lat_max, float lon_max) {
+    StandingQuery q;
+    q.shape = Shape::Box;
+    q.lat_a = lat_min;
+    q.lon_a = lon_min;
+    q.lat_b = lat_max;
+    q.lon_b = lon_max;
+    return q;
+}
+
+bool StandingQuery::contains(float lat, float lon) const {
+    if (shape == Shape::Circle) {
+        return haversine_distance(lat_a, lon_a, lat, lon) <= radius_km * 1000.0;
+    }
+    return lat >= lat_a && lat <= lat_b && lon >= lon_a && lon <= lon_b;
+}
+
+// ==================== INDEX ====================
+
+StandingQueryIndex::StandingQueryIndex(double cell_deg)
+    : cell_deg_(cell_deg > 0.0 ? cell_deg : 0.01) {
+    reset_levels();
+}
+
+void StandingQueryIndex::set_cell_size(double cell_deg) {
+    cell_deg_ = cell_deg > 0.0 ? cell_deg : 0.01;
+    reset_levels();
+    for (auto& [handle, entry] : queries_) place(entry);
+}
+
+void StandingQueryIndex::reset_levels() {
+    // Up to the first level whose cells span the globe, where any region
+    // fits in a 2 x 2 block
+    levels_.clear();
+    double deg = cell_deg_;
+    do {
+        levels_.push_back(Level{deg, 0, {}});
+        deg *= LEVEL_FANOUT;
+    } while (levels_.back().cell_deg < 360.0);
+}
+
+uint64_t StandingQueryIndex::add(const StandingQuery& query, double t_start, double t_end) {
+    double lat_min, lat_max, lon_min, lon_max;
+    if (query.shape == StandingQuery::Shape::Circle) {
+        radius_bbox(query.lat_a, query.lon_a, query.radius_km, lat_min, lat_max, lon_min, lon_max);
+    } else {
+        lat_min = query.lat_a;
+        lat_max = query.lat_b;
+        lon_min = query.lon_a;
+        lon_max = query.lon_b;
+    }
+
+    uint64_t handle = next_handle_++;
+    // Widened by an ulp so rounding to float cannot cut off a boundary point
+    Entry entry{{query,
+                 std::nextafter(static_cast<float>(lat_min), -HUGE_VALF),
+                 std::nextafter(static_cast<float>(lat_max), HUGE_VALF),
+                 std::nextafter(static_cast<float>(lon_min), -HUGE_VALF),
+                 std::nextafter(static_cast<float>(lon_max), HUGE_VALF),
+                 t_start, t_end, handle},
+                0, 0, -1, 0, -1};
+    place(entry);
+    queries_.emplace(handle, entry);
+    return handle;
+}
+
+void StandingQueryIndex::place(Entry& entry) {
+    const CellEntry& region = entry.cell_entry;
+    for (size_t level = 0; level < levels_.size(); level++) {
+        double deg = levels_[level].cell_deg;
+        entry.level = level;
+        entry.lat_cell_min = cell_of(region.lat_min, deg);
+        entry.lat_cell_max = cell_of(region.lat_max, deg);
+        entry.lon_cell_min = cell_of(region.lon_min, deg);
+        entry.lon_cell_max = cell_of(region.lon_max, deg);
+        if (entry.lat_cell_max - entry.lat_cell_min < LEVEL_FANOUT &&
+            entry.lon_cell_max - entry.lon_cell_min < LEVEL_FANOUT) {
+            break;
+        }
+    }
+
+    Level& level = levels_[entry.level];
+    for (long a = entry.lat_cell_min; a <= entry.lat_cell_max; a++) {
+        for (long b = entry.lon_cell_min; b <= entry.lon_cell_max; b++) {
+            level.cells[cell_key(a, b)].push_back(region);
+        }
+    }
+    level.regions++;
+}
+
+bool StandingQueryIndex::remove(uint64_t handle) {
+    auto it = queries_.find(handle);
+    if (it == queries_.end()) return false;
+
+    const Entry& entry = it->second;
+    Level& level = levels_[entry.level];
+    for (long a = entry.lat_cell_min; a <= entry.lat_cell_max; a++) {
+        for (long b = entry.lon_cell_min; b <= entry.lon_cell_max; b++) {
+            auto cell = level.cells.find(cell_key(a, b));
+            if (cell == level.cells.end()) continue;
+            std::vector<CellEntry>& entries = cell->second;
+            auto pos = std::find_if(entries.begin(), entries.end(),
+                                    [handle](const CellEntry& e) { return e.handle == handle; });
+            if (pos != entries.end()) {
+                *pos = entries.back();
+                entries.pop_back();
+            }
+            if (entries.empty()) level.cells.erase(cell);
+        }
+    }
+    level.regions--;
+
+    queries_.erase(it);
+    return true;
+}
+
+void StandingQueryIndex::match(float lat, float lon, double t, double t_end,
+                               std::vector<uint64_t>& handles) const {
+    for (const Level& level : levels_) {
+        if (level.regions == 0) continue;
+        auto cell = level.cells.find(cell_key(cell_of(lat, level.cell_deg),
+                                              cell_of(lon, level.cell_deg)));
+        if (cell == level.cells.end()) continue;
+        for (const CellEntry& entry : cell->second) {
+            if (lat < entry.lat_min || lat > entry.lat_max ||
+                lon < entry.lon_min || lon > entry.lon_max) {
+                continue;
+            }
+            if (t <= entry.t_end && t_end >= entry.t_start && entry.query.contains(lat, lon)) {
+                handles.push_back(entry.handle);
+            }
+        }
+    }
+}
+
+void StandingQueryIndex::clear() {
+    queries_.clear();
+    reset_levels();
+}
+
+long StandingQueryIndex::cell_of(double deg, double cell_deg) {
+    return static_cast<long>(std::floor(deg / cell_deg));
+}
+
+uint64_t StandingQueryIndex::cell_key(long lat_cell, long lon_cell) {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(lat_cell)) << 32) |
+           static_cast<uint32_t>(lon_cell);
+}
+
+} // namespace spatio
@@ -1,16 +1,70 @@
 #include "temporal_index.hpp"
+#include "utils.hpp"
 #include <algorithm>
+#include <cmath>
+#include <iterator>
 
 namespace spatio {
 
 void TemporalIndex::insert(double t, uint64_t id) {
-    time_index_.insert({t, id});
+    if (append_ingest_) {
+        ingest(t, id);
+    } else {
+        time_index_.insert({t, id});
+    }
     
     // Update time bounds (Optimization 3)
     min_time_ = std::min(min_time_, t);
     max_time_ = std::max(max_time_, t);
 }
 
+void TemporalIndex::insert_interval(double t_begin, double t_end, uint64_t id) {
+    double duration = t_end - t_begin;
+    if (!(duration > 0.0)) {
+        insert(t_begin, id);
+        return;
+    }
+    
+    DurationClass& cls = interval_classes_[std::ilogb(duration)];
+    cls.ends.emplace(std::make_pair(t_begin, id), t_end);
+    cls.max_duration = std::max(cls.max_duration, duration);
+    interval_count_++;
+    interval_delta_.emplace_back(t_begin, t_end);
+    
+    min_time_ = std::min(min_time_, t_begin);
+    max_time_ = std::max(max_time_, t_end);
+}
+
+bool TemporalIndex::update(double old_t, double new_t, uint64_t id) {
+    auto handle = tracked_.find(id);
+    if (handle == tracked_.end()) {
+        auto it = time_index_.find({old_t, id});
+        if (it == time_index_.end() && !late_.empty()) {
+            // Buffered late entry: move its node over to the set
+            auto node = late_.extract({old_t, id});
+            if (node) {
+                it = time_index_.insert(std::move(node)).position;
+            }
+        }
+        if (it == time_index_.end()) {
+            // Compacted entry: tombstone it and continue in the delta
+            if (!kill_column_entry(old_t, id)) {
+                return false;
+            }
+            it = time_index_.insert({old_t, id}).first;
+        }
+        handle = tracked_.emplace(id, it).first;
+    }
+    
+    // Streams mostly advance time, so hint at the end of the set
+    auto node = time_index_.extract(handle->second);
+    node.value().first = new_t;
+    handle->second = time_index_.insert(time_index_.end(), std::move(node));
+    min_time_ = std::min(min_time_, new_t);
+    max_time_ = std::max(max_time_, new_t);
+    return true;
+}
+
 std::vector<uint64_t> TemporalIndex::range_query(double t_start, double t_end) const {
     std::vector<uint64_t> results;
     
@@ -19,35 +73,606 @@ std::vector<uint64_t> TemporalIndex::range_query(double t_start, double t_end) c
         return results;
     }
     
-    // Reserve space for efficiency
-    results.reserve(time_index_.size() / 10); // Heuristic
+    // Find range [t_start, t_end] in the columns and in the delta
+    size_t col = column_lower_bound(t_start, false);
+    size_t col_end = column_lower_bound(t_end, true);
+    auto it = time_index_.lower_bound({t_start, 0});
+    auto it_end = time_index_.upper_bound({t_end, std::numeric_limits<uint64_t>::max()});
+    auto late = late_.lower_bound({t_start, 0});
+    auto late_end = late_.upper_bound({t_end, std::numeric_limits<uint64_t>::max()});
+    
+    results.reserve(col_end - col);
+    
+    // Next entry of the delta (set and late buffer), or nullptr
+    auto next_delta = [&]() -> const std::pair<double, uint64_t>* {
+        if (it == it_end) return late == late_end ? nullptr : &*late;
+        if (late == late_end || *it < *late) return &*it;
+        return &*late;
+    };
+    auto advance_delta = [&](const std::pair<double, uint64_t>* entry) {
+        if (it != it_end && entry == &*it) {
+            ++it;
+        } else {
+            ++late;
+        }
+    };
     
-    // Find range [t_start, t_end]
-    auto it_start = time_index_.lower_bound(t_start);
-    auto it_end = time_index_.upper_bound(t_end);
+    // Merge so instants come out in (t, ID) order
+    while (col < col_end) {
+        if (column_dead_count_ > 0 && column_dead_[col]) {
+            col++;
+            continue;
+        }
+        const auto* delta = next_delta();
+        if (delta && *delta < std::make_pair(column_times_[col], column_ids_[col])) {
+            results.push_back(delta->second);
+            advance_delta(delta);
+        } else {
+            results.push_back(column_ids_[col++]);
+        }
+    }
+    for (const auto* delta = next_delta(); delta; delta = next_delta()) {
+        results.push_back(delta->second);
+        advance_delta(delta);
+    }
     
-    for (auto it = it_start; it != it_end; ++it) {
-        results.push_back(it->second);
+    // Intervals: only starts within one class-duration before t_start can
+    // still be active
+    for (const auto& [k, cls] : interval_classes_) {
+        auto first = cls.ends.lower_bound({t_start - cls.max_duration, 0});
+        auto last = cls.ends.upper_bound({t_end, std::numeric_limits<uint64_t>::max()});
+        for (auto it = first; it != last; ++it) {
+            if (it->second >= t_start) {
+                results.push_back(it->first.second);
+            }
+        }
     }
     
     return results;
 }
 
+size_t TemporalIndex::count_range(double t_start, double t_end) const {
+    if (t_end < t_start || t_end < min_time_ || t_start > max_time_) {
+        return 0;
+    }
+    
+    size_t first = column_lower_bound(t_start, false);
+    size_t last = column_lower_bound(t_end, true);
+    size_t count = (last - first) - (dead_before(last) - dead_before(first));
+    
+    count += static_cast<size_t>(std::distance(
+        time_index_.lower_bound({t_start, 0}),
+        time_index_.upper_bound({t_end, std::numeric_limits<uint64_t>::max()})));
+    count += static_cast<size_t>(std::distance(
+        late_.lower_bound({t_start, 0}),
+        late_.upper_bound({t_end, std::numeric_limits<uint64_t>::max()})));
+    
+    // An interval ending before t_start also starts before it, so the
+    // second term only removes intervals the first one counted
+    size_t started = std::upper_bound(interval_starts_.begin(), interval_starts_.end(), t_end) -
+                     interval_starts_.begin();
+    size_t ended = std::lower_bound(interval_ends_.begin(), interval_ends_.end(), t_start) -
+                   interval_ends_.begin();
+    count += started - ended;
+    for (const auto& [begin, end] : interval_delta_) {
+        count += begin <= t_end && end >= t_start;
+    }
+    
+    return count;
+}
+
 std::vector<uint64_t> TemporalIndex::all_records() const {
     std::vector<uint64_t> results;
-    results.reserve(time_index_.size());
+    results.reserve(size());
     
+    for (size_t i = 0; i < column_ids_.size(); i++) {
+        if (column_dead_count_ == 0 || !column_dead_[i]) {
+            results.push_back(column_ids_[i]);
+        }
+    }
     for (const auto& [t, id] : time_index_) {
         results.push_back(id);
     }
+    for (const auto& [t, id] : late_) {
+        results.push_back(id);
+    }
+    for (const auto& [k, cls] : interval_classes_) {
+        for (const auto& [key, t_end] : cls.ends) {
+            results.push_back(key.second);
+        }
+    }
     
     return results;
 }
 
+// ==================== APPEND INGEST ====================
+
+void TemporalIndex::enable_append_ingest(double lateness) {
+    append_ingest_ = true;
+    lateness_ = std::max(lateness, 0.0);
+}
+
+void TemporalIndex::disable_append_ingest() {
+    merge_late();
+    append_ingest_ = false;
+}
+
+TemporalIndex::IngestStats TemporalIndex::ingest_stats() const {
+    IngestStats stats = ingest_stats_;
+    stats.pending_late = late_.size();
+    stats.watermark = append_ingest_ ? watermark() : std::numeric_limits<double>::lowest();
+    return stats;
+}
+
+void TemporalIndex::ingest(double t, uint64_t id) {
+    std::pair<double, uint64_t> entry{t, id};
+    if (column_times_.empty() ||
+        entry > std::make_pair(column_times_.back(), column_ids_.back())) {
+        append_column(t, id);
+        ingest_stats_.appended++;
+        
+        double mark = watermark();
+        if (!late_.empty() && mark > late_.begin()->first &&
+            mark - last_merge_watermark_ >= lateness_) {
+            merge_late();
+        }
+        return;
+    }
+    
+    // Out of order. The buffer may only hold entries past the prefix the
+    // search copy covers, so merges never touch it.
+    bool after_indexed = indexed_ == 0 ||
+                         entry > std::make_pair(column_times_[indexed_ - 1], column_ids_[indexed_ - 1]);
+    if (t >= watermark() && after_indexed) {
+        late_.insert(entry);
+        ingest_stats_.buffered_late++;
+    } else {
+        time_index_.insert(entry);
+        ingest_stats_.too_late++;
+    }
+}
+
+void TemporalIndex::append_column(double t, uint64_t id) {
+    column_times_.push_back(t);
+    column_ids_.push_back(id);
+    column_dead_.push_back(false);
+    if (!dead_tree_.empty()) {
+        dead_tree_append(false);
+    }
+}
+
+void TemporalIndex::merge_late() {
+    if (late_.empty()) return;
+    
+    // Only the tail newer than the oldest buffered entry is rewritten
+    auto oldest = *late_.begin();
+    size_t first = indexed_;
+    size_t last = column_times_.size();
+    while (first < last) {
+        size_t mid = first + (last - first) / 2;
+        if (std::make_pair(column_times_[mid], column_ids_[mid]) < oldest) {
+            first = mid + 1;
+        } else {
+            last = mid;
+        }
+    }
+    
+    size_t n = column_times_.size() - first + late_.size();
+    std::vector<double> times;
+    std::vector<uint64_t> ids;
+    std::vector<bool> dead;
+    times.reserve(n);
+    ids.reserve(n);
+    dead.reserve(n);
+    auto it = late_.begin();
+    for (size_t i = first; i < column_times_.size(); i++) {
+        std::pair<double, uint64_t> entry{column_times_[i], column_ids_[i]};
+        for (; it != late_.end() && *it < entry; ++it) {
+            times.push_back(it->first);
+            ids.push_back(it->second);
+            dead.push_back(false);
+        }
+        times.push_back(entry.first);
+        ids.push_back(entry.second);
+        dead.push_back(column_dead_[i]);
+    }
+    for (; it != late_.end(); ++it) {
+        times.push_back(it->first);
+        ids.push_back(it->second);
+        dead.push_back(false);
+    }
+    
+    column_times_.resize(first);
+    column_ids_.resize(first);
+    column_dead_.resize(first);
+    column_times_.insert(column_times_.end(), times.begin(), times.end());
+    column_ids_.insert(column_ids_.end(), ids.begin(), ids.end());
+    column_dead_.insert(column_dead_.end(), dead.begin(), dead.end());
+    
+    // Fenwick nodes up to `first` cover only untouched positions
+    if (!dead_tree_.empty()) {
+        dead_tree_.resize(first + 1);
+        for (size_t i = first; i < column_dead_.size(); i++) {
+            dead_tree_append(column_dead_[i]);
+        }
+    }
+    
+    late_.clear();
+    last_merge_watermark_ = watermark();
+    ingest_stats_.merges++;
+}
+
+// ==================== COLUMNS & LEARNED MODEL ====================
+
+void TemporalIndex::build() {
+    merge_late();
+    
+    // Merge live columns with the delta
+    std::vector<double> times;
+    std::vector<uint64_t> ids;
+    size_t total = column_times_.size() - column_dead_count_ + time_index_.size();
+    times.reserve(total);
+    ids.reserve(total);
+    
+    auto it = time_index_.begin();
+    for (size_t i = 0; i < column_times_.size(); i++) {
+        if (column_dead_count_ > 0 && column_dead_[i]) continue;
+        std::pair<double, uint64_t> entry{column_times_[i], column_ids_[i]};
+        for (; it != time_index_.end() && *it < entry; ++it) {
+            times.push_back(it->first);
+            ids.push_back(it->second);
+        }
+        times.push_back(entry.first);
+        ids.push_back(entry.second);
+    }
+    for (; it != time_index_.end(); ++it) {
+        times.push_back(it->first);
+        ids.push_back(it->second);
+    }
+    
+    column_times_.swap(times);
+    column_ids_.swap(ids);
+    column_dead_.assign(column_times_.size(), false);
+    column_dead_count_ = 0;
+    dead_tree_.clear();
+    time_index_.clear();
+    tracked_.clear();
+    
+    interval_starts_.clear();
+    interval_ends_.clear();
+    interval_delta_.clear();
+    for (const auto& [k, cls] : interval_classes_) {
+        for (const auto& [key, end] : cls.ends) {
+            interval_starts_.push_back(key.first);
+            interval_ends_.push_back(end);
+        }
+    }
+    std::sort(interval_starts_.begin(), interval_starts_.end());
+    std::sort(interval_ends_.begin(), interval_ends_.end());
+    
+    segment_keys_.clear();
+    segments_.clear();
+    column_search_.clear();
+    if (learned_model_enabled_) {
+        fit_model();
+    }
+    if (segments_.empty()) {
+        column_search_.build(column_times_.data(), column_times_.size());
+    }
+    indexed_ = column_times_.size();
+}
+
+void TemporalIndex::fit_model() {
+    // Greedy shrinking cone over distinct timestamps at their first
+    // position: a segment grows while some slope through its first point
+    // keeps every point within MODEL_ERROR, and the midpoint of the final
+    // feasible slope range satisfies all of them
+    const double eps = static_cast<double>(MODEL_ERROR);
+    const size_t n = column_times_.size();
+    size_t distinct = 0;
+    
+    double key = 0.0, pos = 0.0;
+    double slope_lo = 0.0, slope_hi = std::numeric_limits<double>::infinity();
+    auto close_segment = [&]() {
+        double slope = std::isinf(slope_hi) ? 0.0 : 0.5 * (slope_lo + slope_hi);
+        segment_keys_.push_back(key);
+        segments_.push_back({slope, pos});
+    };
+    
+    for (size_t i = 0; i < n; i++) {
+        if (i > 0 && column_times_[i] == column_times_[i - 1]) continue;
+        distinct++;
+        double t = column_times_[i];
+        double p = static_cast<double>(i);
+        if (distinct == 1) {
+            key = t;
+            pos = p;
+            continue;
+        }
+        
+        double dt = t - key;
+        double lo = (p - eps - pos) / dt;
+        double hi = (p + eps - pos) / dt;
+        if (lo > slope_hi || hi < slope_lo) {
+            close_segment();
+            key = t;
+            pos = p;
+            slope_lo = 0.0;
+            slope_hi = std::numeric_limits<double>::infinity();
+        } else {
+            slope_lo = std::max(slope_lo, lo);
+            slope_hi = std::min(slope_hi, hi);
+        }
+    }
+    if (distinct > 0) {
+        close_segment();
+    }
+    
+    // Too many segments: binary search over the columns is as good
+    if (segments_.size() > 1 && segments_.size() * MIN_KEYS_PER_SEGMENT > distinct) {
+        segment_keys_.clear();
+        segments_.clear();
+    }
+    segment_keys_.shrink_to_fit();
+    segments_.shrink_to_fit();
+}
+
+size_t TemporalIndex::column_lower_bound(double t, bool after) const {
+    size_t pos = indexed_lower_bound(t, after);
+    if (pos < indexed_) return pos;
+    
+    // Appended since build(): plain binary search over the tail
+    auto tail = column_times_.begin() + indexed_;
+    return after ? std::upper_bound(tail, column_times_.end(), t) - column_times_.begin()
+                 : std::lower_bound(tail, column_times_.end(), t) - column_times_.begin();
+}
+
+SPATIO_TARGET_CLONES
+size_t TemporalIndex::indexed_lower_bound(double t, bool after) const {
+    const double* times = column_times_.data();
+    const size_t n = indexed_;
+    auto before = [t, after](double v) { return after ? v <= t : v < t; };
+    
+    if (segments_.empty()) {
+        return after ? column_search_.upper_bound(t) : column_search_.lower_bound(t);
+    }
+    
+    // Predict, then search the error window around the prediction
+    size_t s = std::upper_bound(segment_keys_.begin(), segment_keys_.end(), t) - segment_keys_.begin();
+    s = s > 0 ? s - 1 : 0;
+    double predicted = segments_[s].pos + segments_[s].slope * (t - segment_keys_[s]);
+    predicted = std::min(std::max(predicted, 0.0), static_cast<double>(n));
+    size_t guess = static_cast<size_t>(predicted);
+    
+    size_t lo = guess > MODEL_ERROR + 1 ? guess - MODEL_ERROR - 1 : 0;
+    size_t hi = std::min(n, guess + MODEL_ERROR + 2);
+    
+    // The bound only holds at each timestamp's first position (and float
+    // rounding can shift it): widen exponentially until the window brackets
+    // the answer, so a bad prediction costs time but never correctness
+    for (size_t step = MODEL_ERROR; lo > 0 && !before(times[lo - 1]); step *= 2) {
+        lo = lo > step ? lo - step : 0;
+    }
+    for (size_t step = MODEL_ERROR; hi < n && before(times[hi]); step *= 2) {
+        hi = std::min(n, hi + step);
+    }
+    
+    return after ? std::upper_bound(times + lo, times + hi, t) - times
+                 : std::lower_bound(times + lo, times + hi, t) - times;
+}
+
+bool TemporalIndex::kill_column_entry(double t, uint64_t id) {
+    for (size_t i = column_lower_bound(t, false);
+         i < column_times_.size() && column_times_[i] == t; i++) {
+        if (column_ids_[i] == id && !column_dead_[i]) {
+            column_dead_[i] = true;
+            column_dead_count_++;
+            if (dead_tree_.empty()) {
+                dead_tree_.assign(column_times_.size() + 1, 0);
+            }
+            for (size_t j = i + 1; j < dead_tree_.size(); j += j & (~j + 1)) {
+                dead_tree_[j]++;
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+void TemporalIndex::dead_tree_append(bool dead) {
+    // Node j covers positions (j - lowbit(j), j]; all but the new one are
+    // already summed by the nodes below j
+    size_t j = dead_tree_.size();
+    size_t low = j & (~j + 1);
+    dead_tree_.push_back(static_cast<uint32_t>(dead + dead_before(j - 1) - dead_before(j - low)));
+}
+
+size_t TemporalIndex::dead_before(size_t end) const {
+    size_t count = 0;
+    if (dead_tree_.empty()) return count;
+    for (size_t j = end; j > 0; j -= j & (~j + 1)) {
+        count += dead_tree_[j];
+    }
+    return count;
+}
+
+void TemporalIndex::memory_regions(std::vector<MemoryRegion>& out) const {
+    out.push_back({column_times_.data(), column_times_.size() * sizeof(double)});
+    out.push_back({column_ids_.data(), column_ids_.size() * sizeof(uint64_t)});
+    if (!column_search_.empty()) {
+        out.push_back({column_search_.data(), (column_search_.size() + 1) * sizeof(double)});
+    }
+    out.push_back({interval_starts_.data(), interval_starts_.size() * sizeof(double)});
+    out.push_back({interval_ends_.data(), interval_ends_.size() * sizeof(double)});
+}
+
 void TemporalIndex::clear() {
     time_index_.clear();
+    tracked_.clear();
+    column_times_.clear();
+    column_ids_.clear();
+    column_dead_.clear();
+    column_dead_count_ = 0;
+    dead_tree_.clear();
+    segment_keys_.clear();
+    segments_.clear();
+    column_search_.clear();
+    indexed_ = 0;
+    late_.clear();
+    last_merge_watermark_ = std::numeric_limits<double>::lowest();
+    ingest_stats_ = IngestStats();
+    interval_classes_.clear();
+    interval_count_ = 0;
+    interval_starts_.clear();
+    interval_ends_.clear();
+    interval_delta_.clear();
     min_time_ = std::numeric_limits<double>::max();
     max_time_ = std::numeric_limits<double>::lowest();
 }
 
+// ==================== SERIALIZATION ====================
+
+namespace {
+
+struct PackedEntry {
+    double t;
+    uint64_t id;
+};
+
+struct PackedInterval {
+    double start;
+    uint64_t id;
+    double end;
+};
+
+struct PackedSpan {
+    double start;
+    double end;
+};
+
+template <typename Set>
+void put_entries(ByteWriter& out, const Set& entries) {
+    std::vector<PackedEntry> packed;
+    packed.reserve(entries.size());
+    for (const auto& [t, id] : entries) {
+        packed.push_back({t, id});
+    }
+    out.put_vector(packed);
+}
+
+template <typename Set>
+void get_entries(ByteReader& in, Set& entries) {
+    std::vector<PackedEntry> packed;
+    in.get_vector(packed);
+    for (const PackedEntry& e : packed) {
+        entries.emplace_hint(entries.end(), e.t, e.id);  // Sorted: O(1) each
+    }
+}
+
+} // namespace
+
+void TemporalIndex::serialize(ByteWriter& out) const {
+    out.put<double>(min_time_);
+    out.put<double>(max_time_);
+    out.put<uint8_t>(learned_model_enabled_);
+    out.put<uint8_t>(append_ingest_);
+    out.put<double>(lateness_);
+    out.put<double>(last_merge_watermark_);
+    out.put<IngestStats>(ingest_stats_);
+    
+    out.put_vector(column_times_);
+    out.put_vector(column_ids_);
+    std::vector<uint8_t> dead(column_dead_.begin(), column_dead_.end());
+    out.put_vector(dead);
+    out.put<uint64_t>(column_dead_count_);
+    out.put_vector(dead_tree_);
+    out.put<uint64_t>(indexed_);
+    out.put_vector(segment_keys_);
+    out.put_vector(segments_);
+    
+    put_entries(out, time_index_);
+    put_entries(out, late_);
+    
+    out.put<uint64_t>(interval_classes_.size());
+    for (const auto& [k, cls] : interval_classes_) {
+        out.put<int32_t>(k);
+        out.put<double>(cls.max_duration);
+        std::vector<PackedInterval> packed;
+        packed.reserve(cls.ends.size());
+        for (const auto& [key, end] : cls.ends) {
+            packed.push_back({key.first, key.second, end});
+        }
+        out.put_vector(packed);
+    }
+    out.put<uint64_t>(interval_count_);
+    out.put_vector(interval_starts_);
+    out.put_vector(interval_ends_);
+    std::vector<PackedSpan> delta;
+    delta.reserve(interval_delta_.size());
+    for (const auto& [start, end] : interval_delta_) {
+        delta.push_back({start, end});
+    }
+    out.put_vector(delta);
+}
+
+void TemporalIndex::deserialize(ByteReader& in) {
+    clear();
+    min_time_ = in.get<double>();
+    max_time_ = in.get<double>();
+    learned_model_enabled_ = in.get<uint8_t>() != 0;
+    append_ingest_ = in.get<uint8_t>() != 0;
+    lateness_ = in.get<double>();
+    last_merge_watermark_ = in.get<double>();
+    ingest_stats_ = in.get<IngestStats>();
+    
+    in.get_vector(column_times_);
+    in.get_vector(column_ids_);
+    std::vector<uint8_t> dead;
+    in.get_vector(dead);
+    column_dead_.assign(dead.begin(), dead.end());
+    column_dead_count_ = in.get<uint64_t>();
+    in.get_vector(dead_tree_);
+    indexed_ = in.get<uint64_t>();
+    in.get_vector(segment_keys_);
+    in.get_vector(segments_);
+    if (column_ids_.size() != column_times_.size() || column_dead_.size() != column_times_.size() ||
+        indexed_ > column_times_.size() || segment_keys_.size() != segments_.size()) {
+        throw std::invalid_argument("Serialized index is truncated or corrupt");
+    }
+    // The Fenwick tree exists once anything is dead and then covers every
+    // column slot; count_range trusts both without checking
+    if (column_dead_count_ != static_cast<size_t>(
+            std::count(column_dead_.begin(), column_dead_.end(), true)) ||
+        (dead_tree_.empty() ? column_dead_count_ > 0
+                            : dead_tree_.size() != column_times_.size() + 1)) {
+        throw std::invalid_argument("Serialized index is truncated or corrupt");
+    }
+    if (segments_.empty()) {
+        column_search_.build(column_times_.data(), indexed_);
+    }
+    
+    get_entries(in, time_index_);
+    get_entries(in, late_);
+    
+    size_t classes = in.get_count<int32_t>();
+    for (size_t c = 0; c < classes; c++) {
+        DurationClass& cls = interval_classes_[in.get<int32_t>()];
+        cls.max_duration = in.get<double>();
+        std::vector<PackedInterval> packed;
+        in.get_vector(packed);
+        for (const PackedInterval& e : packed) {
+            cls.ends.emplace_hint(cls.ends.end(), std::make_pair(e.start, e.id), e.end);
+        }
+    }
+    interval_count_ = in.get<uint64_t>();
+    in.get_vector(interval_starts_);
+    in.get_vector(interval_ends_);
+    std::vector<PackedSpan> delta;
+    in.get_vector(delta);
+    interval_delta_.reserve(delta.size());
+    for (const PackedSpan& span : delta) {
+        interval_delta_.emplace_back(span.start, span.end);
+    }
+}
+
 } // namespace spatio
\ No newline at end of file
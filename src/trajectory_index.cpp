@@ -0,0 +1,120 @@
+#include "trajectory_index.hpp"
+#include <algorithm>
+
+namespace spatio {
+
+void TrajectoryIndex::add_point(uint64_t object_id, double lat, double lon, double t) {
+    pending_.push_back({object_id, lat, lon, t});
+    built_ = false;
+}
+
+void TrajectoryIndex::build() {
+    points_ = pending_;
+    std::stable_sort(points_.begin(), points_.end(), [](const Ping& a, const Ping& b) {
+        return a.object_id != b.object_id ? a.object_id < b.object_id : a.t < b.t;
+    });
+
+    object_ids_.clear();
+    object_offsets_.clear();
+    segments_.clear();
+    for (uint32_t i = 0; i < points_.size(); i++) {
+        if (i == 0 || points_[i].object_id != points_[i - 1].object_id) {
+            object_ids_.push_back(points_[i].object_id);
+            object_offsets_.push_back(i);
+        }
+    }
+    object_offsets_.push_back(static_cast<uint32_t>(points_.size()));
+    object_search_.build(object_ids_.data(), object_ids_.size());
+
+    std::vector<RTreeBox<3>> boxes;
+    for (uint32_t obj = 0; obj < object_ids_.size(); obj++) {
+        uint32_t begin = object_offsets_[obj];
+        uint32_t end = object_offsets_[obj + 1];
+        // Single ping: a degenerate segment so the object is still findable
+        uint32_t last = end - begin > 1 ? end - 1 : end;
+        for (uint32_t i = begin; i < last; i++) {
+            const Ping& a = points_[i];
+            const Ping& b = points_[end - begin > 1 ? i + 1 : i];
+            segments_.push_back({i, obj});
+            boxes.push_back({{std::min(a.lat, b.lat), std::min(a.lon, b.lon), a.t},
+                             {std::max(a.lat, b.lat), std::max(a.lon, b.lon), b.t}});
+        }
+    }
+    rtree_.build(boxes);
+    built_ = true;
+}
+
+// ==================== QUERIES ====================
+
+std::vector<uint64_t> TrajectoryIndex::query_trajectories_box_time(
+    double lat_min, double lon_min, double lat_max, double lon_max,
+    double t_start, double t_end) const {
+    std::vector<uint64_t> result;
+    if (!built_) return result;
+
+    RTreeBox<3> box{{lat_min, lon_min, t_start}, {lat_max, lon_max, t_end}};
+    std::vector<uint32_t> objects;
+    rtree_.query(box, [&](uint32_t idx) {
+        const Segment& seg = segments_[idx];
+        // Consecutive hits often come from the same object (STR keeps a
+        // trajectory's segments close); skip the clip test for those
+        if (!objects.empty() && objects.back() == seg.object) return;
+        if (segment_hits(seg, box)) objects.push_back(seg.object);
+    });
+
+    std::sort(objects.begin(), objects.end());
+    objects.erase(std::unique(objects.begin(), objects.end()), objects.end());
+    result.reserve(objects.size());
+    for (uint32_t obj : objects) result.push_back(object_ids_[obj]);
+    return result;
+}
+
+bool TrajectoryIndex::segment_hits(const Segment& seg, const RTreeBox<3>& box) const {
+    const Ping& a = points_[seg.first];
+    uint32_t end = object_offsets_[seg.object + 1];
+    const Ping& b = seg.first + 1 < end ? points_[seg.first + 1] : a;
+
+    // Liang-Barsky: intersect the parameter range s in [0, 1] with the
+    // slab of every axis; the path is (lat, lon, t) = a + s * (b - a)
+    double s_lo = 0.0, s_hi = 1.0;
+    const double p0[3] = {a.lat, a.lon, a.t};
+    const double p1[3] = {b.lat, b.lon, b.t};
+    for (int d = 0; d < 3; d++) {
+        double delta = p1[d] - p0[d];
+        if (delta == 0.0) {
+            if (p0[d] < box.lo[d] || p0[d] > box.hi[d]) return false;
+            continue;
+        }
+        double s0 = (box.lo[d] - p0[d]) / delta;
+        double s1 = (box.hi[d] - p0[d]) / delta;
+        if (s0 > s1) std::swap(s0, s1);
+        s_lo = std::max(s_lo, s0);
+        s_hi = std::min(s_hi, s1);
+        if (s_lo > s_hi) return false;
+    }
+    return true;
+}
+
+std::vector<std::tuple<double, double, double>> TrajectoryIndex::trajectory(uint64_t object_id) const {
+    std::vector<std::tuple<double, double, double>> result;
+    size_t obj = object_search_.lower_bound(object_id);
+    if (obj == object_ids_.size() || object_ids_[obj] != object_id) return result;
+
+    for (uint32_t i = object_offsets_[obj]; i < object_offsets_[obj + 1]; i++) {
+        result.emplace_back(points_[i].lat, points_[i].lon, points_[i].t);
+    }
+    return result;
+}
+
+void TrajectoryIndex::clear() {
+    pending_.clear();
+    points_.clear();
+    object_ids_.clear();
+    object_offsets_.clear();
+    object_search_.clear();
+    segments_.clear();
+    rtree_.clear();
+    built_ = false;
+}
+
+} // namespace spatio
@@ -0,0 +1,176 @@
+#include "windowed_aggregator.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace spatio {
+
+WindowedAggregator::WindowedAggregator(const Config& config) : config_(config) {
+    if (!(config_.cell_deg > 0.0) || !(config_.bucket_width > 0.0) || config_.window_buckets == 0) {
+        throw std::invalid_argument(
+            "WindowedAggregator: cell_deg, bucket_width and window_buckets must be positive");
+    }
+    ring_size_ = 2 * config_.window_buckets;
+}
+
+// ==================== INGEST ====================
+
+bool WindowedAggregator::add(float lat, float lon, double t, double value) {
+    long a = cell_of(lat);
+    long b = cell_of(lon);
+    auto [it, inserted] = cell_index_.try_emplace(cell_key(a, b),
+                                                  static_cast<uint32_t>(cell_lat_.size()));
+    if (inserted) {
+        cell_lat_.push_back(a);
+        cell_lon_.push_back(b);
+        buckets_.resize(buckets_.size() + ring_size_);
+    }
+
+    int64_t index = bucket_of(t);
+    size_t slot = static_cast<size_t>(((index % static_cast<int64_t>(ring_size_)) +
+                                       static_cast<int64_t>(ring_size_)) %
+                                      static_cast<int64_t>(ring_size_));
+    Bucket& bucket = buckets_[it->second * ring_size_ + slot];
+    if (bucket.index > index) {
+        late_events_++;
+        return false;
+    }
+    if (bucket.index < index) {
+        // Lazy expiry: the slot held a bucket that has left the ring
+        bucket = Bucket();
+        bucket.index = index;
+    }
+    bucket.count++;
+    bucket.sum += value;
+    return true;
+}
+
+// ==================== QUERIES ====================
+
+std::vector<CellAggregate> WindowedAggregator::sliding(float lat_min, float lon_min,
+                                                       float lat_max, float lon_max,
+                                                       double now) const {
+    int64_t last = bucket_of(now);
+    int64_t first = last - static_cast<int64_t>(config_.window_buckets) + 1;
+    return aggregate(lat_min, lon_min, lat_max, lon_max, first, last);
+}
+
+std::vector<CellAggregate> WindowedAggregator::tumbling(float lat_min, float lon_min,
+                                                        float lat_max, float lon_max,
+                                                        double t) const {
+    int64_t width = static_cast<int64_t>(config_.window_buckets);
+    int64_t index = bucket_of(t);
+    // Floor division, so windows stay aligned for negative times
+    int64_t window = index >= 0 ? index / width : -((-index + width - 1) / width);
+    int64_t first = window * width;
+    return aggregate(lat_min, lon_min, lat_max, lon_max, first, first + width - 1);
+}
+
+std::vector<CellAggregate> WindowedAggregator::aggregate(float lat_min, float lon_min,
+                                                         float lat_max, float lon_max,
+                                                         int64_t first, int64_t last) const {
+    std::vector<CellAggregate> result;
+    if (lat_min > lat_max || lon_min > lon_max) return result;
+
+    long lat_lo = cell_of(lat_min), lat_hi = cell_of(lat_max);
+    long lon_lo = cell_of(lon_min), lon_hi = cell_of(lon_max);
+    double viewport_cells = static_cast<double>(lat_hi - lat_lo + 1) *
+                            static_cast<double>(lon_hi - lon_lo + 1);
+
+    if (viewport_cells <= static_cast<double>(cell_lat_.size())) {
+        for (long a = lat_lo; a <= lat_hi; a++) {
+            for (long b = lon_lo; b <= lon_hi; b++) {
+                auto it = cell_index_.find(cell_key(a, b));
+                if (it != cell_index_.end()) {
+                    aggregate_cell(it->second, first, last, result);
+                }
+            }
+        }
+    } else {
+        // Viewport spans more cells than have ever seen an event
+        for (size_t c = 0; c < cell_lat_.size(); c++) {
+            if (cell_lat_[c] >= lat_lo && cell_lat_[c] <= lat_hi &&
+                cell_lon_[c] >= lon_lo && cell_lon_[c] <= lon_hi) {
+                aggregate_cell(c, first, last, result);
+            }
+        }
+    }
+    return result;
+}
+
+void WindowedAggregator::aggregate_cell(size_t cell, int64_t first, int64_t last,
+                                        std::vector<CellAggregate>& out) const {
+    CellAggregate agg;
+    const Bucket* ring = &buckets_[cell * ring_size_];
+    // A slot counts only if it is tagged with a bucket of the window;
+    // anything else is stale and treated as empty
+    for (size_t s = 0; s < ring_size_; s++) {
+        if (ring[s].index >= first && ring[s].index <= last) {
+            agg.count += ring[s].count;
+            agg.sum += ring[s].sum;
+        }
+    }
+    if (agg.count == 0) return;
+
+    agg.lat_cell = cell_lat_[cell];
+    agg.lon_cell = cell_lon_[cell];
+    agg.lat_min = static_cast<double>(agg.lat_cell) * config_.cell_deg;
+    agg.lon_min = static_cast<double>(agg.lon_cell) * config_.cell_deg;
+    out.push_back(agg);
+}
+
+// ==================== HELPERS ====================
+
+int64_t WindowedAggregator::bucket_of(double t) const {
+    return static_cast<int64_t>(std::floor(t / config_.bucket_width));
+}
+
+long WindowedAggregator::cell_of(double coord) const {
+    return static_cast<long>(std::floor(coord / config_.cell_deg));
+}
+
+uint64_t WindowedAggregator::cell_key(long lat_cell, long lon_cell) {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(lat_cell)) << 32) |
+           static_cast<uint32_t>(lon_cell);
+}
+
+void WindowedAggregator::clear() {
+    cell_index_.clear();
+    cell_lat_.clear();
+    cell_lon_.clear();
+    buckets_.clear();
+    late_events_ = 0;
+}
+
+// ==================== SERIALIZATION ====================
+
+void WindowedAggregator::serialize(ByteWriter& out) const {
+    out.put_vector(cell_lat_);
+    out.put_vector(cell_lon_);
+    out.put_vector(buckets_);
+    out.put<uint64_t>(late_events_);
+}
+
+void WindowedAggregator::deserialize(ByteReader& in) {
+    clear();
+    in.get_vector(cell_lat_);
+    in.get_vector(cell_lon_);
+    in.get_vector(buckets_);
+    late_events_ = in.get<uint64_t>();
+    // Divided rather than multiplied: ring_size_ comes from the snapshot too
+    size_t cells = cell_lat_.size();
+    if (cell_lon_.size() != cells ||
+        (cells == 0 ? !buckets_.empty()
+                    : buckets_.size() % cells != 0 || buckets_.size() / cells != ring_size_)) {
+        throw std::invalid_argument("Serialized index is truncated or corrupt");
+    }
+    cell_index_.reserve(cell_lat_.size());
+    for (size_t c = 0; c < cell_lat_.size(); c++) {
+        if (!cell_index_.try_emplace(cell_key(cell_lat_[c], cell_lon_[c]),
+                                     static_cast<uint32_t>(c)).second) {
+            throw std::invalid_argument("Serialized index is truncated or corrupt");
+        }
+    }
+}
+
+} // namespace spatio
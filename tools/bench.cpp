@@ -0,0 +1,331 @@
+// spatio_bench: native benchmark of the engine without the Python boundary
+//
+//   spatio_bench --records 1000000 --queries 20000 --repeat 3
+//   spatio_bench --records 20000000 --huge-pages --only radius_time
+//
+// Fills a SpatioIndexCore with random points in lat [30, 50],
+// lon [-100, -80], t [0, 86400) (the spatio_server demo distribution), then
+// times build, the main query kinds, incremental inserts, moving-object
+// upserts and SegmentedIndex ingest. Everything is seeded, so every build
+// variant runs the same work; the checksum column (total result count)
+// must match between variants. Query timings are the best of --repeat
+// runs. This is also the training workload for the PGO build.
+//
+// Each line also shows dTLB load misses and page faults per operation
+// (perf_event_open; "-" where the kernel or VM exposes no hardware
+// counters). --huge-pages backs the index arrays and the MappedIndex copy
+// with transparent huge pages; run under
+// GLIBC_TUNABLES=glibc.malloc.hugetlb=1 to cover the KD-tree nodes too.
+// mapped_cold / mapped_warm time the first queries on a MappedIndex image
+// evicted from the page cache, without and with warmup().
+
+#include "spatio_index_core.hpp"
+#include "segmented_index.hpp"
+#include "mapped_index.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    size_t records = 1000000;
+    size_t queries = 20000;
+    size_t repeat = 3;
+    std::string only;          // Run a single benchmark
+    bool huge_pages = false;
+    std::string image = "/tmp/spatio_bench.img";  // MappedIndex image for mapped_*
+};
+
+void usage() {
+    std::fprintf(stderr,
+                 "usage: spatio_bench [--records N] [--queries N] [--repeat N] [--only NAME]\n"
+                 "                    [--huge-pages] [--image PATH]\n");
+    std::exit(2);
+}
+
+// Event counts of one measured span; -1 where the counter is unavailable
+struct Counts {
+    int64_t tlb_misses = -1;
+    int64_t faults = -1;
+};
+
+// dTLB load misses and page faults of this thread while started
+class Counters {
+public:
+    Counters() {
+        tlb_fd_ = open_event(PERF_TYPE_HW_CACHE,
+                             PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                 (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+        fault_fd_ = open_event(PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS);
+    }
+    ~Counters() {
+        if (tlb_fd_ >= 0) ::close(tlb_fd_);
+        if (fault_fd_ >= 0) ::close(fault_fd_);
+    }
+    Counters(const Counters&) = delete;
+    Counters& operator=(const Counters&) = delete;
+
+    void start() {
+        for (int fd : {tlb_fd_, fault_fd_}) {
+            if (fd < 0) continue;
+            ::ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ::ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+    Counts stop() {
+        return {read_event(tlb_fd_), read_event(fault_fd_)};
+    }
+
+private:
+    static int open_event(uint32_t type, uint64_t config) {
+        perf_event_attr attr{};
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        return static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+    }
+    static int64_t read_event(int fd) {
+        if (fd < 0) return -1;
+        ::ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        int64_t count = 0;
+        if (::read(fd, &count, sizeof(count)) != sizeof(count)) return -1;
+        return count;
+    }
+
+    int tlb_fd_ = -1;
+    int fault_fd_ = -1;
+};
+
+// Evict a file from the page cache, as after a reboot (clean pages only)
+void drop_cached(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return;
+    ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    ::close(fd);
+}
+
+struct QueryPoint {
+    float lat, lon;
+    double t;
+};
+
+double seconds_since(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+void report(const char* name, size_t ops, double seconds, uint64_t checksum, Counts counts) {
+    auto per_op = [ops](int64_t count) {
+        char text[32];
+        if (count < 0) std::snprintf(text, sizeof(text), "-");
+        else std::snprintf(text, sizeof(text), "%.2f", static_cast<double>(count) / static_cast<double>(ops));
+        return std::string(text);
+    };
+    std::printf("%-18s %12.0f ops/s %10.1f ns/op   checksum %llu   dTLB-miss/op %s   faults/op %s\n",
+                name, static_cast<double>(ops) / seconds, seconds * 1e9 / static_cast<double>(ops),
+                static_cast<unsigned long long>(checksum), per_op(counts.tlb_misses).c_str(),
+                per_op(counts.faults).c_str());
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        auto value = [&]() -> const char* {
+            if (i + 1 >= argc) usage();
+            return argv[++i];
+        };
+        if (arg == "--records") options.records = std::strtoull(value(), nullptr, 10);
+        else if (arg == "--queries") options.queries = std::strtoull(value(), nullptr, 10);
+        else if (arg == "--repeat") options.repeat = std::strtoull(value(), nullptr, 10);
+        else if (arg == "--only") options.only = value();
+        else if (arg == "--huge-pages") options.huge_pages = true;
+        else if (arg == "--image") options.image = value();
+        else usage();
+    }
+    if (options.records == 0 || options.queries == 0 || options.repeat == 0) usage();
+    auto enabled = [&](const char* name) { return options.only.empty() || options.only == name; };
+
+    std::mt19937_64 rng(42);
+    std::uniform_real_distribution<float> lat(30.0f, 50.0f), lon(-100.0f, -80.0f);
+    std::uniform_real_distribution<double> t(0.0, 86400.0);
+
+    std::vector<spatio::RecordInput> records;
+    records.reserve(options.records);
+    for (size_t i = 0; i < options.records; i++) {
+        records.emplace_back(lat(rng), lon(rng), t(rng));
+    }
+    std::vector<QueryPoint> points(options.queries);
+    for (QueryPoint& p : points) {
+        p = {lat(rng), lon(rng), t(rng)};
+    }
+
+    std::printf("records %zu, queries %zu, best of %zu\n", options.records, options.queries,
+                options.repeat);
+
+    Counters counters;
+    spatio::SpatioIndexCore index;
+    index.set_huge_pages(options.huge_pages);
+    auto start = Clock::now();
+    counters.start();
+    index.bulk_insert(records);
+    index.build();
+    Counts counts = counters.stop();
+    report("build", options.records, seconds_since(start), index.size(), counts);
+    std::printf("huge pages %s, %.1f MB of anonymous memory in transparent huge pages\n",
+                options.huge_pages ? "on" : "off",
+                static_cast<double>(spatio::anon_huge_page_bytes()) / 1e6);
+
+    // Best-of-repeat timing of one query kind over all query points
+    auto run_queries = [&](const char* name, const std::function<size_t(const QueryPoint&)>& query) {
+        if (!enabled(name)) return;
+        double best = 0.0;
+        uint64_t checksum = 0;
+        Counts best_counts;
+        for (size_t r = 0; r < options.repeat; r++) {
+            checksum = 0;
+            auto begin = Clock::now();
+            counters.start();
+            for (const QueryPoint& p : points) {
+                checksum += query(p);
+            }
+            Counts run_counts = counters.stop();
+            double elapsed = seconds_since(begin);
+            if (r == 0 || elapsed < best) {
+                best = elapsed;
+                best_counts = run_counts;
+            }
+        }
+        report(name, points.size(), best, checksum, best_counts);
+    };
+
+    run_queries("radius_time", [&](const QueryPoint& p) {
+        return index.query_radius_time(p.lat, p.lon, 2.0, p.t, p.t + 3600.0).size();
+    });
+    run_queries("box_time", [&](const QueryPoint& p) {
+        return index.query_box_time(p.lat, p.lon, p.lat + 0.05f, p.lon + 0.05f,
+                                    p.t, p.t + 3600.0).size();
+    });
+    run_queries("knn", [&](const QueryPoint& p) {
+        return index.query_knn(p.lat, p.lon, 10).size();
+    });
+    run_queries("knn_time", [&](const QueryPoint& p) {
+        return index.query_knn_time(p.lat, p.lon, 10, p.t, p.t + 3600.0).size();
+    });
+    run_queries("count_box_time", [&](const QueryPoint& p) {
+        return index.count_box_time(p.lat, p.lon, p.lat + 0.5f, p.lon + 0.5f,
+                                    p.t, p.t + 6 * 3600.0);
+    });
+    run_queries("count_time", [&](const QueryPoint& p) {
+        return index.count_time_range(p.t, p.t + 3600.0);
+    });
+
+    // First pass of queries on an image just attached from disk: single
+    // run, since a second one would find everything faulted in
+    if (enabled("mapped_cold") || enabled("mapped_warm")) {
+        index.save_mapped(options.image);
+        spatio::HugePages mode = options.huge_pages ? spatio::HugePages::TRANSPARENT
+                                                    : spatio::HugePages::OFF;
+        for (const char* name : {"mapped_cold", "mapped_warm"}) {
+            if (!enabled(name)) continue;
+            drop_cached(options.image);
+            spatio::MappedIndex mapped(options.image, mode);
+            if (std::strcmp(name, "mapped_warm") == 0) {
+                spatio::WarmupStats warm = mapped.warmup();
+                std::printf("%-18s %zu nodes touched in %.1f ms\n", "mapped_warmup",
+                            warm.touched_nodes, warm.seconds * 1e3);
+            }
+            uint64_t checksum = 0;
+            auto begin = Clock::now();
+            counters.start();
+            for (const QueryPoint& p : points) {
+                checksum += mapped.query_radius_time(p.lat, p.lon, 2.0, p.t, p.t + 3600.0).size();
+            }
+            counts = counters.stop();
+            report(name, points.size(), seconds_since(begin), checksum, counts);
+        }
+        std::remove(options.image.c_str());
+    }
+
+    if (enabled("insert")) {
+        size_t n = std::max<size_t>(1, options.records / 10);
+        start = Clock::now();
+        counters.start();
+        for (size_t i = 0; i < n; i++) {
+            index.insert(lat(rng), lon(rng), t(rng));
+        }
+        counts = counters.stop();
+        report("insert", n, seconds_since(start), index.size(), counts);
+    }
+
+    if (enabled("upsert")) {
+        size_t n = std::max<size_t>(1, options.records / 10);
+        size_t objects = std::max<size_t>(1, n / 10);
+        std::vector<spatio::ObjectUpdate> updates;
+        updates.reserve(n);
+        std::normal_distribution<float> step(0.0f, 0.001f);
+        std::vector<QueryPoint> positions(objects);
+        for (QueryPoint& p : positions) {
+            p = {lat(rng), lon(rng), 0.0};
+        }
+        for (size_t i = 0; i < n; i++) {
+            QueryPoint& p = positions[i % objects];
+            p.lat += step(rng);
+            p.lon += step(rng);
+            p.t += 1.0;
+            updates.emplace_back(i % objects, p.lat, p.lon, p.t);
+        }
+        start = Clock::now();
+        counters.start();
+        for (const spatio::ObjectUpdate& u : updates) {
+            index.upsert(u.object_id, u.lat, u.lon, u.t);
+        }
+        counts = counters.stop();
+        report("upsert", n, seconds_since(start), index.object_count(), counts);
+    }
+
+    if (enabled("segmented_ingest") || enabled("segmented_query")) {
+        spatio::SegmentedIndex::Config config;
+        config.background = false;  // Compaction inline, so it is part of the timing
+        spatio::SegmentedIndex segmented(config);
+        std::vector<spatio::SegmentRecord> batch;
+        batch.reserve(records.size());
+        for (const spatio::RecordInput& r : records) {
+            batch.push_back({r.lat, r.lon, r.t, 0});
+        }
+        start = Clock::now();
+        counters.start();
+        for (size_t i = 0; i < batch.size(); i += 4096) {
+            std::vector<spatio::SegmentRecord> chunk(
+                batch.begin() + static_cast<std::ptrdiff_t>(i),
+                batch.begin() + static_cast<std::ptrdiff_t>(std::min(batch.size(), i + 4096)));
+            segmented.bulk_insert(chunk);
+        }
+        counts = counters.stop();
+        if (enabled("segmented_ingest")) {
+            report("segmented_ingest", batch.size(), seconds_since(start), segmented.size(), counts);
+        }
+        run_queries("segmented_query", [&](const QueryPoint& p) {
+            return segmented.query_box_time(p.lat, p.lon, p.lat + 0.05f, p.lon + 0.05f,
+                                            p.t, p.t + 3600.0).size();
+        });
+    }
+    return 0;
+}
@@ -0,0 +1,63 @@
+#!/bin/sh
+# Build each optimization variant of spatio_bench and compare them.
+#
+#   tools/bench_variants.sh [build-root] [spatio_bench args...]
+#
+# Variants (one build directory each under build-root, default
+# build-variants): baseline, lto, native, x86-64-v3, dispatch,
+# dispatch+lto, pgo and pgo+lto+native. The PGO variants train on
+# spatio_bench itself first. dispatch+lto checks that the combination
+# builds cleanly; LTO builds do not clone, so it should match lto.
+# Prints each variant's ns/op per benchmark side by side.
+
+set -e
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+OUT=${1:-build-variants}
+[ $# -gt 0 ] && shift
+ARGS=${*:---records 1000000 --queries 5000 --repeat 3}
+
+configure_build() {
+    dir=$1; shift
+    cmake -S "$ROOT" -B "$OUT/$dir" -DSPATIO_BUILD_PYTHON=OFF "$@" >/dev/null
+    cmake --build "$OUT/$dir" --target spatio_bench -j >/dev/null
+}
+
+variant() {
+    name=$1; shift
+    echo "== $name" >&2
+    case "$name" in
+        pgo*)
+            configure_build "$name" -DSPATIO_PGO=GENERATE "$@"
+            rm -rf "$OUT/$name/pgo"
+            "$OUT/$name/spatio_bench" --records 1000000 --queries 20000 --repeat 1 >/dev/null
+            configure_build "$name" -DSPATIO_PGO=USE "$@"
+            ;;
+        *)
+            configure_build "$name" "$@"
+            ;;
+    esac
+    # shellcheck disable=SC2086
+    "$OUT/$name/spatio_bench" $ARGS > "$OUT/$name.txt"
+}
+
+variant baseline
+variant lto -DSPATIO_LTO=ON
+variant native -DSPATIO_ARCH=native
+variant x86-64-v3 -DSPATIO_ARCH=x86-64-v3
+variant dispatch -DSPATIO_DISPATCH=ON
+variant dispatch+lto -DSPATIO_DISPATCH=ON -DSPATIO_LTO=ON
+variant pgo
+variant pgo+lto+native -DSPATIO_LTO=ON -DSPATIO_ARCH=native
+
+# One row per benchmark, one ns/op column per variant
+names="baseline lto native x86-64-v3 dispatch dispatch+lto pgo pgo+lto+native"
+printf "%-18s" "ns/op"
+for n in $names; do printf " %14s" "$n"; done
+printf "\n"
+for bench in $(awk '/ops\/s/ {print $1}' "$OUT/baseline.txt"); do
+    printf "%-18s" "$bench"
+    for n in $names; do
+        printf " %14s" "$(awk -v b="$bench" '$1 == b {print $4}' "$OUT/$n.txt")"
+    done
+    printf "\n"
+done
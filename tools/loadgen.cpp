@@ -0,0 +1,269 @@
+// spatio_loadgen: closed-loop load generator for spatio_server
+//
+//   spatio_loadgen --unix /tmp/spatio.sock --connections 8 --depth 64 --seconds 10
+//
+// Each connection runs on its own thread and keeps --depth requests in
+// flight (pipelining): every response received is answered with a new
+// request. Queries are random within lat [30, 50], lon [-100, -80],
+// t [0, 86400) unless overridden. Reports throughput and latency
+// percentiles over all connections.
+
+#include "server_protocol.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+namespace protocol = spatio::protocol;
+
+struct Options {
+    std::string unix_path;
+    std::string host = "127.0.0.1";
+    int port = 0;
+    size_t connections = 4;
+    size_t depth = 64;
+    double seconds = 5.0;
+    std::string op = "radius";
+    double radius_km = 1.0;
+    double box_deg = 0.02;
+    uint64_t k = 10;
+    double window = 3600.0;   // Query time window (s)
+    float lat_min = 30.0f, lat_max = 50.0f, lon_min = -100.0f, lon_max = -80.0f;
+    double t_max = 86400.0;
+};
+
+struct Result {
+    uint64_t requests = 0;
+    uint64_t errors = 0;
+    uint64_t ids = 0;
+    std::vector<float> latencies_us;  // Sampled
+};
+
+void usage() {
+    std::fprintf(stderr,
+                 "usage: spatio_loadgen (--unix PATH | --port N [--host ADDR])\n"
+                 "                      [--connections N] [--depth N] [--seconds S]\n"
+                 "                      [--op radius|box|knn|count|ping] [--radius KM]\n"
+                 "                      [--box DEG] [--k N] [--window S]\n");
+    std::exit(2);
+}
+
+int connect_to(const Options& options) {
+    int fd;
+    if (!options.unix_path.empty()) {
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        std::strncpy(addr.sun_path, options.unix_path.c_str(), sizeof(addr.sun_path) - 1);
+        fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0 || ::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+            std::perror("connect");
+            std::exit(1);
+        }
+    } else {
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(static_cast<uint16_t>(options.port));
+        ::inet_pton(AF_INET, options.host.c_str(), &addr.sin_addr);
+        fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0 || ::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+            std::perror("connect");
+            std::exit(1);
+        }
+        int one = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+    return fd;
+}
+
+bool send_all(int fd, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = ::send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0) return false;
+        sent += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+class RequestMaker {
+public:
+    RequestMaker(const Options& options, uint64_t seed) : options_(options), rng_(seed) {}
+
+    void append(std::string& out, uint32_t tag) {
+        std::uniform_real_distribution<float> lat(options_.lat_min, options_.lat_max);
+        std::uniform_real_distribution<float> lon(options_.lon_min, options_.lon_max);
+        std::uniform_real_distribution<double> t(0.0, std::max(0.0, options_.t_max - options_.window));
+        const std::string& op = options_.op;
+        if (op == "radius") {
+            double t0 = t(rng_);
+            protocol::RadiusTimeBody body{lat(rng_), lon(rng_), options_.radius_km, t0, t0 + options_.window};
+            protocol::append_request(out, tag, protocol::OP_RADIUS_TIME, body);
+        } else if (op == "box") {
+            float a = lat(rng_), b = lon(rng_);
+            float d = static_cast<float>(options_.box_deg);
+            double t0 = t(rng_);
+            protocol::BoxTimeBody body{a, b, a + d, b + d, t0, t0 + options_.window};
+            protocol::append_request(out, tag, protocol::OP_BOX_TIME, body);
+        } else if (op == "knn") {
+            protocol::KnnBody body{lat(rng_), lon(rng_), options_.k, 0.0, 0.0};
+            protocol::append_request(out, tag, protocol::OP_KNN, body);
+        } else if (op == "count") {
+            double t0 = t(rng_);
+            protocol::TimeRangeBody body{t0, t0 + options_.window};
+            protocol::append_request(out, tag, protocol::OP_COUNT_TIME, body);
+        } else {
+            protocol::append_request(out, tag, protocol::OP_PING);
+        }
+    }
+
+private:
+    const Options& options_;
+    std::mt19937_64 rng_;
+};
+
+void run_connection(const Options& options, size_t index, Clock::time_point deadline, Result& result) {
+    int fd = connect_to(options);
+    RequestMaker maker(options, 1000 + index);
+    std::vector<Clock::time_point> sent_at(options.depth);
+    std::mt19937 sampler(static_cast<uint32_t>(index));
+
+    std::string out;
+    uint32_t next_tag = 0;
+    for (size_t i = 0; i < options.depth; i++) {
+        sent_at[next_tag % options.depth] = Clock::now();
+        maker.append(out, next_tag++);
+    }
+    if (!send_all(fd, out)) std::exit(1);
+
+    std::string in;
+    size_t outstanding = options.depth;
+    bool sending = true;
+    std::vector<char> buffer(256 * 1024);
+    while (outstanding > 0) {
+        ssize_t got = ::recv(fd, buffer.data(), buffer.size(), 0);
+        if (got <= 0) {
+            std::fprintf(stderr, "connection %zu: server closed the connection\n", index);
+            break;
+        }
+        in.append(buffer.data(), static_cast<size_t>(got));
+
+        Clock::time_point now = Clock::now();
+        sending = sending && now < deadline;
+        out.clear();
+        size_t pos = 0;
+        while (in.size() - pos >= sizeof(protocol::ResponseHeader)) {
+            protocol::ResponseHeader header;
+            std::memcpy(&header, in.data() + pos, sizeof(header));
+            size_t frame = sizeof(uint32_t) + header.length;
+            if (in.size() - pos < frame) break;
+
+            result.requests++;
+            if (header.status != protocol::STATUS_OK) {
+                result.errors++;
+            } else if (frame >= sizeof(header) + sizeof(uint32_t) && options.op != "count" &&
+                       options.op != "ping") {
+                uint32_t count;
+                std::memcpy(&count, in.data() + pos + sizeof(header), sizeof(count));
+                result.ids += count;
+            }
+            if ((sampler() & 15) == 0) {
+                auto latency = now - sent_at[header.tag % options.depth];
+                result.latencies_us.push_back(
+                    std::chrono::duration<float, std::micro>(latency).count());
+            }
+            pos += frame;
+            outstanding--;
+
+            if (sending) {
+                sent_at[next_tag % options.depth] = now;
+                maker.append(out, next_tag++);
+                outstanding++;
+            }
+        }
+        in.erase(0, pos);
+        if (!out.empty() && !send_all(fd, out)) break;
+    }
+    ::close(fd);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        auto value = [&]() -> const char* {
+            if (i + 1 >= argc) usage();
+            return argv[++i];
+        };
+        if (arg == "--unix") options.unix_path = value();
+        else if (arg == "--port") options.port = std::atoi(value());
+        else if (arg == "--host") options.host = value();
+        else if (arg == "--connections") options.connections = std::strtoull(value(), nullptr, 10);
+        else if (arg == "--depth") options.depth = std::strtoull(value(), nullptr, 10);
+        else if (arg == "--seconds") options.seconds = std::atof(value());
+        else if (arg == "--op") options.op = value();
+        else if (arg == "--radius") options.radius_km = std::atof(value());
+        else if (arg == "--box") options.box_deg = std::atof(value());
+        else if (arg == "--k") options.k = std::strtoull(value(), nullptr, 10);
+        else if (arg == "--window") options.window = std::atof(value());
+        else usage();
+    }
+    if ((options.unix_path.empty() && options.port == 0) || options.connections == 0 ||
+        options.depth == 0) {
+        usage();
+    }
+
+    std::vector<Result> results(options.connections);
+    std::vector<std::thread> threads;
+    auto start = Clock::now();
+    auto deadline = start + std::chrono::duration_cast<Clock::duration>(
+                                std::chrono::duration<double>(options.seconds));
+    for (size_t i = 0; i < options.connections; i++) {
+        threads.emplace_back(run_connection, std::cref(options), i, deadline, std::ref(results[i]));
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+    Result total;
+    for (const Result& r : results) {
+        total.requests += r.requests;
+        total.errors += r.errors;
+        total.ids += r.ids;
+        total.latencies_us.insert(total.latencies_us.end(), r.latencies_us.begin(), r.latencies_us.end());
+    }
+    std::sort(total.latencies_us.begin(), total.latencies_us.end());
+    auto percentile = [&](double p) -> double {
+        if (total.latencies_us.empty()) return 0.0;
+        size_t i = static_cast<size_t>(p * static_cast<double>(total.latencies_us.size() - 1));
+        return total.latencies_us[i];
+    };
+
+    std::printf("op=%s connections=%zu depth=%zu\n", options.op.c_str(), options.connections,
+                options.depth);
+    std::printf("requests %llu in %.2f s: %.0f req/s, errors %llu, avg ids/response %.2f\n",
+                static_cast<unsigned long long>(total.requests), elapsed,
+                static_cast<double>(total.requests) / elapsed,
+                static_cast<unsigned long long>(total.errors),
+                total.requests ? static_cast<double>(total.ids) / static_cast<double>(total.requests) : 0.0);
+    std::printf("latency us: p50 %.1f  p90 %.1f  p99 %.1f  max %.1f\n",
+                percentile(0.50), percentile(0.90), percentile(0.99), percentile(1.0));
+    return total.errors > 0 ? 1 : 0;
+}
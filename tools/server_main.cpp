@@ -0,0 +1,122 @@
+// spatio_server: host a SpatioIndexCore over Unix or TCP sockets
+//
+//   spatio_server --unix /tmp/spatio.sock --demo 1000000
+//   spatio_server --port 7070 --state index.bin --threads 8
+//   spatio_server --port 7070 --state index.bin --threads 32 --numa
+//
+// --state loads a snapshot written by SpatioIndexCore::serialize() (in
+// Python: open(path, "wb").write(index._core.serialize())). --demo fills
+// the index with random points in lat [30, 50], lon [-100, -80] and
+// t [0, 86400), matching spatio_loadgen's defaults. --numa serves a replica
+// per NUMA node from workers pinned to it (see SpatioServer); per-node
+// throughput is printed on exit.
+
+#include "spatio_server.hpp"
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+
+namespace {
+
+spatio::SpatioServer* g_server = nullptr;
+
+void handle_signal(int) {
+    if (g_server) g_server->stop();
+}
+
+void usage() {
+    std::fprintf(stderr,
+                 "usage: spatio_server (--unix PATH | --port N [--host ADDR]) [--threads N]\n"
+                 "                     [--max-batch N] [--numa] [--state FILE | --demo N]\n");
+    std::exit(2);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    spatio::SpatioServer::Config config;
+    std::string state_path;
+    size_t demo = 0;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        auto value = [&]() -> const char* {
+            if (i + 1 >= argc) usage();
+            return argv[++i];
+        };
+        if (arg == "--unix") config.unix_path = value();
+        else if (arg == "--port") config.tcp_port = std::atoi(value());
+        else if (arg == "--host") config.tcp_host = value();
+        else if (arg == "--threads") config.threads = std::strtoull(value(), nullptr, 10);
+        else if (arg == "--max-batch") config.max_batch = std::strtoull(value(), nullptr, 10);
+        else if (arg == "--numa") config.numa = true;
+        else if (arg == "--state") state_path = value();
+        else if (arg == "--demo") demo = std::strtoull(value(), nullptr, 10);
+        else usage();
+    }
+    if (config.unix_path.empty() && config.tcp_port == 0) usage();
+
+    try {
+        spatio::SpatioIndexCore index;
+        if (!state_path.empty()) {
+            std::ifstream in(state_path, std::ios::binary);
+            if (!in) {
+                std::fprintf(stderr, "spatio_server: cannot open %s\n", state_path.c_str());
+                return 1;
+            }
+            std::string state((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+            index.deserialize(state.data(), state.size());
+        } else if (demo > 0) {
+            std::mt19937_64 rng(42);
+            std::uniform_real_distribution<float> lat(30.0f, 50.0f), lon(-100.0f, -80.0f);
+            std::uniform_real_distribution<double> t(0.0, 86400.0);
+            std::vector<spatio::RecordInput> records;
+            records.reserve(demo);
+            for (size_t i = 0; i < demo; i++) {
+                records.emplace_back(lat(rng), lon(rng), t(rng));
+            }
+            index.bulk_insert(records);
+            index.build();
+        }
+
+        spatio::SpatioServer server(index, config);
+        server.listen();
+        g_server = &server;
+        std::signal(SIGINT, handle_signal);
+        std::signal(SIGTERM, handle_signal);
+        std::signal(SIGPIPE, SIG_IGN);
+
+        std::printf("spatio_server: %zu records, listening on %s\n", index.size(),
+                    config.unix_path.empty()
+                        ? (config.tcp_host + ":" + std::to_string(config.tcp_port)).c_str()
+                        : config.unix_path.c_str());
+        std::fflush(stdout);
+        server.run();
+        g_server = nullptr;
+
+        auto stats = server.stats();
+        std::printf("spatio_server: %llu requests in %llu batches, %llu connections\n",
+                    static_cast<unsigned long long>(stats.requests),
+                    static_cast<unsigned long long>(stats.batches),
+                    static_cast<unsigned long long>(stats.connections));
+        for (const auto& node : stats.nodes) {
+            double busy = node.busy_seconds > 0.0 ? node.busy_seconds : 1.0;
+            std::printf("  node %d%s: %zu workers, %llu requests, %.0f req/s and %.1f MB/s per busy "
+                        "second, pages allocated %llu local / %llu remote\n",
+                        node.node, node.replica ? " (replica)" : "", node.workers,
+                        static_cast<unsigned long long>(node.requests),
+                        static_cast<double>(node.requests) / busy,
+                        static_cast<double>(node.response_bytes) / busy / 1e6,
+                        static_cast<unsigned long long>(node.local_pages),
+                        static_cast<unsigned long long>(node.remote_pages));
+        }
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+    return 0;
+}